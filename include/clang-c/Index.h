@@ -33,7 +33,7 @@
  * compatible, thus CINDEX_VERSION_MAJOR is expected to remain stable.
  */
 #define CINDEX_VERSION_MAJOR 0
-#define CINDEX_VERSION_MINOR 59
+#define CINDEX_VERSION_MINOR 60
 
 #define CINDEX_VERSION_ENCODE(major, minor) ( \
       ((major) * 10000)                       \
@@ -1628,6 +1628,89 @@ CINDEX_LINKAGE int clang_reparseTranslationUnit(CXTranslationUnit TU,
                                           struct CXUnsavedFile *unsaved_files,
                                                 unsigned options);
 
+/**
+ * A single translation unit to parse or reparse with
+ * \c clang_parseTranslationUnitBatch().
+ */
+typedef struct {
+  /**
+   * The translation unit to reparse, or NULL to parse a new translation unit
+   * from \c source_filename and \c command_line_args.
+   */
+  CXTranslationUnit translation_unit;
+
+  /**
+   * The arguments used to parse a new translation unit, as for
+   * \c clang_parseTranslationUnit2FullArgv(). Ignored when reparsing.
+   */
+  const char *source_filename;
+  const char *const *command_line_args;
+  int num_command_line_args;
+
+  /**
+   * The files that have not yet been saved to disk. They only need to remain
+   * valid until \c clang_parseTranslationUnitBatch() returns.
+   */
+  struct CXUnsavedFile *unsaved_files;
+  unsigned num_unsaved_files;
+
+  /**
+   * A bitset of \c CXTranslationUnit_Flags when parsing a new translation
+   * unit, or of \c CXReparse_Flags when reparsing.
+   */
+  unsigned options;
+} CXTranslationUnitBatchEntry;
+
+/**
+ * Invoked by \c clang_parseTranslationUnitBatch() once an entry is done.
+ *
+ * \param client_data The \c client_data passed to
+ * \c clang_parseTranslationUnitBatch().
+ *
+ * \param entry The index of the entry in the batch.
+ *
+ * \param TU The parsed or reparsed translation unit, or NULL if parsing a new
+ * translation unit failed. A new translation unit is owned by the client and
+ * must be disposed with \c clang_disposeTranslationUnit().
+ *
+ * \param error The result of parsing or reparsing the entry.
+ */
+typedef void (*CXTranslationUnitBatchCallback)(CXClientData client_data,
+                                               unsigned entry,
+                                               CXTranslationUnit TU,
+                                               enum CXErrorCode error);
+
+/**
+ * Parse or reparse a batch of translation units on a pool of threads.
+ *
+ * Each entry is processed as by \c clang_parseTranslationUnit2FullArgv() or
+ * \c clang_reparseTranslationUnit(). A translation unit must not appear in
+ * more than one entry.
+ *
+ * \param CIdx The index object with which the new translation units will be
+ * associated.
+ *
+ * \param entries The translation units to parse or reparse.
+ *
+ * \param num_entries The number of entries in \p entries.
+ *
+ * \param num_threads The maximum number of threads to use, or 0 to use one
+ * thread per hardware thread.
+ *
+ * \param callback Invoked once for each entry as soon as it is done. Calls
+ * are made from the worker threads, but never concurrently.
+ *
+ * \param client_data Passed through to \p callback.
+ *
+ * \returns CXError_Success once all entries are done, or
+ * CXError_InvalidArguments if the arguments are invalid, in which case no
+ * entry is processed.
+ */
+CINDEX_LINKAGE enum CXErrorCode clang_parseTranslationUnitBatch(
+    CXIndex CIdx, const CXTranslationUnitBatchEntry *entries,
+    unsigned num_entries, unsigned num_threads,
+    CXTranslationUnitBatchCallback callback, CXClientData client_data);
+
 /**
   * Categorizes how memory is being used by a translation unit.
   */
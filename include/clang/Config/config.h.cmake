@@ -80,6 +80,9 @@
 #cmakedefine01 CLANG_ENABLE_OBJC_REWRITER
 #cmakedefine01 CLANG_ENABLE_STATIC_ANALYZER
 
+/* Keep the analyzer's environment and generic data map in a hash trie */
+#cmakedefine01 CLANG_ANALYZER_HASH_TRIE_STATE
+
 /* Spawn a new process clang.exe for the CC1 tool invocation, when necessary */
 #cmakedefine01 CLANG_SPAWN_CC1
 
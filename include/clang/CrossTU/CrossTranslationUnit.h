@@ -21,6 +21,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 namespace clang {
 class CompilerInstance;
@@ -47,7 +48,8 @@ enum class index_error_code {
   triple_mismatch,
   lang_mismatch,
   lang_dialect_mismatch,
-  load_threshold_reached
+  load_threshold_reached,
+  index_too_large
 };
 
 class IndexError : public llvm::ErrorInfo<IndexError> {
@@ -82,6 +84,8 @@ private:
 ///
 /// The index file format is the following:
 /// each line consists of an USR and a filepath separated by a space.
+/// Binary index files created by createCrossTUBinaryIndex are accepted as
+/// well.
 ///
 /// \return Returns a map where the USR is the key and the filepath is the value
 ///         or an error.
@@ -90,6 +94,31 @@ parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir);
 
 std::string createCrossTUIndexString(const llvm::StringMap<std::string> &Index);
 
+/// This function creates the binary form of an index.
+///
+/// The binary index starts with a header and a table of entries sorted by USR,
+/// followed by the USRs and the filepaths themselves. It is meant to be memory
+/// mapped and searched in place, so that loading it does not depend on the
+/// number of definitions in the index.
+///
+/// \return Returns the binary index, or an error if it would exceed the
+///         4GB that its 32 bit offsets can address.
+llvm::Expected<std::string>
+createCrossTUBinaryIndex(const llvm::StringMap<std::string> &Index);
+
+/// Returns true if \p Buffer starts like an index created by
+/// createCrossTUBinaryIndex.
+bool isCrossTUBinaryIndex(StringRef Buffer);
+
+/// Looks up \p LookupName in the binary index \p Buffer read from
+/// \p IndexPath.
+///
+/// \return Returns the filepath of the definition, None if the index has no
+///         entry for \p LookupName, or an error if the index is malformed.
+llvm::Expected<llvm::Optional<StringRef>>
+lookupCrossTUBinaryIndex(StringRef Buffer, StringRef LookupName,
+                         StringRef IndexPath);
+
 // Returns true if the variable or any field of a record variable is const.
 bool containsConst(const VarDecl *VD, const ASTContext &ACtx);
 
@@ -191,6 +220,9 @@ private:
   const T *findDefInDeclContext(const DeclContext *DC,
                                 StringRef LookupName);
   template <typename T>
+  const T *findDefByNameLookup(const T *D, ASTUnit *Unit,
+                               StringRef LookupName);
+  template <typename T>
   llvm::Expected<const T *> importDefinitionImpl(const T *D, ASTUnit *Unit);
 
   using ImporterMapTy =
@@ -274,6 +306,10 @@ private:
 
   private:
     llvm::Error ensureCTUIndexLoaded(StringRef CrossTUDir, StringRef IndexName);
+    /// Returns the path of the file which contains the definition of
+    /// \p FunctionName according to the loaded index, or an empty string if
+    /// the index has no entry for it.
+    llvm::Expected<std::string> lookupCTUIndex(StringRef FunctionName);
     llvm::Expected<ASTUnit *> getASTUnitForFile(StringRef FileName,
                                                 bool DisplayCTUProgress);
 
@@ -287,6 +323,12 @@ private:
     using IndexMapTy = BaseMapTy<std::string>;
     IndexMapTy NameFileMap;
 
+    /// The memory mapped index, if the index file is in the binary format.
+    /// NameFileMap is not used in that case.
+    std::unique_ptr<llvm::MemoryBuffer> BinaryIndex;
+    std::string BinaryIndexPath;
+    std::string BinaryIndexDir;
+
     ASTFileLoader FileAccessor;
 
     /// Limit the number of loaded ASTs. Used to limit the  memory usage of the
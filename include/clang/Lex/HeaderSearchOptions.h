@@ -214,6 +214,15 @@ public:
   /// diagnostics.
   unsigned ModulesStrictContextHash : 1;
 
+  /// Whether implicitly built module files are stored by their AST signature
+  /// in the "content" subdirectory of the module cache. Signatures are only
+  /// written with \c ModulesHashContent.
+  ///
+  /// The module file in the context-specific directory becomes a hard link
+  /// to the stored copy, so byte-identical module files built in different
+  /// contexts share storage.
+  unsigned ModulesContentAddressedCache : 1;
+
   HeaderSearchOptions(StringRef _Sysroot = "/")
       : Sysroot(_Sysroot), ModuleFormat("raw"), DisableModuleHash(false),
         ImplicitModuleMaps(false), ModuleMapFileHomeIsCwd(false),
@@ -223,7 +232,7 @@ public:
         ModulesValidateSystemHeaders(false),
         ValidateASTInputFilesContent(false), UseDebugInfo(false),
         ModulesValidateDiagnosticOptions(true), ModulesHashContent(false),
-        ModulesStrictContextHash(false) {}
+        ModulesStrictContextHash(false), ModulesContentAddressedCache(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
@@ -1368,6 +1368,18 @@ public:
   /// Lex the next token for this preprocessor.
   void Lex(Token &Result);
 
+  /// Lex up to \p Toks.size() tokens into \p Toks, stopping after the eof
+  /// token. \p Toks must not be empty.
+  ///
+  /// This is equivalent to calling Lex() for each token, but skips the
+  /// per-token bookkeeping that is only needed for a token watcher, C++20
+  /// import sequences and code completion when none of them is active.
+  /// PPCallbacks still run while the tokens are lexed, so clients that
+  /// interleave their own output with callbacks should use Lex() instead.
+  ///
+  /// \returns the number of tokens written to \p Toks, which is at least one.
+  unsigned LexTokens(MutableArrayRef<Token> Toks);
+
   /// Lex a token, forming a header-name token if possible.
   bool LexHeaderName(Token &Result, bool AllowMacroExpansion = true);
 
@@ -2163,6 +2175,10 @@ private:
     return IsFileLexer(CurLexer.get(), CurPPLexer);
   }
 
+  /// Lex from the current lexer until it returns a token, without any of the
+  /// per-token bookkeeping done by Lex().
+  void LexFromCurrentLexer(Token &Result);
+
   //===--------------------------------------------------------------------===//
   // Caching stuff.
   void CachingLex(Token &Result);
@@ -9,7 +9,8 @@
 // This file defines the GlobalModuleIndex class, which manages a global index
 // containing all of the identifiers known to the various modules within a given
 // subdirectory of the module cache. It is used to improve the performance of
-// queries such as "do any modules know about this identifier?"
+// queries such as "do any modules know about this identifier?" or "do any
+// modules declare Objective-C methods with this selector?"
 //
 //===----------------------------------------------------------------------===//
 #ifndef LLVM_CLANG_SERIALIZATION_GLOBALMODULEINDEX_H
@@ -37,6 +38,7 @@ class FileManager;
 class IdentifierIterator;
 class PCHContainerOperations;
 class PCHContainerReader;
+class Selector;
 
 namespace serialization {
   class ModuleFile;
@@ -67,6 +69,13 @@ class GlobalModuleIndex {
   /// GlobalModuleIndex.
   void *IdentifierIndex;
 
+  /// The selector hash table.
+  ///
+  /// This pointer actually points to a SelectorIndexTable object,
+  /// but that type is only accessible within the implementation of
+  /// GlobalModuleIndex.
+  void *SelectorIndex;
+
   /// Information about a given module file.
   struct ModuleInfo {
     ModuleInfo() : File(), Size(), ModTime() { }
@@ -113,6 +122,13 @@ class GlobalModuleIndex {
   /// identifier.
   unsigned NumIdentifierLookupHits;
 
+  /// The number of selector lookups we performed.
+  unsigned NumSelectorLookups;
+
+  /// The number of selector lookup hits, where at least one module file
+  /// declares a method with the selector.
+  unsigned NumSelectorLookupHits;
+
   /// Internal constructor. Use \c readIndex() to read an index.
   explicit GlobalModuleIndex(std::unique_ptr<llvm::MemoryBuffer> Buffer,
                              llvm::BitstreamCursor Cursor);
@@ -163,6 +179,21 @@ public:
   /// \returns true if the identifier is known to the index, false otherwise.
   bool lookupIdentifier(llvm::StringRef Name, HitSet &Hits);
 
+  /// Look for all of the module files that declare Objective-C instance or
+  /// class methods with the given selector.
+  ///
+  /// Selectors are indexed by their hash, so the resulting set may contain
+  /// module files that only declare methods with a colliding selector; it
+  /// never omits a module file that declares a method with \p Sel.
+  ///
+  /// \param Sel The selector to look for.
+  ///
+  /// \param Hits Will be populated with the set of module files that have
+  /// methods with this selector in their method pool.
+  ///
+  /// \returns true if the index has selector information, false otherwise.
+  bool lookupSelector(Selector Sel, HitSet &Hits);
+
   /// Note that the given module file has been loaded.
   ///
   /// \returns false if the global module index has information about this
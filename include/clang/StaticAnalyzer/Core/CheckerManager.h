@@ -21,6 +21,8 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace clang {
@@ -52,6 +54,29 @@ class RegionAndSymbolInvalidationTraits;
 class SVal;
 class SymbolReaper;
 
+/// The number of calls to one callback of one checker and the time spent in
+/// them. Only collected when the profile-checkers analyzer option is enabled.
+struct CheckerCallbackProfile {
+  StringRef CheckerName;
+  StringRef Callback;
+  uint64_t NumCalls = 0;
+  uint64_t Nanoseconds = 0;
+
+  CheckerCallbackProfile(StringRef CheckerName, StringRef Callback)
+      : CheckerName(CheckerName), Callback(Callback) {}
+
+  /// Measures a single call, and reports it as a time-trace event if
+  /// -ftime-trace is enabled.
+  class Scope {
+    CheckerCallbackProfile &Profile;
+    uint64_t Start;
+
+  public:
+    explicit Scope(CheckerCallbackProfile &Profile);
+    ~Scope();
+  };
+};
+
 template <typename T> class CheckerFn;
 
 template <typename RET, typename... Ps>
@@ -63,9 +88,16 @@ class CheckerFn<RET(Ps...)> {
 public:
   CheckerBase *Checker;
 
+  /// Where the calls are measured, if the checkers are profiled.
+  CheckerCallbackProfile *Profile = nullptr;
+
   CheckerFn(CheckerBase *checker, Func fn) : Fn(fn), Checker(checker) {}
 
   RET operator()(Ps... ps) const {
+    if (Profile) {
+      CheckerCallbackProfile::Scope S(*Profile);
+      return Fn(Checker, ps...);
+    }
     return Fn(Checker, ps...);
   }
 };
@@ -137,6 +169,10 @@ public:
 
   bool hasPathSensitiveCheckers() const;
 
+  /// Returns true if a checker inspects the ExplodedGraph at the end of the
+  /// analysis.
+  bool hasEndAnalysisCheckers() const { return !EndAnalysisCheckers.empty(); }
+
   void finishedCheckerRegistration();
 
   const LangOptions &getLangOpts() const { return LangOpts; }
@@ -424,6 +460,13 @@ public:
                                     unsigned int Space = 0,
                                     bool IsDot = false) const;
 
+  /// Returns the time spent in each callback of each checker, if the
+  /// profile-checkers analyzer option is enabled.
+  ArrayRef<std::unique_ptr<CheckerCallbackProfile>>
+  getCallbackProfiles() const {
+    return CallbackProfiles;
+  }
+
   //===----------------------------------------------------------------------===//
   // Internal registration functions for AST traversing.
   //===----------------------------------------------------------------------===//
@@ -591,6 +634,12 @@ private:
 
   std::vector<CheckerDtor> CheckerDtors;
 
+  /// Attaches a profile to \p Fn if the checkers are profiled.
+  template <typename T>
+  void profileCallback(CheckerFn<T> &Fn, StringRef Callback);
+
+  std::vector<std::unique_ptr<CheckerCallbackProfile>> CallbackProfiles;
+
   struct DeclCheckerInfo {
     CheckDeclFunc CheckFn;
     HandlesDeclFunc IsForDeclFn;
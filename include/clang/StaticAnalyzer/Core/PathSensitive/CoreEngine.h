@@ -100,6 +100,24 @@ private:
   /// is happening. This field is the allocator for such tags.
   NoteTag::Factory NoteTags;
 
+  /// The memory, in bytes, the graph may grow to before it is compacted, or 0
+  /// if it is never compacted.
+  uint64_t GraphMemoryBudget;
+
+  /// The number of nodes that were kept by the last compaction of the graph.
+  unsigned NumNodesAfterCompaction = 0;
+
+  /// The largest number of nodes the graph had at once.
+  unsigned MaxGraphSize = 0;
+
+  /// Returns true if the graph exceeds its memory budget and is worth
+  /// compacting.
+  bool shouldCompactGraph() const;
+
+  /// Removes the nodes of the graph that neither the worklist, the blocks
+  /// where the analysis stopped, nor the pending bug reports depend on.
+  void compactGraph();
+
   void generateNode(const ProgramPoint &Loc,
                     ProgramStateRef State,
                     ExplodedNode *Pred);
@@ -139,6 +157,9 @@ public:
   /// getGraph - Returns the exploded graph.
   ExplodedGraph &getGraph() { return G; }
 
+  /// Returns the largest number of nodes the graph had at once.
+  unsigned getMaxGraphSize() const { return MaxGraphSize; }
+
   /// ExecuteWorkList - Run the worklist algorithm for a maximum number of
   ///  steps.  Returns true if there is still simulation state on the worklist.
   bool ExecuteWorkList(const LocationContext *L, unsigned Steps,
@@ -14,6 +14,8 @@
 #define LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_ENVIRONMENT_H
 
 #include "clang/Analysis/AnalysisDeclContext.h"
+#include "clang/Config/config.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/ImmutableHashMap.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramState_Fwd.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SVals.h"
 #include "llvm/ADT/ImmutableMap.h"
@@ -57,7 +59,13 @@ class Environment {
 private:
   friend class EnvironmentManager;
 
+#if CLANG_ANALYZER_HASH_TRIE_STATE
+  // The environment is updated for almost every expression. A hash trie makes
+  // these updates cheaper, but hash-conses every new node.
+  using BindingsTy = ImmutableHashMap<EnvironmentEntry, SVal>;
+#else
   using BindingsTy = llvm::ImmutableMap<EnvironmentEntry, SVal>;
+#endif
 
   BindingsTy ExprBindings;
 
@@ -112,6 +112,10 @@ class ExplodedNode : public llvm::FoldingSetNode {
     /// only a single node.
     void replaceNode(ExplodedNode *node);
 
+    /// Removes the nodes for which \p ShouldRemove returns true.
+    void
+    removeNodes(llvm::function_ref<bool(const ExplodedNode *)> ShouldRemove);
+
     /// Returns whether this group was created with its flag set.
     bool getFlag() const {
       return (P & 1);
@@ -451,6 +455,25 @@ public:
   /// was called.
   void reclaimRecentlyAllocatedNodes();
 
+  /// Remove every node that is neither one of the given nodes, nor one of
+  /// the successors of \p Subgraphs, nor one of the predecessors of those,
+  /// transitively. The roots of the graph are always kept.
+  ///
+  /// The memory of the removed nodes, and of the states only they refer to,
+  /// is recycled for the nodes and states created afterwards.
+  ///
+  /// \param Live The nodes that the analysis may still refer to, such as the
+  ///             nodes on the worklist and the error nodes of bug reports.
+  /// \param Subgraphs The nodes whose successors are needed as well, such as
+  ///             the error nodes of reports that are suppressed on sinks.
+  /// \returns The number of nodes removed.
+  unsigned compact(ArrayRef<const ExplodedNode *> Live,
+                   ArrayRef<const ExplodedNode *> Subgraphs);
+
+  /// Returns true if there are removed nodes whose memory has not been
+  /// reused yet.
+  bool hasFreeNodes() const { return !FreeNodes.empty(); }
+
   /// Returns true if nodes for the given expression kind are always
   ///        kept around.
   static bool isInterestingLValueExpr(const Expr *Ex);
@@ -156,6 +156,10 @@ private:
   /// The flag, which specifies the mode of inlining for the engine.
   InliningModes HowToInline;
 
+  /// Whether every path of the top-level function returned so far returned a
+  /// non-null pointer. None if no path returned yet.
+  Optional<bool> ReturnsNonNull;
+
 public:
   ExprEngine(cross_tu::CrossTranslationUnitContext &CTU, AnalysisManager &mgr,
              SetOfConstDecls *VisitedCalleesIn,
@@ -361,6 +365,14 @@ public:
   /// Called by CoreEngine when the analysis worklist has terminated.
   void processEndWorklist() override;
 
+  /// Collects the error nodes of the bug reports emitted so far.
+  void
+  collectLiveNodes(SmallVectorImpl<const ExplodedNode *> &Nodes,
+                   SmallVectorImpl<const ExplodedNode *> &Subgraphs) override;
+
+  /// Returns false if checkers inspect the graph at the end of the analysis.
+  bool canCompactGraph() const override;
+
   /// evalAssume - Callback function invoked by the ConstraintManager when
   ///  making assumptions about state values.
   ProgramStateRef processAssume(ProgramStateRef state, SVal cond,
@@ -405,6 +417,10 @@ public:
   bool hasEmptyWorkList() const { return !Engine.getWorkList()->hasWork(); }
   bool hasWorkRemaining() const { return Engine.hasWorkRemaining(); }
 
+  /// Returns true if at least one path of the top-level function returned, and
+  /// every path which returned returned a non-null pointer.
+  bool returnedOnlyNonNull() const { return ReturnsNonNull.getValueOr(false); }
+
   const CoreEngine &getCoreEngine() const { return Engine; }
 
 public:
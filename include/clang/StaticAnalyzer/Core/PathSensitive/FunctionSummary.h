@@ -20,13 +20,17 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/StringSet.h"
 #include <cassert>
 #include <deque>
+#include <string>
 #include <utility>
 
 namespace clang {
 namespace ento {
 
+class AnalyzerOptions;
+
 using SetOfDecls = std::deque<Decl *>;
 using SetOfConstDecls = llvm::DenseSet<const Decl *>;
 
@@ -37,7 +41,10 @@ class FunctionSummariesTy {
     llvm::SmallBitVector VisitedBasicBlocks;
 
     /// Total number of blocks in the function.
-    unsigned TotalBasicBlocks : 30;
+    unsigned TotalBasicBlocks : 29;
+
+    /// True if inlining this function exhausted the analysis budget.
+    unsigned ReachedMaxBlockCount : 1;
 
     /// True if this function has been checked against the rules for which
     /// functions may be inlined.
@@ -49,14 +56,25 @@ class FunctionSummariesTy {
     /// The number of times the function has been inlined.
     unsigned TimesInlined : 32;
 
+    /// True if every path of the function, analyzed as a top-level function,
+    /// returned a non-null pointer.
+    unsigned ReturnsNonNull : 1;
+
     FunctionSummary()
-        : TotalBasicBlocks(0), InlineChecked(0), MayInline(0),
-          TimesInlined(0) {}
+        : TotalBasicBlocks(0), ReachedMaxBlockCount(0), InlineChecked(0),
+          MayInline(0), TimesInlined(0), ReturnsNonNull(0) {}
   };
 
   using MapTy = llvm::DenseMap<const Decl *, FunctionSummary>;
   MapTy Map;
 
+  /// The keys of the functions which exhausted the analysis budget when they
+  /// were inlined in previous runs.
+  llvm::StringSet<> PersistentReachedMaxBlockCount;
+
+  /// The keys of the functions which never returned null in previous runs.
+  llvm::StringSet<> PersistentReturnsNonNull;
+
 public:
   MapTy::iterator findOrInsertSummary(const Decl *D) {
     MapTy::iterator I = Map.find(D);
@@ -84,15 +102,32 @@ public:
 
   void markReachedMaxBlockCount(const Decl *D) {
     markShouldNotInline(D);
+    Map.find(D)->second.ReachedMaxBlockCount = 1;
   }
 
   Optional<bool> mayInline(const Decl *D) {
     MapTy::const_iterator I = Map.find(D);
     if (I != Map.end() && I->second.InlineChecked)
       return I->second.MayInline;
+    if (!PersistentReachedMaxBlockCount.empty() &&
+        isPersistentReachedMaxBlockCount(D)) {
+      markReachedMaxBlockCount(D);
+      return false;
+    }
     return None;
   }
 
+  void markReturnsNonNull(const Decl *D) {
+    findOrInsertSummary(D)->second.ReturnsNonNull = 1;
+  }
+
+  bool returnsNonNull(const Decl *D) {
+    MapTy::const_iterator I = Map.find(D);
+    if (I != Map.end() && I->second.ReturnsNonNull)
+      return true;
+    return !PersistentReturnsNonNull.empty() && isPersistentReturnsNonNull(D);
+  }
+
   void markVisitedBasicBlock(unsigned ID, const Decl* D, unsigned TotalIDs) {
     MapTy::iterator I = findOrInsertSummary(D);
     llvm::SmallBitVector &Blocks = I->second.VisitedBasicBlocks;
@@ -134,6 +169,25 @@ public:
 
   unsigned getTotalNumBasicBlocks();
   unsigned getTotalNumVisitedBasicBlocks();
+
+  /// Returns the directory of the summary cache for the analysis budget and
+  /// the checkers configured by \p Opts, which decide whether a function
+  /// exhausts the budget, within the 'summary-cache-dir' directory.
+  static std::string getPersistentSummaryDir(const AnalyzerOptions &Opts);
+
+  /// Load the functions which exhausted the analysis budget when they were
+  /// inlined, and those which never returned null, from the summary file
+  /// stored in \p Dir by the previous run on the translation unit \p TUName.
+  void loadPersistentSummaries(StringRef Dir, StringRef TUName);
+
+  /// Store the functions which exhausted the analysis budget when they were
+  /// inlined, and those which never returned null, in this run, in the summary
+  /// file for the translation unit \p TUName in \p Dir.
+  void storePersistentSummaries(StringRef Dir, StringRef TUName);
+
+private:
+  bool isPersistentReachedMaxBlockCount(const Decl *D);
+  bool isPersistentReturnsNonNull(const Decl *D);
 };
 
 } // namespace ento
@@ -0,0 +1,665 @@
+//===- ImmutableHashMap.h - Hash-consed persistent hash map -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines ImmutableHashMap, a persistent map implemented as a hash
+//  array mapped trie (HAMT). It provides the interface of llvm::ImmutableMap
+//  that the analyzer relies on, but an update only copies the short path from
+//  the root to the changed entry instead of rebalancing a binary tree.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_IMMUTABLEHASHMAP_H
+#define LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_IMMUTABLEHASHMAP_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/ImmutableMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/TrailingObjects.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace clang {
+namespace ento {
+
+template <typename ImutInfo> class ImutHAMTFactory;
+template <typename ImutInfo> class ImutHAMTIterator;
+
+/// A node of a hash array mapped trie.
+///
+/// A branch node maps each 5-bit chunk of the key hashes at its depth to a
+/// child node; only the children that are present are stored. A leaf node
+/// holds the entries whose keys all have the same hash, sorted by key.
+///
+/// The shape of the trie only depends on its entries: a subtrie with entries
+/// of a single hash is always a leaf, and a branch has either two or more
+/// children or a single branch child. Nodes are hash-consed by their factory,
+/// so two maps with the same entries share the same root node.
+template <typename ImutInfo>
+class ImutHAMTNode final
+    : private llvm::TrailingObjects<
+          ImutHAMTNode<ImutInfo>, ImutHAMTNode<ImutInfo> *,
+          typename std::remove_const<typename ImutInfo::value_type>::type> {
+public:
+  using value_type = typename ImutInfo::value_type;
+  using key_type_ref = typename ImutInfo::key_type_ref;
+
+private:
+  friend class ImutHAMTFactory<ImutInfo>;
+  friend class ImutHAMTIterator<ImutInfo>;
+
+  using StoredValueTy = typename std::remove_const<value_type>::type;
+  using TrailingTy =
+      llvm::TrailingObjects<ImutHAMTNode, ImutHAMTNode *, StoredValueTy>;
+  friend TrailingTy;
+
+  ImutHAMTFactory<ImutInfo> *Factory;
+  /// The next node in the same bucket of the factory's hash-consing table.
+  ImutHAMTNode *NextInBucket = nullptr;
+  unsigned RefCount = 0;
+  /// The hash of the contents of this node, cached for the factory's
+  /// hash-consing table.
+  unsigned NodeHash;
+  /// For a branch, the set of chunks that have a child. For a leaf, the hash
+  /// of its keys.
+  unsigned Bits;
+  unsigned NumItems : 31;
+  unsigned IsLeaf : 1;
+
+  ImutHAMTNode(ImutHAMTFactory<ImutInfo> *F, bool IsLeaf, unsigned Bits,
+               unsigned NumItems, unsigned NodeHash)
+      : Factory(F), NodeHash(NodeHash), Bits(Bits), NumItems(NumItems),
+        IsLeaf(IsLeaf) {}
+
+  size_t numTrailingObjects(
+      typename TrailingTy::template OverloadToken<ImutHAMTNode *>) const {
+    return IsLeaf ? 0 : NumItems;
+  }
+
+  static size_t getAllocSize(bool IsLeaf, unsigned NumItems) {
+    return TrailingTy::template totalSizeToAlloc<ImutHAMTNode *, StoredValueTy>(
+        IsLeaf ? 0 : NumItems, IsLeaf ? NumItems : 0);
+  }
+
+  ImutHAMTNode **getChildrenBuffer() {
+    return this->template getTrailingObjects<ImutHAMTNode *>();
+  }
+
+  StoredValueTy *getValuesBuffer() {
+    return this->template getTrailingObjects<StoredValueTy>();
+  }
+
+  llvm::ArrayRef<ImutHAMTNode *> children() const {
+    assert(!IsLeaf);
+    return {this->template getTrailingObjects<ImutHAMTNode *>(), NumItems};
+  }
+
+  llvm::ArrayRef<StoredValueTy> values() const {
+    assert(IsLeaf);
+    return {this->template getTrailingObjects<StoredValueTy>(), NumItems};
+  }
+
+  static unsigned hashBranch(unsigned Bits,
+                             llvm::ArrayRef<ImutHAMTNode *> Children) {
+    return llvm::hash_combine(
+        Bits, llvm::hash_combine_range(Children.begin(), Children.end()));
+  }
+
+  static unsigned hashLeaf(unsigned Hash,
+                           llvm::ArrayRef<const StoredValueTy *> Values) {
+    llvm::FoldingSetNodeID ID;
+    for (const StoredValueTy *V : Values)
+      ImutInfo::Profile(ID, *V);
+    return llvm::hash_combine(Hash, ID.ComputeHash());
+  }
+
+  bool matchesBranch(unsigned OtherBits,
+                     llvm::ArrayRef<ImutHAMTNode *> OtherChildren) const {
+    return !IsLeaf && Bits == OtherBits && children() == OtherChildren;
+  }
+
+  bool matchesLeaf(unsigned Hash,
+                   llvm::ArrayRef<const StoredValueTy *> OtherValues) const {
+    if (!IsLeaf || Bits != Hash || NumItems != OtherValues.size())
+      return false;
+    for (unsigned I = 0; I != NumItems; ++I) {
+      const StoredValueTy &V = values()[I];
+      if (!ImutInfo::isEqual(ImutInfo::KeyOfValue(V),
+                             ImutInfo::KeyOfValue(*OtherValues[I])) ||
+          !ImutInfo::isDataEqual(ImutInfo::DataOfValue(V),
+                                 ImutInfo::DataOfValue(*OtherValues[I])))
+        return false;
+    }
+    return true;
+  }
+
+public:
+  ImutHAMTNode(const ImutHAMTNode &) = delete;
+  ImutHAMTNode &operator=(const ImutHAMTNode &) = delete;
+
+  bool isLeaf() const { return IsLeaf; }
+
+  /// Returns the number of children of a branch or entries of a leaf.
+  unsigned size() const { return NumItems; }
+
+  /// Returns the entry of \p Key in the trie rooted at \p N, or null.
+  static const value_type *lookup(const ImutHAMTNode *N, key_type_ref Key) {
+    unsigned Hash = hashKey(Key);
+    for (unsigned Shift = 0; N && !N->IsLeaf; Shift += 5) {
+      unsigned Bit = 1U << ((Hash >> Shift) & 31);
+      if (!(N->Bits & Bit))
+        return nullptr;
+      N = N->children()[llvm::countPopulation(N->Bits & (Bit - 1))];
+    }
+    if (!N || N->Bits != Hash)
+      return nullptr;
+    for (const StoredValueTy &V : N->values())
+      if (ImutInfo::isEqual(ImutInfo::KeyOfValue(V), Key))
+        return &V;
+    return nullptr;
+  }
+
+  /// Returns the hash of \p Key, which is found by argument-dependent lookup
+  /// of hash_value() like for llvm::hash_combine().
+  static unsigned hashKey(key_type_ref Key) {
+    using llvm::hash_value;
+    return hash_value(Key);
+  }
+
+  void retain() { ++RefCount; }
+
+  void release() {
+    assert(RefCount > 0);
+    if (--RefCount == 0)
+      Factory->destroy(this);
+  }
+};
+
+/// Creates, hash-conses and recycles the nodes of hash array mapped tries.
+template <typename ImutInfo> class ImutHAMTFactory {
+public:
+  using NodeTy = ImutHAMTNode<ImutInfo>;
+  using value_type = typename ImutInfo::value_type;
+  using value_type_ref = typename ImutInfo::value_type_ref;
+  using key_type_ref = typename ImutInfo::key_type_ref;
+
+private:
+  friend NodeTy;
+
+  using StoredValueTy = typename NodeTy::StoredValueTy;
+
+  std::unique_ptr<llvm::BumpPtrAllocator> OwnedAllocator;
+  llvm::BumpPtrAllocator &Allocator;
+
+  /// A chained hash table of all live nodes, for hash-consing. The chains
+  /// are threaded through the nodes.
+  std::vector<NodeTy *> Buckets;
+  unsigned NumNodes = 0;
+
+  /// The memory of destroyed nodes, by size in units of the node alignment.
+  std::vector<llvm::SmallVector<void *, 8>> FreeNodes;
+
+  NodeTy *&getBucket(unsigned Hash) {
+    return Buckets[Hash & (Buckets.size() - 1)];
+  }
+
+  template <typename MatchFn> NodeTy *findNode(unsigned Hash, MatchFn Matches) {
+    if (Buckets.empty())
+      return nullptr;
+    for (NodeTy *N = getBucket(Hash); N; N = N->NextInBucket)
+      if (N->NodeHash == Hash && Matches(N))
+        return N;
+    return nullptr;
+  }
+
+  void insertNode(NodeTy *N) {
+    if (NumNodes >= Buckets.size()) {
+      std::vector<NodeTy *> Old(std::max<size_t>(64, Buckets.size() * 2));
+      std::swap(Old, Buckets);
+      for (NodeTy *Chain : Old) {
+        while (Chain) {
+          NodeTy *Next = Chain->NextInBucket;
+          NodeTy *&Bucket = getBucket(Chain->NodeHash);
+          Chain->NextInBucket = Bucket;
+          Bucket = Chain;
+          Chain = Next;
+        }
+      }
+    }
+    NodeTy *&Bucket = getBucket(N->NodeHash);
+    N->NextInBucket = Bucket;
+    Bucket = N;
+    ++NumNodes;
+  }
+
+  void removeNode(NodeTy *N) {
+    NodeTy **Link = &getBucket(N->NodeHash);
+    while (*Link != N)
+      Link = &(*Link)->NextInBucket;
+    *Link = N->NextInBucket;
+    --NumNodes;
+  }
+
+  static size_t getSizeClass(bool IsLeaf, unsigned NumItems) {
+    return llvm::alignTo(NodeTy::getAllocSize(IsLeaf, NumItems),
+                         alignof(NodeTy)) /
+           alignof(NodeTy);
+  }
+
+  void *allocate(bool IsLeaf, unsigned NumItems) {
+    size_t SizeClass = getSizeClass(IsLeaf, NumItems);
+    if (SizeClass < FreeNodes.size() && !FreeNodes[SizeClass].empty())
+      return FreeNodes[SizeClass].pop_back_val();
+    return Allocator.Allocate(SizeClass * alignof(NodeTy), alignof(NodeTy));
+  }
+
+  void destroy(NodeTy *N) {
+    removeNode(N);
+    if (N->IsLeaf) {
+      for (const StoredValueTy &V : N->values())
+        V.~StoredValueTy();
+    } else {
+      for (NodeTy *Child : N->children())
+        Child->release();
+    }
+    size_t SizeClass = getSizeClass(N->IsLeaf, N->NumItems);
+    N->~NodeTy();
+    if (SizeClass >= FreeNodes.size())
+      FreeNodes.resize(SizeClass + 1);
+    FreeNodes[SizeClass].push_back(N);
+  }
+
+  NodeTy *getBranch(unsigned Bits, llvm::ArrayRef<NodeTy *> Children) {
+    assert(!Children.empty() && Children.size() == llvm::countPopulation(Bits));
+    assert((Children.size() > 1 || !Children.front()->IsLeaf) &&
+           "A single leaf must not be wrapped into a branch");
+    unsigned Hash = NodeTy::hashBranch(Bits, Children);
+    if (NodeTy *N = findNode(Hash, [&](const NodeTy *N) {
+          return N->matchesBranch(Bits, Children);
+        }))
+      return N;
+
+    auto *N = new (allocate(/*IsLeaf=*/false, Children.size()))
+        NodeTy(this, /*IsLeaf=*/false, Bits, Children.size(), Hash);
+    NodeTy **Out = N->getChildrenBuffer();
+    for (NodeTy *Child : Children) {
+      Child->retain();
+      *Out++ = Child;
+    }
+    insertNode(N);
+    return N;
+  }
+
+  NodeTy *getLeaf(unsigned Hash, llvm::ArrayRef<const StoredValueTy *> Values) {
+    assert(!Values.empty());
+    unsigned NodeHash = NodeTy::hashLeaf(Hash, Values);
+    if (NodeTy *N = findNode(NodeHash, [&](const NodeTy *N) {
+          return N->matchesLeaf(Hash, Values);
+        }))
+      return N;
+
+    auto *N = new (allocate(/*IsLeaf=*/true, Values.size()))
+        NodeTy(this, /*IsLeaf=*/true, Hash, Values.size(), NodeHash);
+    StoredValueTy *Out = N->getValuesBuffer();
+    for (const StoredValueTy *V : Values)
+      new (Out++) StoredValueTy(*V);
+    insertNode(N);
+    return N;
+  }
+
+  /// Returns a trie with the entries of the leaves \p A and \p B, whose
+  /// hashes differ, below the given depth.
+  NodeTy *mergeLeaves(NodeTy *A, NodeTy *B, unsigned Shift) {
+    assert(A->Bits != B->Bits && Shift < 32);
+    unsigned ChunkA = (A->Bits >> Shift) & 31;
+    unsigned ChunkB = (B->Bits >> Shift) & 31;
+    if (ChunkA == ChunkB)
+      return getBranch(1U << ChunkA, mergeLeaves(A, B, Shift + 5));
+    if (ChunkA > ChunkB)
+      std::swap(A, B);
+    NodeTy *Children[] = {A, B};
+    return getBranch((1U << ChunkA) | (1U << ChunkB), Children);
+  }
+
+  NodeTy *insert(NodeTy *N, unsigned Shift, unsigned Hash, value_type_ref V) {
+    if (!N) {
+      const StoredValueTy *Values[] = {&V};
+      return getLeaf(Hash, Values);
+    }
+
+    if (N->IsLeaf) {
+      if (N->Bits != Hash) {
+        const StoredValueTy *Values[] = {&V};
+        return mergeLeaves(N, getLeaf(Hash, Values), Shift);
+      }
+
+      // Keep the entries of the leaf sorted by key.
+      llvm::SmallVector<const StoredValueTy *, 4> Values;
+      bool Inserted = false;
+      for (const StoredValueTy &Old : N->values()) {
+        if (!Inserted) {
+          if (ImutInfo::isEqual(ImutInfo::KeyOfValue(Old),
+                                ImutInfo::KeyOfValue(V))) {
+            if (ImutInfo::isDataEqual(ImutInfo::DataOfValue(Old),
+                                      ImutInfo::DataOfValue(V)))
+              return N;
+            Values.push_back(&V);
+            Inserted = true;
+            continue;
+          }
+          if (ImutInfo::isLess(ImutInfo::KeyOfValue(V),
+                               ImutInfo::KeyOfValue(Old))) {
+            Values.push_back(&V);
+            Inserted = true;
+          }
+        }
+        Values.push_back(&Old);
+      }
+      if (!Inserted)
+        Values.push_back(&V);
+      return getLeaf(Hash, Values);
+    }
+
+    unsigned Bit = 1U << ((Hash >> Shift) & 31);
+    unsigned Idx = llvm::countPopulation(N->Bits & (Bit - 1));
+    llvm::SmallVector<NodeTy *, 32> Children(N->children().begin(),
+                                             N->children().end());
+    if (N->Bits & Bit) {
+      NodeTy *Child = insert(Children[Idx], Shift + 5, Hash, V);
+      if (Child == Children[Idx])
+        return N;
+      Children[Idx] = Child;
+      return getBranch(N->Bits, Children);
+    }
+
+    const StoredValueTy *Values[] = {&V};
+    Children.insert(Children.begin() + Idx, getLeaf(Hash, Values));
+    return getBranch(N->Bits | Bit, Children);
+  }
+
+  NodeTy *erase(NodeTy *N, unsigned Shift, unsigned Hash, key_type_ref Key) {
+    if (!N)
+      return nullptr;
+
+    if (N->IsLeaf) {
+      if (N->Bits != Hash)
+        return N;
+      llvm::SmallVector<const StoredValueTy *, 4> Values;
+      for (const StoredValueTy &Old : N->values())
+        if (!ImutInfo::isEqual(ImutInfo::KeyOfValue(Old), Key))
+          Values.push_back(&Old);
+      if (Values.size() == N->NumItems)
+        return N;
+      return Values.empty() ? nullptr : getLeaf(Hash, Values);
+    }
+
+    unsigned Bit = 1U << ((Hash >> Shift) & 31);
+    if (!(N->Bits & Bit))
+      return N;
+    unsigned Idx = llvm::countPopulation(N->Bits & (Bit - 1));
+    llvm::SmallVector<NodeTy *, 32> Children(N->children().begin(),
+                                             N->children().end());
+    NodeTy *Child = erase(Children[Idx], Shift + 5, Hash, Key);
+    if (Child == Children[Idx])
+      return N;
+
+    unsigned Bits = N->Bits;
+    if (Child) {
+      Children[Idx] = Child;
+    } else {
+      Children.erase(Children.begin() + Idx);
+      Bits &= ~Bit;
+    }
+
+    // A branch holding nothing but a single leaf collapses into the leaf.
+    if (Children.empty())
+      return nullptr;
+    if (Children.size() == 1 && Children.front()->IsLeaf)
+      return Children.front();
+    return getBranch(Bits, Children);
+  }
+
+public:
+  ImutHAMTFactory()
+      : OwnedAllocator(new llvm::BumpPtrAllocator()),
+        Allocator(*OwnedAllocator) {}
+
+  ImutHAMTFactory(llvm::BumpPtrAllocator &Alloc) : Allocator(Alloc) {}
+
+  ImutHAMTFactory(const ImutHAMTFactory &) = delete;
+  ImutHAMTFactory &operator=(const ImutHAMTFactory &) = delete;
+
+  /// Returns the trie with the entries of \p Root and \p V, replacing the
+  /// entry with the same key, if any. The result is not retained.
+  NodeTy *add(NodeTy *Root, value_type_ref V) {
+    return insert(Root, 0, NodeTy::hashKey(ImutInfo::KeyOfValue(V)), V);
+  }
+
+  /// Returns the trie with the entries of \p Root except the one with the
+  /// given key. The result is not retained.
+  NodeTy *remove(NodeTy *Root, key_type_ref Key) {
+    return erase(Root, 0, NodeTy::hashKey(Key), Key);
+  }
+};
+
+/// Iterates over the entries of a hash array mapped trie, in the order of
+/// their hashes.
+template <typename ImutInfo> class ImutHAMTIterator {
+public:
+  using NodeTy = ImutHAMTNode<ImutInfo>;
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = typename ImutInfo::value_type;
+  using difference_type = std::ptrdiff_t;
+  using pointer = value_type *;
+  using reference = value_type &;
+
+private:
+  /// The path from the root to the current leaf, with the index of the
+  /// current child of each branch and of the current entry of the leaf.
+  llvm::SmallVector<std::pair<const NodeTy *, unsigned>, 8> Path;
+
+  void descend() {
+    while (!Path.back().first->IsLeaf) {
+      const NodeTy *Child = Path.back().first->children()[Path.back().second];
+      Path.push_back({Child, 0});
+    }
+  }
+
+public:
+  ImutHAMTIterator() = default;
+
+  explicit ImutHAMTIterator(const NodeTy *Root) {
+    if (Root) {
+      Path.push_back({Root, 0});
+      descend();
+    }
+  }
+
+  reference operator*() const {
+    return Path.back().first->values()[Path.back().second];
+  }
+
+  pointer operator->() const { return &**this; }
+
+  ImutHAMTIterator &operator++() {
+    assert(!Path.empty() && "Incrementing the end iterator");
+    while (!Path.empty()) {
+      if (++Path.back().second < Path.back().first->NumItems) {
+        descend();
+        return *this;
+      }
+      Path.pop_back();
+    }
+    return *this;
+  }
+
+  ImutHAMTIterator operator++(int) {
+    ImutHAMTIterator Tmp = *this;
+    ++*this;
+    return Tmp;
+  }
+
+  bool operator==(const ImutHAMTIterator &RHS) const {
+    if (Path.empty() || RHS.Path.empty())
+      return Path.empty() == RHS.Path.empty();
+    return Path.back() == RHS.Path.back();
+  }
+
+  bool operator!=(const ImutHAMTIterator &RHS) const { return !(*this == RHS); }
+};
+
+/// A persistent map with the interface of llvm::ImmutableMap, implemented as
+/// a hash-consed hash array mapped trie.
+///
+/// Lookups, insertions and removals take time proportional to the depth of
+/// the trie, which grows by one level for every 32-fold increase in size, and
+/// an insertion only allocates the nodes on the path to the new entry.
+/// Because equal maps share their root, comparing and profiling maps is
+/// constant time. Entries are iterated in the order of the hashes of their
+/// keys rather than in key order.
+template <typename KeyT, typename ValT,
+          typename ValInfo = llvm::ImutKeyValueInfo<KeyT, ValT>>
+class ImmutableHashMap {
+public:
+  using value_type = typename ValInfo::value_type;
+  using value_type_ref = typename ValInfo::value_type_ref;
+  using key_type = typename ValInfo::key_type;
+  using key_type_ref = typename ValInfo::key_type_ref;
+  using data_type = typename ValInfo::data_type;
+  using data_type_ref = typename ValInfo::data_type_ref;
+  using TreeTy = ImutHAMTNode<ValInfo>;
+
+protected:
+  TreeTy *Root;
+
+public:
+  /// Constructs a map from a pointer to a trie root. In general one should use
+  /// a Factory object to create maps instead of directly invoking the
+  /// constructor, but there are cases where making a map from a root pointer
+  /// is useful, e.g. when it is stored as a void pointer.
+  explicit ImmutableHashMap(const TreeTy *R) : Root(const_cast<TreeTy *>(R)) {
+    if (Root)
+      Root->retain();
+  }
+
+  ImmutableHashMap(const ImmutableHashMap &X) : Root(X.Root) {
+    if (Root)
+      Root->retain();
+  }
+
+  ~ImmutableHashMap() {
+    if (Root)
+      Root->release();
+  }
+
+  ImmutableHashMap &operator=(const ImmutableHashMap &X) {
+    if (Root != X.Root) {
+      if (X.Root)
+        X.Root->retain();
+      if (Root)
+        Root->release();
+      Root = X.Root;
+    }
+    return *this;
+  }
+
+  class Factory {
+    ImutHAMTFactory<ValInfo> F;
+
+  public:
+    Factory() = default;
+    Factory(llvm::BumpPtrAllocator &Alloc) : F(Alloc) {}
+
+    Factory(const Factory &) = delete;
+    Factory &operator=(const Factory &) = delete;
+
+    ImmutableHashMap getEmptyMap() { return ImmutableHashMap(nullptr); }
+
+    LLVM_NODISCARD ImmutableHashMap add(ImmutableHashMap Old, key_type_ref K,
+                                        data_type_ref D) {
+      return ImmutableHashMap(F.add(Old.Root, value_type(K, D)));
+    }
+
+    LLVM_NODISCARD ImmutableHashMap remove(ImmutableHashMap Old,
+                                           key_type_ref K) {
+      return ImmutableHashMap(F.remove(Old.Root, K));
+    }
+  };
+
+  bool contains(key_type_ref K) const { return lookup(K) != nullptr; }
+
+  /// Returns the data of \p K, or null if it is not in the map.
+  data_type *lookup(key_type_ref K) const {
+    if (const value_type *V = TreeTy::lookup(Root, K))
+      return &ValInfo::DataOfValue(*V);
+    return nullptr;
+  }
+
+  bool operator==(const ImmutableHashMap &RHS) const {
+    return Root == RHS.Root;
+  }
+
+  bool operator!=(const ImmutableHashMap &RHS) const {
+    return Root != RHS.Root;
+  }
+
+  TreeTy *getRoot() const {
+    if (Root)
+      Root->retain();
+    return Root;
+  }
+
+  TreeTy *getRootWithoutRetain() const { return Root; }
+
+  void manualRetain() {
+    if (Root)
+      Root->retain();
+  }
+
+  void manualRelease() {
+    if (Root)
+      Root->release();
+  }
+
+  bool isEmpty() const { return !Root; }
+
+  class iterator : public ImutHAMTIterator<ValInfo> {
+    friend class ImmutableHashMap;
+
+    iterator() = default;
+    explicit iterator(const TreeTy *Root) : ImutHAMTIterator<ValInfo>(Root) {}
+
+  public:
+    key_type_ref getKey() const { return (*this)->first; }
+    data_type_ref getData() const { return (*this)->second; }
+  };
+
+  iterator begin() const { return iterator(Root); }
+  iterator end() const { return iterator(); }
+
+  static void Profile(llvm::FoldingSetNodeID &ID, const ImmutableHashMap &M) {
+    ID.AddPointer(M.Root);
+  }
+
+  void Profile(llvm::FoldingSetNodeID &ID) const { return Profile(ID, *this); }
+};
+
+} // namespace ento
+} // namespace clang
+
+#endif // LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_IMMUTABLEHASHMAP_H
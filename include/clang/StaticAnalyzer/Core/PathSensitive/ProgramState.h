@@ -14,9 +14,11 @@
 #define LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_PROGRAMSTATE_H
 
 #include "clang/Basic/LLVM.h"
+#include "clang/Config/config.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ConstraintManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/DynamicTypeInfo.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/Environment.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/ImmutableHashMap.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramState_Fwd.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SValBuilder.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/Store.h"
@@ -72,7 +74,11 @@ template <typename T> struct ProgramStateTrait {
 class ProgramState : public llvm::FoldingSetNode {
 public:
   typedef llvm::ImmutableSet<llvm::APSInt*>                IntSetTy;
+#if CLANG_ANALYZER_HASH_TRIE_STATE
+  typedef ImmutableHashMap<void*, void*>                   GenericDataMap;
+#else
   typedef llvm::ImmutableMap<void*, void*>                 GenericDataMap;
+#endif
 
 private:
   void operator=(const ProgramState& R) = delete;
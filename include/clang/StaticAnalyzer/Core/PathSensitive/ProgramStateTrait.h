@@ -16,6 +16,7 @@
 #ifndef LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_PROGRAMSTATETRAIT_H
 #define LLVM_CLANG_STATICANALYZER_CORE_PATHSENSITIVE_PROGRAMSTATETRAIT_H
 
+#include "clang/StaticAnalyzer/Core/PathSensitive/ImmutableHashMap.h"
 #include "llvm/ADT/ImmutableList.h"
 #include "llvm/ADT/ImmutableMap.h"
 #include "llvm/ADT/ImmutableSet.h"
@@ -94,6 +95,29 @@ namespace ento {
     REGISTER_FACTORY_WITH_PROGRAMSTATE(Name)
 
 
+  /// Helper for registering a hash map trait, see CLANG_ENTO_PROGRAMSTATE_MAP.
+  #define CLANG_ENTO_PROGRAMSTATE_HASHMAP(Key, Value) \
+    clang::ento::ImmutableHashMap<Key, Value>
+
+  /// Declares an immutable map of type \p NameTy, suitable for placement into
+  /// the ProgramState. This is implemented using ImmutableHashMap, which makes
+  /// updates of large maps cheaper than with llvm::ImmutableMap, but iterates
+  /// over the entries in hash order rather than in key order. The key type
+  /// must provide a hash_value() overload.
+  ///
+  /// \code
+  /// State = State->set<Name>(K, V);
+  /// const Value *V = State->get<Name>(K); // Returns NULL if not in the map.
+  /// State = State->remove<Name>(K);
+  /// NameTy Map = State->get<Name>();
+  /// \endcode
+  ///
+  /// The macro should not be used inside namespaces, or for traits that must
+  /// be accessible from more than one translation unit.
+  #define REGISTER_HASHMAP_WITH_PROGRAMSTATE(Name, Key, Value) \
+    REGISTER_TRAIT_WITH_PROGRAMSTATE(Name, \
+                                     CLANG_ENTO_PROGRAMSTATE_HASHMAP(Key, Value))
+
   /// Declares an immutable set of type \p NameTy, suitable for placement into
   /// the ProgramState. This is implementing using llvm::ImmutableSet.
   ///
@@ -189,6 +213,54 @@ namespace ento {
     }
   };
 
+  // Partial-specialization for ImmutableHashMap.
+  template <typename Key, typename Data, typename Info>
+  struct ProgramStatePartialTrait<ImmutableHashMap<Key, Data, Info>> {
+    using data_type = ImmutableHashMap<Key, Data, Info>;
+    using context_type = typename data_type::Factory &;
+    using key_type = Key;
+    using value_type = Data;
+    using lookup_type = const value_type *;
+
+    static data_type MakeData(void *const *p) {
+      return p ? data_type((typename data_type::TreeTy *) *p)
+               : data_type(nullptr);
+    }
+
+    static void *MakeVoidPtr(data_type B) {
+      return B.getRoot();
+    }
+
+    static lookup_type Lookup(data_type B, key_type K) {
+      return B.lookup(K);
+    }
+
+    static data_type Set(data_type B, key_type K, value_type E,
+                         context_type F) {
+      return F.add(B, K, E);
+    }
+
+    static data_type Remove(data_type B, key_type K, context_type F) {
+      return F.remove(B, K);
+    }
+
+    static bool Contains(data_type B, key_type K) {
+      return B.contains(K);
+    }
+
+    static context_type MakeContext(void *p) {
+      return *((typename data_type::Factory *) p);
+    }
+
+    static void *CreateContext(llvm::BumpPtrAllocator& Alloc) {
+      return new typename data_type::Factory(Alloc);
+    }
+
+    static void DeleteContext(void *Ctx) {
+      delete (typename data_type::Factory *) Ctx;
+    }
+  };
+
   // Partial-specialization for ImmutableSet.
   template <typename Key, typename Info>
   struct ProgramStatePartialTrait<llvm::ImmutableSet<Key, Info>> {
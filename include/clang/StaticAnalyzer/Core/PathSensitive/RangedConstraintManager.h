@@ -16,6 +16,11 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramState.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SimpleConstraintManager.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Allocator.h"
 
 namespace clang {
 
@@ -31,7 +36,19 @@ public:
     assert(from <= to);
   }
   bool Includes(const llvm::APSInt &v) const {
-    return *first <= v && v <= *second;
+    return !isLess(v, *first) && !isLess(*second, v);
+  }
+
+  /// Compares two values of the same type. Values of up to 64 bits, which
+  /// is nearly all of them, are compared inline rather than through the
+  /// out-of-line APInt comparison.
+  static bool isLess(const llvm::APSInt &LHS, const llvm::APSInt &RHS) {
+    assert(LHS.getBitWidth() == RHS.getBitWidth() &&
+           LHS.isSigned() == RHS.isSigned() && "Comparing different types");
+    if (LHS.getBitWidth() > 64)
+      return LHS < RHS;
+    return LHS.isSigned() ? LHS.getSExtValue() < RHS.getSExtValue()
+                          : LHS.getZExtValue() < RHS.getZExtValue();
   }
   const llvm::APSInt &From() const { return *first; }
   const llvm::APSInt &To() const { return *second; }
@@ -45,66 +62,109 @@ public:
   }
 };
 
-class RangeTrait : public llvm::ImutContainerInfo<Range> {
-public:
-  // When comparing if one Range is less than another, we should compare
-  // the actual APSInt values instead of their pointers.  This keeps the order
-  // consistent (instead of comparing by pointer values) and can potentially
-  // be used to speed up some of the operations in RangeSet.
-  static inline bool isLess(key_type_ref lhs, key_type_ref rhs) {
-    return *lhs.first < *rhs.first ||
-           (!(*rhs.first < *lhs.first) && *lhs.second < *rhs.second);
-  }
-};
-
 /// RangeSet contains a set of ranges. If the set is empty, then
 ///  there the value of a symbol is overly constrained and there are no
 ///  possible values for that symbol.
+///
+/// The ranges of a non-empty set are kept in a sorted array which is uniqued
+/// by the factory, so that equal sets share their storage and can be compared
+/// by pointer.
 class RangeSet {
-  typedef llvm::ImmutableSet<Range, RangeTrait> PrimRangeSet;
-  PrimRangeSet ranges; // no need to make const, since it is an
-                       // ImmutableSet - this allows default operator=
-                       // to work.
+  /// The sorted, uniqued array of the ranges of a non-empty set.
+  class Storage {
+    const Range *Ranges;
+    unsigned Size;
+    unsigned Hash;
+
+  public:
+    Storage(const Range *Ranges, unsigned Size)
+        : Ranges(Ranges), Size(Size), Hash(getHash(ranges())) {}
+
+    ArrayRef<Range> ranges() const { return llvm::makeArrayRef(Ranges, Size); }
+    const Range *begin() const { return Ranges; }
+    const Range *end() const { return Ranges + Size; }
+    unsigned size() const { return Size; }
+    unsigned getHash() const { return Hash; }
+
+    static unsigned getHash(ArrayRef<Range> Ranges) {
+      llvm::hash_code H = llvm::hash_value(Ranges.size());
+      for (const Range &R : Ranges)
+        H = llvm::hash_combine(H, &R.From(), &R.To());
+      return H;
+    }
+  };
+
+  /// Looks the uniqued arrays up by their contents, comparing the bounds by
+  /// address as the values are themselves uniqued by BasicValueFactory.
+  struct StorageInfo {
+    static const Storage *getEmptyKey() {
+      return llvm::DenseMapInfo<const Storage *>::getEmptyKey();
+    }
+    static const Storage *getTombstoneKey() {
+      return llvm::DenseMapInfo<const Storage *>::getTombstoneKey();
+    }
+    static unsigned getHashValue(const Storage *S) { return S->getHash(); }
+    static unsigned getHashValue(ArrayRef<Range> Ranges) {
+      return Storage::getHash(Ranges);
+    }
+    static bool isEqual(const Storage *LHS, const Storage *RHS) {
+      return LHS == RHS;
+    }
+    static bool isEqual(ArrayRef<Range> LHS, const Storage *RHS) {
+      if (RHS == getEmptyKey() || RHS == getTombstoneKey())
+        return false;
+      return LHS == RHS->ranges();
+    }
+  };
+
+  const Storage *Impl;
+
+  explicit RangeSet(const Storage *Impl) : Impl(Impl) {}
+
 public:
-  typedef PrimRangeSet::Factory Factory;
-  typedef PrimRangeSet::iterator iterator;
+  class Factory {
+    llvm::BumpPtrAllocator Alloc;
+    llvm::DenseSet<const Storage *, StorageInfo> Cache;
+
+  public:
+    RangeSet getEmptySet() { return RangeSet(nullptr); }
 
-  RangeSet(PrimRangeSet RS) : ranges(RS) {}
+    /// Return the set of the ranges \p Ranges, which do not overlap.
+    RangeSet getRangeSet(ArrayRef<Range> Ranges);
+  };
+
+  typedef const Range *iterator;
 
   /// Create a new set with all ranges of this set and RS.
   /// Possible intersections are not checked here.
-  RangeSet addRange(Factory &F, const RangeSet &RS) {
-    PrimRangeSet Ranges(RS.ranges);
-    for (const auto &range : ranges)
-      Ranges = F.add(Ranges, range);
-    return RangeSet(Ranges);
-  }
+  RangeSet addRange(Factory &F, const RangeSet &RS);
 
-  iterator begin() const { return ranges.begin(); }
-  iterator end() const { return ranges.end(); }
+  iterator begin() const { return Impl ? Impl->begin() : nullptr; }
+  iterator end() const { return Impl ? Impl->end() : nullptr; }
 
-  bool isEmpty() const { return ranges.isEmpty(); }
+  bool isEmpty() const { return !Impl; }
 
   /// Construct a new RangeSet representing '{ [from, to] }'.
   RangeSet(Factory &F, const llvm::APSInt &from, const llvm::APSInt &to)
-      : ranges(F.add(F.getEmptySet(), Range(from, to))) {}
+      : RangeSet(F.getRangeSet(Range(from, to))) {}
 
   /// Profile - Generates a hash profile of this RangeSet for use
   ///  by FoldingSet.
-  void Profile(llvm::FoldingSetNodeID &ID) const { ranges.Profile(ID); }
+  void Profile(llvm::FoldingSetNodeID &ID) const { ID.AddPointer(Impl); }
 
   /// getConcreteValue - If a symbol is contrained to equal a specific integer
   ///  constant then this method returns that value.  Otherwise, it returns
   ///  NULL.
   const llvm::APSInt *getConcreteValue() const {
-    return ranges.isSingleton() ? ranges.begin()->getConcreteValue() : nullptr;
+    return Impl && Impl->size() == 1 ? Impl->begin()->getConcreteValue()
+                                     : nullptr;
   }
 
 private:
-  void IntersectInRange(BasicValueFactory &BV, Factory &F,
-                        const llvm::APSInt &Lower, const llvm::APSInt &Upper,
-                        PrimRangeSet &newRanges, PrimRangeSet::iterator &i,
-                        PrimRangeSet::iterator &e) const;
+  void IntersectInRange(BasicValueFactory &BV, const llvm::APSInt &Lower,
+                        const llvm::APSInt &Upper,
+                        SmallVectorImpl<Range> &newRanges, iterator &i,
+                        iterator e) const;
 
   const llvm::APSInt &getMinValue() const;
 
@@ -120,7 +180,7 @@ public:
   void print(raw_ostream &os) const;
 
   bool operator==(const RangeSet &other) const {
-    return ranges == other.ranges;
+    return Impl == other.Impl;
   }
 };
 
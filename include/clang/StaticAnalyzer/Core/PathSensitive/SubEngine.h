@@ -169,6 +169,18 @@ public:
   /// Called by CoreEngine when the analysis worklist is either empty or the
   //  maximum number of analysis steps have been reached.
   virtual void processEndWorklist() = 0;
+
+  /// Called by CoreEngine before it compacts the ExplodedGraph to collect the
+  /// nodes that the subengine still refers to, such as the error nodes of bug
+  /// reports that have not been flushed yet. The nodes in \p Subgraphs are
+  /// kept together with all their successors.
+  virtual void
+  collectLiveNodes(SmallVectorImpl<const ExplodedNode *> &Nodes,
+                   SmallVectorImpl<const ExplodedNode *> &Subgraphs) = 0;
+
+  /// Returns false if the ExplodedGraph must not be compacted, e.g. because
+  /// it is inspected as a whole at the end of the analysis.
+  virtual bool canCompactGraph() const = 0;
 };
 
 } // end GR namespace
@@ -16,6 +16,7 @@
 
 #include "clang/StaticAnalyzer/Core/PathSensitive/BlockCounter.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExplodedGraph.h"
+#include "llvm/ADT/STLExtras.h"
 #include <cassert>
 
 namespace clang {
@@ -76,6 +77,10 @@ public:
 
   virtual WorkListUnit dequeue() = 0;
 
+  /// Calls \p Fn on every unit that is still pending, in no particular order.
+  virtual void
+  visitUnits(llvm::function_ref<void(const WorkListUnit &)> Fn) const = 0;
+
   void setBlockCounter(BlockCounter C) { CurrentCounter = C; }
   BlockCounter getBlockCounter() const { return CurrentCounter; }
 
@@ -85,6 +90,10 @@ public:
   static std::unique_ptr<WorkList> makeUnexploredFirst();
   static std::unique_ptr<WorkList> makeUnexploredFirstPriorityQueue();
   static std::unique_ptr<WorkList> makeUnexploredFirstPriorityLocationQueue();
+
+  /// Prefers the nodes entering basic blocks that were not covered yet, and
+  /// postpones the ones entering blocks that their path already entered.
+  static std::unique_ptr<WorkList> makeCoverageGuidedQueue();
 };
 
 } // end ento namespace
@@ -9,6 +9,10 @@
 //  This file defines a tool executor that runs given actions on all TUs in the
 //  compilation database. Tool results are deuplicated by the result key.
 //
+//  Files are scheduled largest-first, using the processing times recorded by a
+//  previous run when available and the file sizes otherwise, so that the
+//  slowest translation units do not end up at the tail of the run.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_CLANG_TOOLING_ALLTUSEXECUTION_H
@@ -16,6 +20,7 @@
 
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/Execution.h"
+#include <functional>
 
 namespace clang {
 namespace tooling {
@@ -59,6 +64,15 @@ public:
     OverlayFiles[FilePath] = Content;
   }
 
+  using ResultConsumer = std::function<void(StringRef Key, StringRef Value)>;
+
+  /// Streams the tool results to \p Consumer as soon as they are reported
+  /// instead of keeping them in memory until all files have been processed.
+  /// Calls to \p Consumer are serialized. Once a consumer is set,
+  /// `getToolResults` no longer collects any result, which bounds the memory
+  /// used by runs over large compilation databases.
+  void setResultConsumer(ResultConsumer Consumer);
+
 private:
   // Used to store the parser when the executor is initialized with parser.
   llvm::Optional<CommonOptionsParser> OptionsParser;
@@ -71,6 +85,8 @@ private:
 
 extern llvm::cl::opt<unsigned> ExecutorConcurrency;
 extern llvm::cl::opt<std::string> Filter;
+extern llvm::cl::opt<std::string> ExecutorTimingsFile;
+extern llvm::cl::opt<bool> ExecutorSharePreambles;
 
 } // end namespace tooling
 } // end namespace clang
@@ -16,12 +16,46 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include <atomic>
 #include <mutex>
 
 namespace clang {
 namespace tooling {
 namespace dependencies {
 
+/// An on-disk cache of minimized sources and their skipped PP range mappings,
+/// keyed by a hash of the original contents. It lets separate scans, possibly
+/// run by separate processes at the same time, reuse the minimization work of
+/// each other.
+///
+/// Entries are written to a temporary file that is renamed into place, so a
+/// reader never sees a partially written entry.
+class MinimizedSourceDiskCache {
+public:
+  /// Creates a cache in the directory \p Path, which is created if needed.
+  explicit MinimizedSourceDiskCache(StringRef Path);
+
+  /// Loads the minimized form of \p Contents and its skipped range mapping.
+  ///
+  /// \returns True if the cache has a valid entry for \p Contents.
+  bool lookup(StringRef Contents, SmallVectorImpl<char> &MinimizedContents,
+              PreprocessorSkippedRangeMapping &Mapping);
+
+  /// Stores the minimized form of \p Contents and its skipped range mapping.
+  /// Failing to write the entry is not an error, it's just not cached.
+  void store(StringRef Contents, StringRef MinimizedContents,
+             const PreprocessorSkippedRangeMapping &Mapping);
+
+  /// \returns The number of successful lookups.
+  unsigned getNumHits() const { return NumHits; }
+
+private:
+  void getEntryPath(StringRef Contents, SmallVectorImpl<char> &EntryPath) const;
+
+  std::string Path;
+  std::atomic<unsigned> NumHits{0};
+};
+
 /// An in-memory representation of a file system entity that is of interest to
 /// the dependency scanning filesystem.
 ///
@@ -46,9 +80,17 @@ public:
   /// mismatching size of the file. If file is not minimized, the full file is
   /// read and copied into memory to ensure that it's not memory mapped to avoid
   /// running out of file descriptors.
-  static CachedFileSystemEntry createFileEntry(StringRef Filename,
-                                               llvm::vfs::FileSystem &FS,
-                                               bool Minimize = true);
+  ///
+  /// If minimization was requested but failed, the original contents are used
+  /// and the reason is stored in \p MinimizationError when it's provided.
+  ///
+  /// If \p DiskCache is provided, it's consulted before minimizing the file
+  /// and it's updated with the result of the minimization.
+  static CachedFileSystemEntry
+  createFileEntry(StringRef Filename, llvm::vfs::FileSystem &FS,
+                  bool Minimize = true,
+                  std::string *MinimizationError = nullptr,
+                  MinimizedSourceDiskCache *DiskCache = nullptr);
 
   /// Create an entry that represents a directory on the filesystem.
   static CachedFileSystemEntry createDirectoryEntry(llvm::vfs::Status &&Stat);
@@ -106,11 +148,17 @@ private:
 /// underlying real file system.
 ///
 /// It is sharded based on the hash of the key to reduce the lock contention for
-/// the worker threads.
+/// the worker threads. The shard lock is only held to find or insert an entry;
+/// each entry is populated exactly once under its own lock, and read without
+/// any lock afterwards.
 class DependencyScanningFilesystemSharedCache {
 public:
   struct SharedFileSystemEntry {
     std::mutex ValueLock;
+    /// Set once \c Value has been populated. A populated value doesn't change
+    /// until the entry is invalidated, so it can be read without taking
+    /// \c ValueLock.
+    std::atomic<bool> IsPopulated{false};
     CachedFileSystemEntry Value;
   };
 
@@ -122,6 +170,40 @@ public:
   /// thread safe call.
   SharedFileSystemEntry &get(StringRef Key);
 
+  /// Records the result of minimizing \p Filename. An empty \p Error means
+  /// the file was minimized, otherwise the file fell back to its original
+  /// contents for the given reason. This is a thread safe call.
+  void noteMinimizationResult(StringRef Filename, StringRef Error);
+
+  /// Prints the number of minimized files, followed by every file that fell
+  /// back to its original contents and the reason why.
+  void printMinimizationStats(raw_ostream &OS) const;
+
+  /// Resets every populated entry for which \p ShouldInvalidate returns true,
+  /// so that it's read from the underlying file system again the next time
+  /// it's requested.
+  ///
+  /// This lets a long-lived service keep the cache across scans when some of
+  /// the files change. It must not be called while any worker is scanning,
+  /// and every worker drops its references to the entries before it scans
+  /// again.
+  void invalidate(llvm::function_ref<bool(StringRef Key,
+                                          const CachedFileSystemEntry &Entry)>
+                      ShouldInvalidate);
+
+  /// \returns A number that changes every time entries are invalidated. The
+  /// workers use it to know when their local caches went stale.
+  unsigned getGeneration() const { return Generation; }
+
+  /// Uses an on-disk cache in \p Path for the minimized sources, in addition
+  /// to this in-memory cache. Must be called before any worker starts.
+  void setDiskCachePath(StringRef Path) {
+    DiskCache = std::make_unique<MinimizedSourceDiskCache>(Path);
+  }
+
+  /// \returns The on-disk cache of minimized sources, or null if none is used.
+  MinimizedSourceDiskCache *getDiskCache() { return DiskCache.get(); }
+
 private:
   struct CacheShard {
     std::mutex CacheLock;
@@ -129,6 +211,13 @@ private:
   };
   std::unique_ptr<CacheShard[]> CacheShards;
   unsigned NumShards;
+
+  std::unique_ptr<MinimizedSourceDiskCache> DiskCache;
+  std::atomic<unsigned> Generation{0};
+  std::atomic<unsigned> NumMinimizedFiles{0};
+  mutable std::mutex MinimizationFallbacksLock;
+  /// The files that failed minimization, paired with the reason.
+  std::vector<std::pair<std::string, std::string>> MinimizationFallbacks;
 };
 
 /// A virtual file system optimized for the dependency discovery.
@@ -156,6 +245,11 @@ public:
   /// The set of files that should not be minimized.
   llvm::StringSet<> IgnoredFiles;
 
+  /// Drops the entries cached by this worker, which point into the shared
+  /// cache. Must be called once the shared cache was invalidated, before this
+  /// file system is used again.
+  void clearLocalCache() { Cache.clear(); }
+
 private:
   void setCachedEntry(StringRef Filename, const CachedFileSystemEntry *Entry) {
     bool IsInserted = Cache.try_emplace(Filename, Entry).second;
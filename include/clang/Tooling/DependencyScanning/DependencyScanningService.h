@@ -40,6 +40,11 @@ enum class ScanningOutputFormat {
   /// This outputs the full module dependency graph suitable for use for
   /// explicitly building modules.
   Full,
+
+  /// This outputs a single module graph for all the translation units, in
+  /// which identical modules are deduplicated and every module comes with the
+  /// command line that builds it explicitly.
+  ModuleGraph,
 };
 
 /// The dependency scanning service contains the shared state that is used by
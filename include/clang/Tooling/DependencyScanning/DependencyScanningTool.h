@@ -18,6 +18,20 @@ namespace clang{
 namespace tooling{
 namespace dependencies{
 
+/// The full dependencies of a translation unit, including the modules it
+/// depends on.
+struct FullDependencies {
+  std::string ContextHash;
+  /// The files that the translation unit depends on, without the files that
+  /// belong to modules.
+  std::vector<std::string> FileDeps;
+  /// The names of the modules that the translation unit imports directly.
+  std::vector<std::string> ClangModuleDeps;
+  /// Every module that the translation unit depends on, directly or not,
+  /// sorted by name.
+  std::vector<ModuleDeps> DiscoveredModules;
+};
+
 /// The high-level implementation of the dependency discovery tool that runs on
 /// an individual worker thread.
 class DependencyScanningTool {
@@ -29,11 +43,25 @@ public:
   /// file format that is specified in the options (-MD is the default) and
   /// return it.
   ///
+  /// If \p FileDeps is provided, it's filled with every file that the
+  /// translation unit depends on, including the files of the modules it
+  /// imports, as spelled by the preprocessor.
+  ///
   /// \returns A \c StringError with the diagnostic output if clang errors
   /// occurred, dependency file contents otherwise.
   llvm::Expected<std::string>
   getDependencyFile(const tooling::CompilationDatabase &Compilations,
-                    StringRef CWD);
+                    StringRef CWD,
+                    std::vector<std::string> *FileDeps = nullptr);
+
+  /// Collect the full dependencies of the translation unit, including the
+  /// modules it depends on and the command lines that build them.
+  ///
+  /// \returns A \c StringError with the diagnostic output if clang errors
+  /// occurred, the full dependencies otherwise.
+  llvm::Expected<FullDependencies>
+  getFullDependencies(const tooling::CompilationDatabase &Compilations,
+                      StringRef CWD);
 
 private:
   const ScanningOutputFormat Format;
@@ -76,6 +76,11 @@ private:
   /// The file manager that is reused accross multiple invocations by this
   /// worker. If null, the file manager will not be reused.
   llvm::IntrusiveRefCntPtr<FileManager> Files;
+  /// The shared cache generation that this worker has seen. The local caches,
+  /// the skip mappings and the reused file manager are dropped when the
+  /// shared cache is invalidated, as they may refer to stale entries.
+  unsigned SharedCacheGeneration;
+  DependencyScanningFilesystemSharedCache &SharedCache;
   ScanningOutputFormat Format;
 };
 
@@ -36,6 +36,20 @@ struct ModuleDeps {
   llvm::StringSet<> FileDeps;
   llvm::StringSet<> ClangModuleDeps;
   bool ImportedByMainFile = false;
+
+  /// The driver command line that builds this module explicitly, without the
+  /// module files of its dependencies and without the output. It's derived
+  /// from the command line of the translation unit that discovered the module
+  /// by dropping everything that is specific to the translation unit.
+  std::vector<std::string> NonPathCommandLine;
+
+  /// Gets the full driver command line that builds this module explicitly.
+  ///
+  /// \param LookupPCMPath Returns the path of the module file of the given
+  /// module, which has the same context hash as this one.
+  std::vector<std::string> getFullCommandLine(
+      llvm::function_ref<std::string(StringRef ModuleName)> LookupPCMPath)
+      const;
 };
 
 class ModuleDepCollector;
@@ -71,7 +85,10 @@ private:
 
 class ModuleDepCollector final : public DependencyCollector {
 public:
-  ModuleDepCollector(CompilerInstance &I, DependencyConsumer &C);
+  /// \param TUCommandLine The driver command line of the translation unit,
+  /// used to derive the command lines that build the modules.
+  ModuleDepCollector(CompilerInstance &I, DependencyConsumer &C,
+                     ArrayRef<std::string> TUCommandLine);
 
   void attachToPreprocessor(Preprocessor &PP) override;
   void attachToASTReader(ASTReader &R) override;
@@ -83,6 +100,8 @@ private:
   DependencyConsumer &Consumer;
   std::string MainFile;
   std::string ContextHash;
+  /// The arguments shared by the command lines of all the modules.
+  std::vector<std::string> ModuleCommandLine;
   std::vector<std::string> MainDeps;
   std::unordered_map<std::string, ModuleDeps> Deps;
 };
@@ -24,6 +24,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/YAMLParser.h"
 #include <memory>
+#include <mutex>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -93,6 +94,8 @@ public:
   std::vector<CompileCommand> getAllCompileCommands() const override;
 
 private:
+  friend class IndexedJSONCompilationDatabase;
+
   /// Constructs a JSON compilation database on a memory buffer.
   JSONCompilationDatabase(std::unique_ptr<llvm::MemoryBuffer> Database,
                           JSONCommandLineSyntax Syntax)
@@ -136,6 +139,75 @@ private:
   llvm::yaml::Stream YAMLStream;
 };
 
+/// A JSON compilation database that only parses the entries it is queried
+/// for.
+///
+/// It relies on a binary index stored next to the database, in
+/// `<database>.idx`, that maps the file paths to the byte ranges of their
+/// entries in the database. The index is built the first time the database is
+/// loaded, and rebuilt whenever the database changes. It is mapped in memory by
+/// the following loads, which therefore neither read nor parse the entire
+/// database.
+///
+/// The JSON compilation database plugin only uses this class with
+/// -index-compilation-database, since it writes next to the database.
+class IndexedJSONCompilationDatabase : public CompilationDatabase {
+public:
+  /// Loads the JSON compilation database from the specified file, using its
+  /// index or building it if it is missing or out of date.
+  ///
+  /// Returns NULL and sets ErrorMessage if the database could not be
+  /// loaded from the given file.
+  static std::unique_ptr<IndexedJSONCompilationDatabase>
+  loadFromFile(StringRef FilePath, std::string &ErrorMessage,
+               JSONCommandLineSyntax Syntax);
+
+  /// Returns the path of the index of the database at \p DatabasePath.
+  static std::string getIndexPath(StringRef DatabasePath);
+
+  std::vector<CompileCommand>
+  getCompileCommands(StringRef FilePath) const override;
+
+  std::vector<std::string> getAllFiles() const override;
+
+  /// Returns all compile commands for all the files in the compilation
+  /// database. This parses the entire database.
+  std::vector<CompileCommand> getAllCompileCommands() const override;
+
+private:
+  IndexedJSONCompilationDatabase(StringRef DatabasePath,
+                                 JSONCommandLineSyntax Syntax)
+      : DatabasePath(DatabasePath), Syntax(Syntax) {}
+
+  /// Maps the index if it matches the current contents of the database.
+  bool loadIndex(uint64_t DatabaseSize, uint64_t DatabaseModTime);
+
+  /// Builds the index from the database and tries to save it.
+  ///
+  /// Returns whether indexing succeeded. Sets ErrorMessage if indexing
+  /// failed.
+  bool buildIndex(uint64_t DatabaseSize, uint64_t DatabaseModTime,
+                  std::string &ErrorMessage);
+
+  /// Returns the index entries of the file path \p NativeFilePath, spelled as
+  /// in the index.
+  std::pair<uint32_t, uint32_t> findEntries(StringRef NativeFilePath) const;
+
+  /// The number of index entries, sorted by file path.
+  uint32_t getNumEntries() const;
+  StringRef getEntryFile(uint32_t I) const;
+  std::pair<uint64_t, uint64_t> getEntryRange(uint32_t I) const;
+
+  std::string DatabasePath;
+  JSONCommandLineSyntax Syntax;
+  std::unique_ptr<llvm::MemoryBuffer> Index;
+
+  /// Matches the paths which are not spelled as in the index, e.g. through
+  /// symlinks, like JSONCompilationDatabase does. Only built when needed.
+  mutable std::once_flag MatchTrieFlag;
+  mutable FileMatchTrie MatchTrie;
+};
+
 } // namespace tooling
 } // namespace clang
 
@@ -0,0 +1,100 @@
+//===--- SharedPreambleCache.h - Preambles shared between TUs ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines a cache of precompiled preambles that tools processing
+//  many translation units in one process can use to parse the headers shared
+//  by those translation units only once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLING_SHAREDPREAMBLECACHE_H
+#define LLVM_CLANG_TOOLING_SHAREDPREAMBLECACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Frontend/PCHContainerOperations.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace clang {
+
+class CompilerInvocation;
+class DiagnosticConsumer;
+
+namespace tooling {
+
+/// Builds and reuses precompiled preambles for the translation units that
+/// start with the same preamble and are compiled with the same flags.
+///
+/// A preamble is only built the second time a given preamble and set of flags
+/// is seen, so that translation units that share nothing with the others are
+/// not slowed down by building a preamble nobody reuses.
+///
+/// Only one translation unit builds a given preamble, the others wait for it.
+/// The warnings and notes reported while building the preamble are reported
+/// again for every translation unit that uses it, with the locations in the
+/// preamble region moved to the main file of that translation unit. Other
+/// source locations in the preamble region of a translation unit, such as
+/// those of declarations, still refer to the main file of the translation unit
+/// the preamble was built for. Tools that rewrite the preamble region of the
+/// main file should not use the cache.
+///
+/// This class is thread-safe.
+class SharedPreambleCache {
+public:
+  SharedPreambleCache();
+  ~SharedPreambleCache();
+
+  /// Replaces \p Invocation with one that uses a cached preamble for its main
+  /// file, building the preamble if needed.
+  ///
+  /// \param CC1Args The cc1 arguments \p Invocation was created from. They
+  /// determine which translation units are compatible with each other.
+  ///
+  /// \param DiagConsumer The consumer the diagnostics of the translation unit
+  /// are reported to, or null to print them.
+  ///
+  /// \returns If \p Invocation now uses a precompiled preamble, the consumer
+  /// to parse it with, which reports the diagnostics of the preamble followed
+  /// by those of the translation unit to \p DiagConsumer. Null otherwise.
+  std::unique_ptr<DiagnosticConsumer>
+  usePreamble(std::unique_ptr<CompilerInvocation> &Invocation,
+              ArrayRef<const char *> CC1Args,
+              IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
+              std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+              DiagnosticConsumer *DiagConsumer);
+
+  /// Returns the number of translation units that used a cached preamble.
+  unsigned getNumReuses() const;
+
+private:
+  struct BuiltPreamble;
+
+  struct Entry {
+    /// The number of translation units that requested this preamble.
+    unsigned NumUses = 0;
+    /// Whether a translation unit is building this preamble.
+    bool Building = false;
+    /// Whether building this preamble failed.
+    bool Failed = false;
+    std::shared_ptr<const BuiltPreamble> Preamble;
+  };
+
+  mutable std::mutex Lock;
+  /// Signaled whenever a translation unit finishes building a preamble.
+  std::condition_variable PreambleBuilt;
+  llvm::StringMap<Entry> Cache;
+  unsigned NumReuses = 0;
+};
+
+} // end namespace tooling
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLING_SHAREDPREAMBLECACHE_H
@@ -65,6 +65,7 @@ class Compilation;
 namespace tooling {
 
 class CompilationDatabase;
+class SharedPreambleCache;
 
 /// Interface to process a clang::CompilerInvocation.
 ///
@@ -264,6 +265,12 @@ public:
     this->DiagConsumer = DiagConsumer;
   }
 
+  /// Set a \c SharedPreambleCache used to reuse the preamble of the main file
+  /// across invocations. The cache is not owned by the invocation.
+  void setPreambleCache(SharedPreambleCache *PreambleCache) {
+    this->PreambleCache = PreambleCache;
+  }
+
   /// Map a virtual file to be used while running the tool.
   ///
   /// \param FilePath The path at which the content will be mapped.
@@ -292,6 +299,7 @@ public:
   // Maps <file name> -> <file content>.
   llvm::StringMap<StringRef> MappedFileContents;
   DiagnosticConsumer *DiagConsumer = nullptr;
+  SharedPreambleCache *PreambleCache = nullptr;
 };
 
 /// Utility to run a FrontendAction over a set of files.
@@ -366,6 +374,13 @@ public:
   /// default, if an action fails, a message is printed out to stderr.
   void setPrintErrorMessage(bool PrintErrorMessage);
 
+  /// Sets a cache of precompiled preambles shared by the translation units
+  /// processed by run(). The translation units that start with the same
+  /// preamble and use the same flags then parse their common headers once.
+  /// By default, no preamble is used. The cache is not owned by the tool and
+  /// can be shared between tools running on different threads.
+  void setPreambleCache(SharedPreambleCache *PreambleCache);
+
   /// Returns the file manager used in the tool.
   ///
   /// The file manager is shared between all translation units.
@@ -391,6 +406,8 @@ private:
 
   DiagnosticConsumer *DiagConsumer = nullptr;
 
+  SharedPreambleCache *PreambleCache = nullptr;
+
   bool RestoreCWD = true;
   bool PrintErrorMessage = true;
 };
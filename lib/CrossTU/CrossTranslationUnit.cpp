@@ -18,13 +18,16 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Index/USRGeneration.h"
+#include "clang/Sema/Sema.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
-#include <fstream>
 #include <sstream>
 
 namespace clang {
@@ -49,6 +52,8 @@ STATISTIC(NumLangMismatch, "The # of language mismatches");
 STATISTIC(NumLangDialectMismatch, "The # of language dialect mismatches");
 STATISTIC(NumASTLoadThresholdReached,
           "The # of ASTs not loaded because of threshold");
+STATISTIC(NumFoundByNameLookup,
+          "The # of definitions found by name lookup in the loaded AST");
 
 // Same as Triple's equality operator, but we check a field only if that is
 // known in both instances.
@@ -110,6 +115,8 @@ public:
       return "Language dialect mismatch";
     case index_error_code::load_threshold_reached:
       return "Load threshold reached";
+    case index_error_code::index_too_large:
+      return "The index is too large for the binary index format.";
     }
     llvm_unreachable("Unrecognized index_error_code.");
   }
@@ -128,25 +135,85 @@ std::error_code IndexError::convertToErrorCode() const {
   return std::error_code(static_cast<int>(Code), *Category);
 }
 
-llvm::Expected<llvm::StringMap<std::string>>
-parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir) {
-  std::ifstream ExternalMapFile(IndexPath);
-  if (!ExternalMapFile)
-    return llvm::make_error<IndexError>(index_error_code::missing_index_file,
+// The binary index consists of the magic string, the number of entries, the
+// entries sorted by USR and the string data. An entry is the offset and size
+// of its USR followed by the offset and size of its filepath. All integers are
+// 32 bit little endian, and offsets are relative to the start of the file.
+static const char BinaryIndexMagic[] = "CTUINDX1";
+static const size_t BinaryIndexMagicSize = sizeof(BinaryIndexMagic) - 1;
+static const size_t BinaryIndexHeaderSize = BinaryIndexMagicSize + 4;
+static const size_t BinaryIndexEntrySize = 16;
+
+/// Returns the number of entries in a binary index, or None if the buffer is
+/// too small to hold them.
+static llvm::Optional<uint32_t> getBinaryIndexSize(StringRef Buffer) {
+  if (!isCrossTUBinaryIndex(Buffer) || Buffer.size() < BinaryIndexHeaderSize)
+    return None;
+  uint32_t NumEntries =
+      llvm::support::endian::read32le(Buffer.data() + BinaryIndexMagicSize);
+  if (NumEntries >
+      (Buffer.size() - BinaryIndexHeaderSize) / BinaryIndexEntrySize)
+    return None;
+  return NumEntries;
+}
+
+/// Returns the string described by the offset and size at \p Pos in a binary
+/// index, or None if it is out of bounds.
+static llvm::Optional<StringRef> readBinaryIndexString(StringRef Buffer,
+                                                       size_t Pos) {
+  uint32_t Offset = llvm::support::endian::read32le(Buffer.data() + Pos);
+  uint32_t Size = llvm::support::endian::read32le(Buffer.data() + Pos + 4);
+  if (Offset > Buffer.size() || Size > Buffer.size() - Offset)
+    return None;
+  return Buffer.substr(Offset, Size);
+}
+
+static size_t getBinaryIndexEntryPos(uint32_t Entry) {
+  return BinaryIndexHeaderSize + size_t(Entry) * BinaryIndexEntrySize;
+}
+
+static llvm::Expected<llvm::StringMap<std::string>>
+parseCrossTUBinaryIndex(StringRef Buffer, StringRef IndexPath,
+                        StringRef CrossTUDir) {
+  llvm::Optional<uint32_t> NumEntries = getBinaryIndexSize(Buffer);
+  if (!NumEntries)
+    return llvm::make_error<IndexError>(index_error_code::invalid_index_format,
                                         IndexPath.str());
 
   llvm::StringMap<std::string> Result;
-  std::string Line;
+  for (uint32_t I = 0; I < *NumEntries; ++I) {
+    size_t Pos = getBinaryIndexEntryPos(I);
+    llvm::Optional<StringRef> LookupName = readBinaryIndexString(Buffer, Pos);
+    llvm::Optional<StringRef> FileName = readBinaryIndexString(Buffer, Pos + 8);
+    if (!LookupName || !FileName)
+      return llvm::make_error<IndexError>(
+          index_error_code::invalid_index_format, IndexPath.str(), I + 1);
+    if (Result.count(*LookupName))
+      return llvm::make_error<IndexError>(
+          index_error_code::multiple_definitions, IndexPath.str(), I + 1);
+    SmallString<256> FilePath = CrossTUDir;
+    llvm::sys::path::append(FilePath, *FileName);
+    Result[*LookupName] = FilePath.str().str();
+  }
+  return Result;
+}
+
+static llvm::Expected<llvm::StringMap<std::string>>
+parseCrossTUTextIndex(StringRef Buffer, StringRef IndexPath,
+                      StringRef CrossTUDir) {
+  llvm::StringMap<std::string> Result;
+  StringRef Rest = Buffer;
   unsigned LineNo = 1;
-  while (std::getline(ExternalMapFile, Line)) {
+  while (!Rest.empty()) {
+    StringRef Line;
+    std::tie(Line, Rest) = Rest.split('\n');
     const size_t Pos = Line.find(" ");
-    if (Pos > 0 && Pos != std::string::npos) {
-      StringRef LineRef{Line};
-      StringRef LookupName = LineRef.substr(0, Pos);
+    if (Pos > 0 && Pos != StringRef::npos) {
+      StringRef LookupName = Line.substr(0, Pos);
       if (Result.count(LookupName))
         return llvm::make_error<IndexError>(
             index_error_code::multiple_definitions, IndexPath.str(), LineNo);
-      StringRef FileName = LineRef.substr(Pos + 1);
+      StringRef FileName = Line.substr(Pos + 1);
       SmallString<256> FilePath = CrossTUDir;
       llvm::sys::path::append(FilePath, FileName);
       Result[LookupName] = FilePath.str().str();
@@ -158,6 +225,21 @@ parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir) {
   return Result;
 }
 
+llvm::Expected<llvm::StringMap<std::string>>
+parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(IndexPath, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return llvm::make_error<IndexError>(index_error_code::missing_index_file,
+                                        IndexPath.str());
+
+  StringRef Buffer = (*BufferOrErr)->getBuffer();
+  if (isCrossTUBinaryIndex(Buffer))
+    return parseCrossTUBinaryIndex(Buffer, IndexPath, CrossTUDir);
+  return parseCrossTUTextIndex(Buffer, IndexPath, CrossTUDir);
+}
+
 std::string
 createCrossTUIndexString(const llvm::StringMap<std::string> &Index) {
   std::ostringstream Result;
@@ -166,6 +248,83 @@ createCrossTUIndexString(const llvm::StringMap<std::string> &Index) {
   return Result.str();
 }
 
+llvm::Expected<std::string>
+createCrossTUBinaryIndex(const llvm::StringMap<std::string> &Index) {
+  std::vector<const llvm::StringMapEntry<std::string> *> Entries;
+  Entries.reserve(Index.size());
+  for (const auto &E : Index)
+    Entries.push_back(&E);
+  llvm::sort(Entries, [](const llvm::StringMapEntry<std::string> *LHS,
+                         const llvm::StringMapEntry<std::string> *RHS) {
+    return LHS->getKey() < RHS->getKey();
+  });
+
+  // Every offset has to fit in 32 bits, including the end of the last string.
+  uint64_t Size = getBinaryIndexEntryPos(Entries.size());
+  for (const auto *E : Entries)
+    Size += E->getKey().size() + E->getValue().size();
+  if (Entries.size() > UINT32_MAX || Size > UINT32_MAX)
+    return llvm::make_error<IndexError>(index_error_code::index_too_large);
+
+  std::string Result;
+  llvm::raw_string_ostream OS(Result);
+  llvm::support::endian::Writer Writer(OS, llvm::support::little);
+  OS << StringRef(BinaryIndexMagic, BinaryIndexMagicSize);
+  Writer.write<uint32_t>(Entries.size());
+  uint64_t Offset = getBinaryIndexEntryPos(Entries.size());
+  for (const auto *E : Entries) {
+    Writer.write<uint32_t>(Offset);
+    Writer.write<uint32_t>(E->getKey().size());
+    Offset += E->getKey().size();
+    Writer.write<uint32_t>(Offset);
+    Writer.write<uint32_t>(E->getValue().size());
+    Offset += E->getValue().size();
+  }
+  for (const auto *E : Entries)
+    OS << E->getKey() << E->getValue();
+  return OS.str();
+}
+
+bool isCrossTUBinaryIndex(StringRef Buffer) {
+  return Buffer.startswith(StringRef(BinaryIndexMagic, BinaryIndexMagicSize));
+}
+
+llvm::Expected<llvm::Optional<StringRef>>
+lookupCrossTUBinaryIndex(StringRef Buffer, StringRef LookupName,
+                         StringRef IndexPath) {
+  llvm::Optional<uint32_t> NumEntries = getBinaryIndexSize(Buffer);
+  if (!NumEntries)
+    return llvm::make_error<IndexError>(index_error_code::invalid_index_format,
+                                        IndexPath.str());
+
+  // Find the first entry whose USR is not less than LookupName.
+  uint32_t Low = 0, High = *NumEntries;
+  while (Low < High) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    llvm::Optional<StringRef> Name =
+        readBinaryIndexString(Buffer, getBinaryIndexEntryPos(Mid));
+    if (!Name)
+      return llvm::make_error<IndexError>(
+          index_error_code::invalid_index_format, IndexPath.str(), Mid + 1);
+    if (*Name < LookupName)
+      Low = Mid + 1;
+    else
+      High = Mid;
+  }
+  if (Low == *NumEntries)
+    return llvm::Optional<StringRef>();
+
+  size_t Pos = getBinaryIndexEntryPos(Low);
+  llvm::Optional<StringRef> Name = readBinaryIndexString(Buffer, Pos);
+  llvm::Optional<StringRef> FileName = readBinaryIndexString(Buffer, Pos + 8);
+  if (!Name || !FileName)
+    return llvm::make_error<IndexError>(index_error_code::invalid_index_format,
+                                        IndexPath.str(), Low + 1);
+  if (*Name != LookupName)
+    return llvm::Optional<StringRef>();
+  return FileName;
+}
+
 bool containsConst(const VarDecl *VD, const ASTContext &ACtx) {
   CanQualType CT = ACtx.getCanonicalType(VD->getType());
   if (!CT.isConstQualified()) {
@@ -226,6 +385,84 @@ CrossTranslationUnitContext::findDefInDeclContext(const DeclContext *DC,
   return nullptr;
 }
 
+/// Finds the definition with the given USR in the unit by looking up the name
+/// of \p D in the counterparts of its enclosing namespaces and records. Unlike
+/// findDefInDeclContext, this only loads the declarations with matching names
+/// from the AST file. Returns null if the definition cannot be found this way,
+/// e.g. because a name is not a plain identifier.
+template <typename T>
+const T *CrossTranslationUnitContext::findDefByNameLookup(const T *D,
+                                                          ASTUnit *Unit,
+                                                          StringRef LookupName) {
+  const IdentifierInfo *II = D->getIdentifier();
+  if (!II)
+    return nullptr;
+
+  SmallVector<const NamedDecl *, 4> Contexts;
+  for (const DeclContext *DC = D->getDeclContext(); !DC->isTranslationUnit();
+       DC = DC->getParent()) {
+    if (DC->isTransparentContext())
+      continue;
+    const auto *ND = dyn_cast<NamedDecl>(DC);
+    if (!ND || !ND->getIdentifier() ||
+        !(isa<NamespaceDecl>(ND) || isa<RecordDecl>(ND)))
+      return nullptr;
+    Contexts.push_back(ND);
+  }
+
+  auto GetDefinition = [LookupName](const NamedDecl *ND) -> const T * {
+    const auto *Candidate = dyn_cast<T>(ND);
+    const T *ResultDecl;
+    if (!Candidate || !hasBodyOrInit(Candidate, ResultDecl))
+      return nullptr;
+    llvm::Optional<std::string> ResultLookupName = getLookupName(ResultDecl);
+    if (!ResultLookupName || *ResultLookupName != LookupName)
+      return nullptr;
+    return ResultDecl;
+  };
+
+  ASTContext &FromCtx = Unit->getASTContext();
+  IdentifierInfo &FromII = FromCtx.Idents.get(II->getName());
+
+  // AST files do not contain a lookup table for the translation unit in C.
+  // The declarations of an identifier are loaded into the identifier chains
+  // of Sema instead, when the identifier is first looked up.
+  if (!FromCtx.getLangOpts().CPlusPlus) {
+    if (!Contexts.empty() || !Unit->hasSema())
+      return nullptr;
+    IdentifierResolver &IdResolver = Unit->getSema().IdResolver;
+    for (auto I = IdResolver.begin(&FromII), E = IdResolver.end(); I != E; ++I)
+      if (const T *ResultDecl = GetDefinition(*I))
+        return ResultDecl;
+    return nullptr;
+  }
+
+  const DeclContext *FromDC = FromCtx.getTranslationUnitDecl();
+  for (const NamedDecl *Context : llvm::reverse(Contexts)) {
+    const DeclContext *NextDC = nullptr;
+    for (const NamedDecl *ND :
+         FromDC->lookup(&FromCtx.Idents.get(Context->getName()))) {
+      if (isa<NamespaceDecl>(Context) && isa<NamespaceDecl>(ND)) {
+        NextDC = cast<NamespaceDecl>(ND);
+        break;
+      }
+      const auto *RD = dyn_cast<RecordDecl>(ND);
+      if (isa<RecordDecl>(Context) && RD && RD->getDefinition()) {
+        NextDC = RD->getDefinition();
+        break;
+      }
+    }
+    if (!NextDC)
+      return nullptr;
+    FromDC = NextDC;
+  }
+
+  for (const NamedDecl *ND : FromDC->lookup(&FromII))
+    if (const T *ResultDecl = GetDefinition(ND))
+      return ResultDecl;
+  return nullptr;
+}
+
 template <typename T>
 llvm::Expected<const T *> CrossTranslationUnitContext::getCrossTUDefinitionImpl(
     const T *D, StringRef CrossTUDir, StringRef IndexName,
@@ -294,6 +531,12 @@ llvm::Expected<const T *> CrossTranslationUnitContext::getCrossTUDefinitionImpl(
         index_error_code::lang_dialect_mismatch);
   }
 
+  // Walking the whole translation unit loads every declaration from the AST
+  // file, so do that only if the definition is not found by its name.
+  if (const T *ResultDecl = findDefByNameLookup(D, Unit, *LookupName)) {
+    ++NumFoundByNameLookup;
+    return importDefinition(ResultDecl, Unit);
+  }
   TranslationUnitDecl *TU = Unit->getASTContext().getTranslationUnitDecl();
   if (const T *ResultDecl = findDefInDeclContext<T>(TU, *LookupName))
     return importDefinition(ResultDecl, Unit);
@@ -416,16 +659,20 @@ CrossTranslationUnitContext::ASTUnitStorage::getASTUnitForFunction(
             ensureCTUIndexLoaded(CrossTUDir, IndexName))
       return std::move(IndexLoadError);
 
+    // Search in the index for the filename where the definition of FuncitonName
+    // resides.
+    llvm::Expected<std::string> FileName = lookupCTUIndex(FunctionName);
+    if (!FileName)
+      return FileName.takeError();
+
     // Check if there is and entry in the index for the function.
-    if (!NameFileMap.count(FunctionName)) {
+    if (FileName->empty()) {
       ++NumNotInOtherTU;
       return llvm::make_error<IndexError>(index_error_code::missing_definition);
     }
 
-    // Search in the index for the filename where the definition of FuncitonName
-    // resides.
     if (llvm::Expected<ASTUnit *> FoundForFile =
-            getASTUnitForFile(NameFileMap[FunctionName], DisplayCTUProgress)) {
+            getASTUnitForFile(*FileName, DisplayCTUProgress)) {
 
       // Update the cache.
       NameASTUnitMap[FunctionName] = *FoundForFile;
@@ -445,13 +692,35 @@ CrossTranslationUnitContext::ASTUnitStorage::getFileForFunction(
     StringRef FunctionName, StringRef CrossTUDir, StringRef IndexName) {
   if (llvm::Error IndexLoadError = ensureCTUIndexLoaded(CrossTUDir, IndexName))
     return std::move(IndexLoadError);
-  return NameFileMap[FunctionName];
+  return lookupCTUIndex(FunctionName);
+}
+
+llvm::Expected<std::string>
+CrossTranslationUnitContext::ASTUnitStorage::lookupCTUIndex(
+    StringRef FunctionName) {
+  if (!BinaryIndex) {
+    auto It = NameFileMap.find(FunctionName);
+    if (It == NameFileMap.end())
+      return std::string();
+    return It->second;
+  }
+
+  llvm::Expected<llvm::Optional<StringRef>> FileName =
+      lookupCrossTUBinaryIndex(BinaryIndex->getBuffer(), FunctionName,
+                               BinaryIndexPath);
+  if (!FileName)
+    return FileName.takeError();
+  if (!*FileName)
+    return std::string();
+  SmallString<256> FilePath = BinaryIndexDir;
+  llvm::sys::path::append(FilePath, **FileName);
+  return FilePath.str().str();
 }
 
 llvm::Error CrossTranslationUnitContext::ASTUnitStorage::ensureCTUIndexLoaded(
     StringRef CrossTUDir, StringRef IndexName) {
   // Dont initialize if the map is filled.
-  if (!NameFileMap.empty())
+  if (!NameFileMap.empty() || BinaryIndex)
     return llvm::Error::success();
 
   // Get the absolute path to the index file.
@@ -461,7 +730,27 @@ llvm::Error CrossTranslationUnitContext::ASTUnitStorage::ensureCTUIndexLoaded(
   else
     llvm::sys::path::append(IndexFile, IndexName);
 
-  if (auto IndexMapping = parseCrossTUIndex(IndexFile, CrossTUDir)) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+      llvm::MemoryBuffer::getFile(IndexFile, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr)
+    return llvm::make_error<IndexError>(index_error_code::missing_index_file,
+                                        IndexFile.str().str());
+
+  // A binary index is kept mapped and searched in place instead of being
+  // parsed into the map.
+  if (isCrossTUBinaryIndex((*BufferOrErr)->getBuffer())) {
+    if (!getBinaryIndexSize((*BufferOrErr)->getBuffer()))
+      return llvm::make_error<IndexError>(
+          index_error_code::invalid_index_format, IndexFile.str().str());
+    BinaryIndex = std::move(*BufferOrErr);
+    BinaryIndexPath = IndexFile.str().str();
+    BinaryIndexDir = CrossTUDir.str();
+    return llvm::Error::success();
+  }
+
+  if (auto IndexMapping = parseCrossTUTextIndex((*BufferOrErr)->getBuffer(),
+                                                IndexFile, CrossTUDir)) {
     // Initialize member map.
     NameFileMap = *IndexMapping;
     return llvm::Error::success();
@@ -9,11 +9,18 @@
 #include "UnwrappedLineFormatter.h"
 #include "NamespaceEndCommentsFixer.h"
 #include "WhitespaceManager.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Debug.h"
 #include <queue>
+#include <unordered_map>
 
 #define DEBUG_TYPE "format-formatter"
 
+STATISTIC(NumStatesExpanded, "Number of states expanded by the line optimizer");
+STATISTIC(NumStatesPruned,
+          "Number of states the line optimizer did not queue again");
+
 namespace clang {
 namespace format {
 
@@ -917,6 +924,27 @@ private:
     }
   };
 
+  /// Hashes some of the members that \c LineState::operator< compares, so
+  /// that states which compare equal hash equally.
+  struct HashLineStatePointer {
+    size_t operator()(const LineState *State) const {
+      llvm::hash_code Hash = llvm::hash_combine(
+          State->NextToken, State->Column, State->StartOfLineLevel,
+          State->LowestLevelOnLine, State->StartOfStringLiteral,
+          State->Stack.size());
+      for (const ParenState &Paren : State->Stack)
+        Hash = llvm::hash_combine(Hash, Paren.Indent, Paren.LastSpace,
+                                  Paren.NestedBlockIndent);
+      return Hash;
+    }
+  };
+
+  struct EqualLineStatePointers {
+    bool operator()(const LineState *obj1, const LineState *obj2) const {
+      return !(*obj1 < *obj2) && !(*obj2 < *obj1);
+    }
+  };
+
   /// A pair of <penalty, count> that is used to prioritize the BFS on.
   ///
   /// In case of equal penalties, we want to prefer states that were inserted
@@ -927,8 +955,8 @@ private:
   /// An edge in the solution space from \c Previous->State to \c State,
   /// inserting a newline dependent on the \c NewLine.
   struct StateNode {
-    StateNode(const LineState &State, bool NewLine, StateNode *Previous)
-        : State(State), NewLine(NewLine), Previous(Previous) {}
+    StateNode(LineState State, bool NewLine, StateNode *Previous)
+        : State(std::move(State)), NewLine(NewLine), Previous(Previous) {}
     LineState State;
     bool NewLine;
     StateNode *Previous;
@@ -943,6 +971,15 @@ private:
                               std::greater<QueueItem>>
       QueueType;
 
+  /// The lowest penalty with which each state was queued.
+  typedef std::unordered_map<LineState *, unsigned, HashLineStatePointer,
+                             EqualLineStatePointers>
+      PenaltyMapType;
+
+  /// The number of states after which the analysis ignores the stack when
+  /// comparing states. See description of IgnoreStackForComparison.
+  static const unsigned MaxStatesComparingStack = 50000;
+
   /// Analyze the entire solution space starting from \p InitialState.
   ///
   /// This implements a variant of Dijkstra's algorithm on the graph that spans
@@ -953,6 +990,7 @@ private:
   /// If \p DryRun is \c false, directly applies the changes.
   unsigned analyzeSolutionSpace(LineState &InitialState, bool DryRun) {
     std::set<LineState *, CompareLineStatePointers> Seen;
+    PenaltyMapType QueuedPenalties;
 
     // Increasing count of \c StateNode items we have created. This is used to
     // create a deterministic order independent of the container.
@@ -980,18 +1018,21 @@ private:
 
       // Cut off the analysis of certain solutions if the analysis gets too
       // complex. See description of IgnoreStackForComparison.
-      if (Count > 50000)
+      if (Count > MaxStatesComparingStack)
         Node->State.IgnoreStackForComparison = true;
 
       if (!Seen.insert(&Node->State).second)
         // State already examined with lower penalty.
         continue;
+      ++NumStatesExpanded;
 
       FormatDecision LastFormat = Node->State.NextToken->Decision;
       if (LastFormat == FD_Unformatted || LastFormat == FD_Continue)
-        addNextStateToQueue(Penalty, Node, /*NewLine=*/false, &Count, &Queue);
+        addNextStateToQueue(Penalty, Node, /*NewLine=*/false, &Count, &Queue,
+                            &QueuedPenalties);
       if (LastFormat == FD_Unformatted || LastFormat == FD_Break)
-        addNextStateToQueue(Penalty, Node, /*NewLine=*/true, &Count, &Queue);
+        addNextStateToQueue(Penalty, Node, /*NewLine=*/true, &Count, &Queue,
+                            &QueuedPenalties);
     }
 
     if (Queue.empty()) {
@@ -1016,20 +1057,47 @@ private:
   ///
   /// Assume the current state is \p PreviousNode and has been reached with a
   /// penalty of \p Penalty. Insert a line break if \p NewLine is \c true.
+  ///
+  /// States that are already queued with a penalty that is not higher are not
+  /// queued, nor allocated, again: they would only be discarded once dequeued,
+  /// after having grown the queue. \p QueuedPenalties records the queued
+  /// states.
   void addNextStateToQueue(unsigned Penalty, StateNode *PreviousNode,
-                           bool NewLine, unsigned *Count, QueueType *Queue) {
+                           bool NewLine, unsigned *Count, QueueType *Queue,
+                           PenaltyMapType *QueuedPenalties) {
     if (NewLine && !Indenter->canBreak(PreviousNode->State))
       return;
     if (!NewLine && Indenter->mustBreak(PreviousNode->State))
       return;
 
-    StateNode *Node = new (Allocator.Allocate())
-        StateNode(PreviousNode->State, NewLine, PreviousNode);
-    if (!formatChildren(Node->State, NewLine, /*DryRun=*/true, Penalty))
+    LineState State = PreviousNode->State;
+    if (!formatChildren(State, NewLine, /*DryRun=*/true, Penalty))
       return;
 
-    Penalty += Indenter->addTokenToState(Node->State, NewLine, true);
+    Penalty += Indenter->addTokenToState(State, NewLine, true);
+
+    // Once the stack is ignored, the states no longer compare consistently
+    // with those queued before, so stop pruning.
+    bool RecordPenalty = *Count <= MaxStatesComparingStack;
+    if (RecordPenalty) {
+      auto Queued = QueuedPenalties->find(&State);
+      if (Queued != QueuedPenalties->end()) {
+        if (Queued->second <= Penalty) {
+          // Still count the state, so that the limits on the number of
+          // states apply as if it had been queued.
+          ++NumStatesPruned;
+          ++(*Count);
+          return;
+        }
+        Queued->second = Penalty;
+        RecordPenalty = false;
+      }
+    }
 
+    StateNode *Node = new (Allocator.Allocate())
+        StateNode(std::move(State), NewLine, PreviousNode);
+    if (RecordPenalty)
+      QueuedPenalties->insert({&Node->State, Penalty});
     Queue->push(QueueItem(OrderedPenalty(Penalty, *Count), Node));
     ++(*Count);
   }
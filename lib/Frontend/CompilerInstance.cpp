@@ -41,6 +41,7 @@
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/LockFileManager.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -1245,13 +1246,67 @@ static bool compileModule(CompilerInstance &ImportingInstance,
   return Result;
 }
 
+/// Move a freshly built module file with the signature \p Signature into the
+/// content-addressed part of the module cache, leaving a hard link behind at
+/// \p ModuleFileName.
+///
+/// Module files are keyed by their AST signature, which is only written with
+/// -fmodules-hash-content. The unhashed control block (e.g. diagnostic
+/// options) may still differ between module files with the same signature, so
+/// a module file is only replaced by the stored copy if both are identical.
+/// This is purely a storage optimization, so any failure just leaves the
+/// module file where it is.
+static void storeModuleFileByContent(CompilerInstance &ImportingInstance,
+                                     StringRef ModuleFileName,
+                                     const ASTFileSignature &Signature) {
+  StringRef CachePath = ImportingInstance.getHeaderSearchOpts().ModuleCachePath;
+  if (CachePath.empty() || !Signature)
+    return;
+
+  SmallString<128> ContentPath(CachePath);
+  llvm::sys::path::append(ContentPath, "content");
+  if (llvm::sys::fs::create_directories(ContentPath))
+    return;
+  std::string ContentName;
+  for (uint32_t Word : Signature)
+    ContentName += llvm::format_hex_no_prefix(Word, 8).str();
+  ContentName += ".pcm";
+  llvm::sys::path::append(ContentPath, ContentName);
+
+  // The first module file with this signature becomes the stored copy.
+  std::error_code EC =
+      llvm::sys::fs::create_hard_link(ModuleFileName, ContentPath);
+  if (EC != std::errc::file_exists)
+    return;
+
+  {
+    auto Built = llvm::MemoryBuffer::getFile(ModuleFileName);
+    auto Stored = llvm::MemoryBuffer::getFile(ContentPath);
+    if (!Built || !Stored ||
+        (*Built)->getBuffer() != (*Stored)->getBuffer())
+      return;
+  }
+
+  // Identical contents are stored already. Link them to a unique temporary
+  // name and rename that over the module file, so that concurrent readers
+  // always see a complete module file.
+  SmallString<128> TempPath;
+  llvm::sys::fs::createUniquePath(ModuleFileName + "-%%%%%%%%.link", TempPath,
+                                  /*MakeAbsolute=*/false);
+  if (llvm::sys::fs::create_hard_link(ContentPath, TempPath))
+    return;
+  if (llvm::sys::fs::rename(TempPath, ModuleFileName))
+    llvm::sys::fs::remove(TempPath);
+}
+
 /// Compile a module in a separate compiler instance and read the AST,
 /// returning true if the module compiles without errors.
 ///
 /// Uses a lock file manager and exponential backoff to reduce the chances that
 /// multiple instances will compete to create the same module.  On timeout,
 /// deletes the lock file in order to avoid deadlock from crashing processes or
-/// bugs in the lock file manager.
+/// bugs in the lock file manager. Without locks, every instance builds the
+/// module itself.
 static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
                                     SourceLocation ImportLoc,
                                     SourceLocation ModuleNameLoc,
@@ -1268,48 +1323,72 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
   StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
   llvm::sys::fs::create_directories(Dir);
 
+  bool UseLock =
+      ImportingInstance.getFrontendOpts().BuildingImplicitModuleUsesLock;
+  bool RebuiltWithoutLock = false;
   while (1) {
     unsigned ModuleLoadCapabilities = ASTReader::ARR_Missing;
-    llvm::LockFileManager Locked(ModuleFileName);
-    switch (Locked) {
-    case llvm::LockFileManager::LFS_Error:
-      // ModuleCache takes care of correctness and locks are only necessary for
-      // performance. Fallback to building the module in case of any lock
-      // related errors.
-      Diags.Report(ModuleNameLoc, diag::remark_module_lock_failure)
-          << Module->Name << Locked.getErrorMessage();
-      // Clear out any potential leftover.
-      Locked.unsafeRemoveLockFile();
-      LLVM_FALLTHROUGH;
-    case llvm::LockFileManager::LFS_Owned:
-      // We're responsible for building the module ourselves.
+    bool Built = false;
+    Optional<llvm::LockFileManager> Locked;
+    if (UseLock)
+      Locked.emplace(ModuleFileName);
+
+    if (!Locked) {
+      // Build the module ourselves, even if other processes are racing to do
+      // the same. Module files are written to a temporary file and renamed
+      // into place, so readers never observe a partially written module file,
+      // but the last build to finish wins and may be out of date for us. In
+      // that case rebuild once more, like the locked path does after waiting.
       if (!compileModule(ImportingInstance, ModuleNameLoc, Module,
                          ModuleFileName)) {
         diagnoseBuildFailure();
         return false;
       }
-      break;
-
-    case llvm::LockFileManager::LFS_Shared:
-      // Someone else is responsible for building the module. Wait for them to
-      // finish.
-      switch (Locked.waitForUnlock()) {
-      case llvm::LockFileManager::Res_Success:
+      Built = true;
+      if (!RebuiltWithoutLock)
         ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
+    } else {
+      switch (*Locked) {
+      case llvm::LockFileManager::LFS_Error:
+        // ModuleCache takes care of correctness and locks are only necessary
+        // for performance. Fallback to building the module in case of any lock
+        // related errors.
+        Diags.Report(ModuleNameLoc, diag::remark_module_lock_failure)
+            << Module->Name << Locked->getErrorMessage();
+        // Clear out any potential leftover.
+        Locked->unsafeRemoveLockFile();
+        LLVM_FALLTHROUGH;
+      case llvm::LockFileManager::LFS_Owned:
+        // We're responsible for building the module ourselves.
+        if (!compileModule(ImportingInstance, ModuleNameLoc, Module,
+                           ModuleFileName)) {
+          diagnoseBuildFailure();
+          return false;
+        }
+        Built = true;
+        break;
+
+      case llvm::LockFileManager::LFS_Shared:
+        // Someone else is responsible for building the module. Wait for them
+        // to finish.
+        switch (Locked->waitForUnlock()) {
+        case llvm::LockFileManager::Res_Success:
+          ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
+          break;
+        case llvm::LockFileManager::Res_OwnerDied:
+          continue; // try again to get the lock.
+        case llvm::LockFileManager::Res_Timeout:
+          // Since ModuleCache takes care of correctness, we try waiting for
+          // another process to complete the build so clang does not do it done
+          // twice. If case of timeout, build it ourselves.
+          Diags.Report(ModuleNameLoc, diag::remark_module_lock_timeout)
+              << Module->Name;
+          // Clear the lock file so that future invocations can make progress.
+          Locked->unsafeRemoveLockFile();
+          continue;
+        }
         break;
-      case llvm::LockFileManager::Res_OwnerDied:
-        continue; // try again to get the lock.
-      case llvm::LockFileManager::Res_Timeout:
-        // Since ModuleCache takes care of correctness, we try waiting for
-        // another process to complete the build so clang does not do it done
-        // twice. If case of timeout, build it ourselves.
-        Diags.Report(ModuleNameLoc, diag::remark_module_lock_timeout)
-            << Module->Name;
-        // Clear the lock file so that future invocations can make progress.
-        Locked.unsafeRemoveLockFile();
-        continue;
       }
-      break;
     }
 
     // Try to read the module file, now that we've compiled it.
@@ -1319,10 +1398,11 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
             ModuleLoadCapabilities);
 
     if (ReadResult == ASTReader::OutOfDate &&
-        Locked == llvm::LockFileManager::LFS_Shared) {
+        (!Locked || *Locked == llvm::LockFileManager::LFS_Shared)) {
       // The module may be out of date in the presence of file system races,
       // or if one of its imports depends on header search paths that are not
       // consistent with this ImportingInstance.  Try again...
+      RebuiltWithoutLock = !Locked;
       continue;
     } else if (ReadResult == ASTReader::Missing) {
       diagnoseBuildFailure();
@@ -1331,6 +1411,15 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
       // The ASTReader didn't diagnose the error, so conservatively report it.
       diagnoseBuildFailure();
     }
+
+    if (ReadResult == ASTReader::Success && Built &&
+        ImportingInstance.getHeaderSearchOpts().ModulesContentAddressedCache)
+      if (serialization::ModuleFile *MF =
+              ImportingInstance.getASTReader()
+                  ->getModuleManager()
+                  .lookupByFileName(ModuleFileName))
+        storeModuleFileByContent(ImportingInstance, ModuleFileName,
+                                 MF->Signature);
     return ReadResult == ASTReader::Success;
   }
 }
@@ -500,6 +500,14 @@ static void parseAnalyzerConfigs(AnalyzerOptions &AnOpts,
     Diags->Report(diag::err_analyzer_config_invalid_input)
         << "track-conditions-debug" << "'track-conditions' to also be enabled";
 
+  if (AnOpts.FunctionShardCount == 0)
+    Diags->Report(diag::err_analyzer_config_invalid_input)
+        << "function-shard-count" << "a positive";
+  else if (AnOpts.FunctionShardIndex >= AnOpts.FunctionShardCount)
+    Diags->Report(diag::err_analyzer_config_invalid_input)
+        << "function-shard-index"
+        << "an unsigned less than 'function-shard-count'";
+
   if (!AnOpts.CTUDir.empty() && !llvm::sys::fs::is_directory(AnOpts.CTUDir))
     Diags->Report(diag::err_analyzer_config_invalid_input) << "ctu-dir"
                                                            << "a filename";
@@ -1884,6 +1892,8 @@ static InputKind ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.ASTDumpLookups = Args.hasArg(OPT_ast_dump_lookups);
   Opts.UseGlobalModuleIndex = !Args.hasArg(OPT_fno_modules_global_index);
   Opts.GenerateGlobalModuleIndex = Opts.UseGlobalModuleIndex;
+  Opts.BuildingImplicitModuleUsesLock =
+      !Args.hasArg(OPT_fno_implicit_modules_use_lock);
   Opts.ModuleMapFiles = Args.getAllArgValues(OPT_fmodule_map_file);
   // Only the -fmodule-file=<file> form.
   for (const auto *A : Args.filtered(OPT_fmodule_file)) {
@@ -2100,6 +2110,8 @@ static void ParseHeaderSearchArgs(HeaderSearchOptions &Opts, ArgList &Args,
   Opts.DisableModuleHash = Args.hasArg(OPT_fdisable_module_hash);
   Opts.ModulesHashContent = Args.hasArg(OPT_fmodules_hash_content);
   Opts.ModulesStrictContextHash = Args.hasArg(OPT_fmodules_strict_context_hash);
+  Opts.ModulesContentAddressedCache =
+      Args.hasArg(OPT_fmodules_content_addressed_cache);
   Opts.ModulesValidateDiagnosticOptions =
       !Args.hasArg(OPT_fmodules_disable_diagnostic_validation);
   Opts.ImplicitModuleMaps = Args.hasArg(OPT_fimplicit_module_maps);
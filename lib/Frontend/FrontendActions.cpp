@@ -774,12 +774,13 @@ void PreprocessOnlyAction::ExecuteAction() {
   // Ignore unknown pragmas.
   PP.IgnorePragmas();
 
-  Token Tok;
+  Token Toks[64];
   // Start parsing the specified input file.
   PP.EnterMainSourceFile();
+  unsigned NumToks;
   do {
-    PP.Lex(Tok);
-  } while (Tok.isNot(tok::eof));
+    NumToks = PP.LexTokens(Toks);
+  } while (NumToks != 0 && Toks[NumToks - 1].isNot(tok::eof));
 }
 
 void PrintPreprocessedAction::ExecuteAction() {
@@ -830,9 +830,10 @@ static void DoPrintMacros(Preprocessor &PP, raw_ostream *OS) {
   // the macro table at the end.
   PP.EnterMainSourceFile();
 
-  Token Tok;
-  do PP.Lex(Tok);
-  while (Tok.isNot(tok::eof));
+  Token Toks[64];
+  unsigned NumToks;
+  do NumToks = PP.LexTokens(Toks);
+  while (NumToks != 0 && Toks[NumToks - 1].isNot(tok::eof));
 
   SmallVector<id_macro_pair, 128> MacrosByID;
   for (Preprocessor::macro_iterator I = PP.macro_begin(), E = PP.macro_end();
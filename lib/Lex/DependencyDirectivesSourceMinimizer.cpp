@@ -321,18 +321,24 @@ static bool isQuoteCppDigitSeparator(const char *const Start,
   return (Cur + 1) < End && isIdentifierBody(*(Cur + 1));
 }
 
-static void skipLine(const char *&First, const char *const End) {
+/// Skips the logical line. If \p StopAtAt is true, stops instead at the first
+/// '@' that is not in a string or a comment, and returns true.
+static bool skipLineImpl(const char *&First, const char *const End,
+                         bool StopAtAt) {
   for (;;) {
     assert(First <= End);
     if (First == End)
-      return;
+      return false;
 
     if (isVerticalWhitespace(*First)) {
       skipNewline(First, End);
-      return;
+      return false;
     }
     const char *Start = First;
     while (First != End && !isVerticalWhitespace(*First)) {
+      if (StopAtAt && *First == '@')
+        return true;
+
       // Iterate over strings correctly to avoid comments and newlines.
       if (*First == '"' ||
           (*First == '\'' && !isQuoteCppDigitSeparator(Start, First, End))) {
@@ -364,15 +370,26 @@ static void skipLine(const char *&First, const char *const End) {
       skipBlockComment(First, End);
     }
     if (First == End)
-      return;
+      return false;
 
     // Skip over the newline.
     unsigned Len = skipNewline(First, End);
     if (!wasLineContinuation(First, Len)) // Continue past line-continuations.
-      break;
+      return false;
   }
 }
 
+static void skipLine(const char *&First, const char *const End) {
+  skipLineImpl(First, End, /*StopAtAt=*/false);
+}
+
+/// Skips to the next '@' on the logical line that is not in a string or a
+/// comment, and returns true. If there is none, skips the line and returns
+/// false.
+static bool skipLineToAt(const char *&First, const char *const End) {
+  return skipLineImpl(First, End, /*StopAtAt=*/true);
+}
+
 static void skipDirective(StringRef Name, const char *&First,
                           const char *const End) {
   if (llvm::StringSwitch<bool>(Name)
@@ -385,13 +402,43 @@ static void skipDirective(StringRef Name, const char *&First,
     skipLine(First, End);
 }
 
+/// \returns True if \p Kind is a directive whose operand is a header-name.
+static bool isIncludeDirective(TokenKind Kind) {
+  return Kind == pp_include || Kind == pp_include_next || Kind == pp_import ||
+         Kind == pp___include_macros;
+}
+
+/// \returns True if the '<' at \p Cur opens the header-name operand of
+/// \c __has_include or \c __has_include_next, looking back no further than
+/// \p First.
+static bool isHasIncludeHeaderName(const char *First, const char *Cur) {
+  const char *Last = Cur;
+  while (Last != First && isHorizontalWhitespace(Last[-1]))
+    --Last;
+  if (Last == First || *--Last != '(')
+    return false;
+  while (Last != First && isHorizontalWhitespace(Last[-1]))
+    --Last;
+
+  StringRef Prefix(First, Last - First);
+  for (StringRef Name : {"__has_include", "__has_include_next"}) {
+    if (!Prefix.endswith(Name))
+      continue;
+    if (Prefix.size() == Name.size() ||
+        !isIdentifierBody(Prefix[Prefix.size() - Name.size() - 1]))
+      return true;
+  }
+  return false;
+}
+
 void Minimizer::printToNewline(const char *&First, const char *const End) {
   while (First != End && !isVerticalWhitespace(*First)) {
     const char *Last = First;
     do {
       // Iterate over strings correctly to avoid comments and newlines.
       if (*Last == '"' || *Last == '\'' ||
-          (*Last == '<' && top() == pp_include)) {
+          (*Last == '<' && (isIncludeDirective(top()) ||
+                            isHasIncludeHeaderName(First, Last)))) {
         if (LLVM_UNLIKELY(isRawStringLiteral(First, Last)))
           skipRawString(Last, End);
         else
@@ -610,24 +657,20 @@ bool Minimizer::isNextIdentifier(StringRef Id, const char *&First,
 }
 
 bool Minimizer::lexAt(const char *&First, const char *const End) {
-  // Handle "@import".
-  const char *ImportLoc = First++;
-  if (!isNextIdentifier("import", First, End)) {
-    skipLine(First, End);
-    return false;
-  }
-  makeToken(decl_at_import);
-  append("@import ");
-  if (printAtImportBody(First, End))
-    return reportError(
-        ImportLoc, diag::err_dep_source_minimizer_missing_sema_after_at_import);
-  skipWhitespace(First, End);
-  if (First == End)
-    return false;
-  if (!isVerticalWhitespace(*First))
-    return reportError(
-        ImportLoc, diag::err_dep_source_minimizer_unexpected_tokens_at_import);
-  skipNewline(First, End);
+  // Handle "@import". Objective-C allows several declarations on a line, e.g.
+  // "@class A; @import B;", so look for imports on the rest of the line and
+  // drop everything else.
+  do {
+    const char *ImportLoc = First++;
+    if (!isNextIdentifier("import", First, End))
+      continue;
+    makeToken(decl_at_import);
+    append("@import ");
+    if (printAtImportBody(First, End))
+      return reportError(
+          ImportLoc,
+          diag::err_dep_source_minimizer_missing_sema_after_at_import);
+  } while (skipLineToAt(First, End));
   return false;
 }
 
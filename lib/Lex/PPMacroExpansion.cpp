@@ -38,6 +38,7 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
@@ -427,6 +428,50 @@ static bool isTrivialSingleTokenExpansion(const MacroInfo *MI,
   return std::find(MI->param_begin(), MI->param_end(), II) == MI->param_end();
 }
 
+/// isSingleTokenMacroChain - Return true if MI is an object-like macro whose
+/// only token names another enabled object-like macro, and following such
+/// names ends in a macro that expands to nothing or expands trivially.  This
+/// handles common aliases like "#define FOO BAR" with "#define BAR 42", which
+/// can then be expanded without entering a TokenLexer.
+static bool isSingleTokenMacroChain(const MacroInfo *MI, Preprocessor &PP) {
+  if (!MI->isObjectLike() || MI->getNumTokens() != 1)
+    return false;
+
+  // Every macro in the chain is disabled while the rest of the chain is
+  // expanded, so a name that refers back into the chain is not expanded
+  // again.  Keep the chain short, since each link recurses.
+  SmallPtrSet<const MacroInfo *, 4> Chain;
+  Chain.insert(MI);
+  for (unsigned Depth = 0; Depth != 8; ++Depth) {
+    IdentifierInfo *II = MI->getReplacementToken(0).getIdentifierInfo();
+    if (!II)
+      return true;
+
+    // If the information about this identifier is out of date, update it from
+    // the external source.
+    if (II->isOutOfDate())
+      PP.getExternalSource()->updateOutOfDateIdentifier(*II);
+
+    // Poisoned identifiers are diagnosed differently outside of a TokenLexer.
+    if (II->isPoisoned())
+      return false;
+
+    const MacroInfo *NextMI = PP.getMacroInfo(II);
+    if (!NextMI || !NextMI->isEnabled() || Chain.count(NextMI))
+      return true;
+    if (NextMI->isBuiltinMacro() || NextMI->isFunctionLike())
+      return false;
+    if (NextMI->getNumTokens() == 0)
+      return true;
+    if (NextMI->getNumTokens() != 1)
+      return false;
+
+    Chain.insert(NextMI);
+    MI = NextMI;
+  }
+  return false;
+}
+
 /// isNextPPTokenLParen - Determine whether the next preprocessor token to be
 /// lexed is a '('.  If so, consume the token and return true, if not, this
 /// method should have no observable side-effect on the lexed tokens.
@@ -572,11 +617,12 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
     ++NumFastMacroExpanded;
     return false;
   } else if (MI->getNumTokens() == 1 &&
-             isTrivialSingleTokenExpansion(MI, Identifier.getIdentifierInfo(),
-                                           *this)) {
+             (isTrivialSingleTokenExpansion(MI, Identifier.getIdentifierInfo(),
+                                            *this) ||
+              isSingleTokenMacroChain(MI, *this))) {
     // Otherwise, if this macro expands into a single trivially-expanded
     // token: expand it now.  This handles common cases like
-    // "#define VAL 42".
+    // "#define VAL 42" and "#define ALIAS VAL".
 
     // No need for arg info.
     if (Args) Args->destroy(*this);
@@ -603,14 +649,25 @@ bool Preprocessor::HandleMacroExpandedIdentifier(Token &Identifier,
     // If this is a disabled macro or #define X X, we must mark the result as
     // unexpandable.
     if (IdentifierInfo *NewII = Identifier.getIdentifierInfo()) {
-      if (MacroInfo *NewMI = getMacroInfo(NewII))
-        if (!NewMI->isEnabled() || NewMI == MI) {
-          Identifier.setFlag(Token::DisableExpand);
-          // Don't warn for "#define X X" like "#define bool bool" from
-          // stdbool.h.
-          if (NewMI != MI || MI->isFunctionLike())
-            Diag(Identifier, diag::pp_disabled_macro_expansion);
+      if (MacroInfo *NewMI = getMacroInfo(NewII)) {
+        if (NewMI->isEnabled() && NewMI != MI) {
+          // The result is the next macro of a single token chain.  Expand it
+          // in place, with this macro disabled as it would be while its
+          // TokenLexer is active.
+          Identifier.setKind(NewII->getTokenID());
+          ++NumFastMacroExpanded;
+          MI->DisableMacro();
+          bool Result = HandleIdentifier(Identifier);
+          MI->EnableMacro();
+          return Result;
         }
+
+        Identifier.setFlag(Token::DisableExpand);
+        // Don't warn for "#define X X" like "#define bool bool" from
+        // stdbool.h.
+        if (NewMI != MI || MI->isFunctionLike())
+          Diag(Identifier, diag::pp_disabled_macro_expansion);
+      }
     }
 
     // Since this is not an identifier token, it can't be macro expanded, so
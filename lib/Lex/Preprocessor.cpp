@@ -883,9 +883,7 @@ bool Preprocessor::HandleIdentifier(Token &Identifier) {
   return true;
 }
 
-void Preprocessor::Lex(Token &Result) {
-  ++LexLevel;
-
+void Preprocessor::LexFromCurrentLexer(Token &Result) {
   // We loop here until a lex function returns a token; this avoids recursion.
   bool ReturnedToken;
   do {
@@ -905,6 +903,12 @@ void Preprocessor::Lex(Token &Result) {
       break;
     }
   } while (!ReturnedToken);
+}
+
+void Preprocessor::Lex(Token &Result) {
+  ++LexLevel;
+
+  LexFromCurrentLexer(Result);
 
   if (Result.is(tok::code_completion) && Result.getIdentifierInfo()) {
     // Remember the identifier before code completion token.
@@ -963,6 +967,34 @@ void Preprocessor::Lex(Token &Result) {
     OnToken(Result);
 }
 
+unsigned Preprocessor::LexTokens(MutableArrayRef<Token> Toks) {
+  assert(!Toks.empty() && "Lexing into an empty buffer makes no progress");
+  unsigned NumToks = 0;
+
+  // A token watcher, C++20 import-seq tracking and code completion all need
+  // the full bookkeeping in Lex().
+  if (OnToken || getLangOpts().CPlusPlusModules || isCodeCompletionEnabled()) {
+    while (NumToks != Toks.size()) {
+      Token &Result = Toks[NumToks++];
+      Lex(Result);
+      if (Result.is(tok::eof))
+        break;
+    }
+    return NumToks;
+  }
+
+  while (NumToks != Toks.size()) {
+    Token &Result = Toks[NumToks++];
+    ++LexLevel;
+    LexFromCurrentLexer(Result);
+    LastTokenWasAt = Result.is(tok::at);
+    --LexLevel;
+    if (Result.is(tok::eof))
+      break;
+  }
+  return NumToks;
+}
+
 /// Lex a header-name token (including one formed from header-name-tokens if
 /// \p AllowConcatenation is \c true).
 ///
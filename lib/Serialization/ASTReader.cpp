@@ -8071,10 +8071,20 @@ void ASTReader::ReadMethodPool(Selector Sel) {
   Generation = getGeneration();
   SelectorOutOfDate[Sel] = false;
 
+  // If there is a global index, look there first to determine which modules
+  // provably do not have any methods with this selector.
+  GlobalModuleIndex::HitSet Hits;
+  GlobalModuleIndex::HitSet *HitsPtr = nullptr;
+  if (!loadGlobalIndex()) {
+    if (GlobalIndex->lookupSelector(Sel, Hits)) {
+      HitsPtr = &Hits;
+    }
+  }
+
   // Search for methods defined with this selector.
   ++NumMethodPoolLookups;
   ReadMethodPoolVisitor Visitor(*this, Sel, PriorGeneration);
-  ModuleMgr.visit(Visitor);
+  ModuleMgr.visit(Visitor, HitsPtr);
 
   if (Visitor.getInstanceMethods().empty() &&
       Visitor.getFactoryMethods().empty())
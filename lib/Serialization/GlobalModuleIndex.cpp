@@ -11,8 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Serialization/GlobalModuleIndex.h"
+#include "ASTCommon.h"
 #include "ASTReaderInternals.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/IdentifierTable.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Serialization/ASTBitCodes.h"
 #include "clang/Serialization/ModuleFile.h"
@@ -32,6 +34,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
+#include <map>
 using namespace clang;
 using namespace serialization;
 
@@ -52,7 +55,9 @@ namespace {
     /// Describes a module, including its file name and dependencies.
     MODULE,
     /// The index for identifiers.
-    IDENTIFIER_INDEX
+    IDENTIFIER_INDEX,
+    /// The index for Objective-C selectors, keyed by selector hash.
+    SELECTOR_INDEX
   };
 }
 
@@ -123,13 +128,66 @@ public:
 typedef llvm::OnDiskIterableChainedHashTable<IdentifierIndexReaderTrait>
     IdentifierIndexTable;
 
+/// Trait used to read the selector index from the on-disk hash table.
+///
+/// The keys are the hashes computed by \c serialization::ComputeHash(Selector),
+/// which only depend on the spelling of the selector and are therefore stable
+/// across module files.
+class SelectorIndexReaderTrait {
+public:
+  typedef unsigned external_key_type;
+  typedef unsigned internal_key_type;
+  typedef SmallVector<unsigned, 2> data_type;
+  typedef unsigned hash_value_type;
+  typedef unsigned offset_type;
+
+  static bool EqualKey(internal_key_type a, internal_key_type b) {
+    return a == b;
+  }
+
+  static hash_value_type ComputeHash(internal_key_type a) { return a; }
+
+  static std::pair<unsigned, unsigned>
+  ReadKeyDataLength(const unsigned char*& d) {
+    using namespace llvm::support;
+    unsigned DataLen = endian::readNext<uint16_t, little, unaligned>(d);
+    return std::make_pair(4u, DataLen);
+  }
+
+  static const internal_key_type&
+  GetInternalKey(const external_key_type& x) { return x; }
+
+  static internal_key_type ReadKey(const unsigned char* d, unsigned) {
+    using namespace llvm::support;
+    return endian::readNext<uint32_t, little, unaligned>(d);
+  }
+
+  static data_type ReadData(internal_key_type, const unsigned char* d,
+                            unsigned DataLen) {
+    using namespace llvm::support;
+
+    data_type Result;
+    while (DataLen > 0) {
+      unsigned ID = endian::readNext<uint32_t, little, unaligned>(d);
+      Result.push_back(ID);
+      DataLen -= 4;
+    }
+
+    return Result;
+  }
+};
+
+typedef llvm::OnDiskChainedHashTable<SelectorIndexReaderTrait>
+    SelectorIndexTable;
+
 }
 
 GlobalModuleIndex::GlobalModuleIndex(
     std::unique_ptr<llvm::MemoryBuffer> IndexBuffer,
     llvm::BitstreamCursor Cursor)
-    : Buffer(std::move(IndexBuffer)), IdentifierIndex(), NumIdentifierLookups(),
-      NumIdentifierLookupHits() {
+    : Buffer(std::move(IndexBuffer)), IdentifierIndex(), SelectorIndex(),
+      NumIdentifierLookups(), NumIdentifierLookupHits(), NumSelectorLookups(),
+      NumSelectorLookupHits() {
   auto Fail = [&](llvm::Error &&Err) {
     report_fatal_error("Module index '" + Buffer->getBufferIdentifier() +
                        "' failed: " + toString(std::move(Err)));
@@ -241,12 +299,22 @@ GlobalModuleIndex::GlobalModuleIndex(
             (const unsigned char *)Blob.data(), IdentifierIndexReaderTrait());
       }
       break;
+
+    case SELECTOR_INDEX:
+      // Wire up the selector index.
+      if (Record[0]) {
+        SelectorIndex = SelectorIndexTable::Create(
+            (const unsigned char *)Blob.data() + Record[0],
+            (const unsigned char *)Blob.data(), SelectorIndexReaderTrait());
+      }
+      break;
     }
   }
 }
 
 GlobalModuleIndex::~GlobalModuleIndex() {
   delete static_cast<IdentifierIndexTable *>(IdentifierIndex);
+  delete static_cast<SelectorIndexTable *>(SelectorIndex);
 }
 
 std::pair<GlobalModuleIndex *, llvm::Error>
@@ -334,6 +402,32 @@ bool GlobalModuleIndex::lookupIdentifier(StringRef Name, HitSet &Hits) {
   return true;
 }
 
+bool GlobalModuleIndex::lookupSelector(Selector Sel, HitSet &Hits) {
+  Hits.clear();
+
+  // If there's no selector index, there is nothing we can do.
+  if (!SelectorIndex)
+    return false;
+
+  // Look into the selector index.
+  ++NumSelectorLookups;
+  SelectorIndexTable &Table = *static_cast<SelectorIndexTable *>(SelectorIndex);
+  SelectorIndexTable::iterator Known =
+      Table.find(serialization::ComputeHash(Sel));
+  if (Known == Table.end()) {
+    return true;
+  }
+
+  SmallVector<unsigned, 2> ModuleIDs = *Known;
+  for (unsigned I = 0, N = ModuleIDs.size(); I != N; ++I) {
+    if (ModuleFile *MF = Modules[ModuleIDs[I]].File)
+      Hits.insert(MF);
+  }
+
+  ++NumSelectorLookupHits;
+  return true;
+}
+
 bool GlobalModuleIndex::loadedModuleFile(ModuleFile *File) {
   // Look for the module in the global module index based on the module name.
   StringRef Name = File->ModuleName;
@@ -368,6 +462,11 @@ void GlobalModuleIndex::printStats() {
             NumIdentifierLookupHits, NumIdentifierLookups,
             (double)NumIdentifierLookupHits*100.0/NumIdentifierLookups);
   }
+  if (NumSelectorLookups) {
+    fprintf(stderr, "  %u / %u selector lookups succeeded (%f%%)\n",
+            NumSelectorLookupHits, NumSelectorLookups,
+            (double)NumSelectorLookupHits*100.0/NumSelectorLookups);
+  }
   std::fprintf(stderr, "\n");
 }
 
@@ -435,6 +534,17 @@ namespace {
     /// files in which those identifiers are considered interesting.
     InterestingIdentifierMap InterestingIdentifiers;
 
+    /// Mapping from selector hashes to the list of module file IDs that
+    /// declare Objective-C methods with a selector of that hash.
+    ///
+    /// This is a std::map because every 32-bit value is a valid hash, which
+    /// rules out the reserved keys of a DenseMap.
+    typedef std::map<unsigned, SmallVector<unsigned, 2> > SelectorMethodMap;
+
+    /// A mapping from selector hashes to the set of module files whose
+    /// method pool has methods for that selector.
+    SelectorMethodMap SelectorMethods;
+
     /// Write the block-info block for the global module index file.
     void emitBlockInfoBlock(llvm::BitstreamWriter &Stream);
 
@@ -501,6 +611,7 @@ GlobalModuleIndexBuilder::emitBlockInfoBlock(llvm::BitstreamWriter &Stream) {
   RECORD(INDEX_METADATA);
   RECORD(MODULE);
   RECORD(IDENTIFIER_INDEX);
+  RECORD(SELECTOR_INDEX);
 #undef RECORD
 #undef BLOCK
 
@@ -702,6 +813,51 @@ llvm::Error GlobalModuleIndexBuilder::loadModuleFile(const FileEntry *File) {
       }
     }
 
+    // Handle the method pool. We only need the hash of each selector and
+    // whether this module file has any methods for it, both of which can be
+    // read without resolving the module-local identifier IDs in the key.
+    if (State == ASTBlock && Code == METHOD_POOL && Record[0] > 0) {
+      using namespace llvm::support;
+      const unsigned char *Base = (const unsigned char *)Blob.data();
+      const unsigned char *Buckets = Base + Record[0];
+      unsigned NumBuckets =
+          endian::readNext<uint32_t, little, unaligned>(Buckets);
+      // Skip the number of entries.
+      Buckets += sizeof(uint32_t);
+      for (unsigned B = 0; B != NumBuckets; ++B) {
+        uint32_t BucketOffset =
+            endian::readNext<uint32_t, little, unaligned>(Buckets);
+        if (!BucketOffset)
+          continue;
+
+        const unsigned char *Item = Base + BucketOffset;
+        unsigned NumItems = endian::readNext<uint16_t, little, unaligned>(Item);
+        for (unsigned I = 0; I != NumItems; ++I) {
+          unsigned Hash = endian::readNext<uint32_t, little, unaligned>(Item);
+          unsigned KeyLen =
+              endian::readNext<uint16_t, little, unaligned>(Item);
+          unsigned DataLen =
+              endian::readNext<uint16_t, little, unaligned>(Item);
+          const unsigned char *Data = Item + KeyLen;
+          Item = Data + DataLen;
+
+          // Skip the selector ID. The method counts are stored above the
+          // three low bits of the instance and factory method words.
+          Data += sizeof(uint32_t);
+          unsigned NumInstanceMethods =
+              endian::readNext<uint16_t, little, unaligned>(Data) >> 3;
+          unsigned NumFactoryMethods =
+              endian::readNext<uint16_t, little, unaligned>(Data) >> 3;
+          if (!NumInstanceMethods && !NumFactoryMethods)
+            continue;
+
+          SmallVectorImpl<unsigned> &IDs = SelectorMethods[Hash];
+          if (IDs.empty() || IDs.back() != ID)
+            IDs.push_back(ID);
+        }
+      }
+    }
+
     // Get Signature.
     if (State == DiagnosticOptionsBlock && Code == SIGNATURE)
       getModuleFileInfo(File).Signature = {
@@ -754,6 +910,39 @@ public:
   }
 };
 
+/// Trait used to generate the selector index as an on-disk hash table.
+class SelectorIndexWriterTrait {
+public:
+  typedef unsigned key_type;
+  typedef unsigned key_type_ref;
+  typedef SmallVector<unsigned, 2> data_type;
+  typedef const SmallVector<unsigned, 2> &data_type_ref;
+  typedef unsigned hash_value_type;
+  typedef unsigned offset_type;
+
+  static hash_value_type ComputeHash(key_type_ref Key) { return Key; }
+
+  std::pair<unsigned,unsigned>
+  EmitKeyDataLength(raw_ostream& Out, key_type_ref Key, data_type_ref Data) {
+    using namespace llvm::support;
+    unsigned DataLen = Data.size() * 4;
+    endian::write<uint16_t>(Out, DataLen, little);
+    return std::make_pair(4u, DataLen);
+  }
+
+  void EmitKey(raw_ostream& Out, key_type_ref Key, unsigned KeyLen) {
+    using namespace llvm::support;
+    endian::write<uint32_t>(Out, Key, little);
+  }
+
+  void EmitData(raw_ostream& Out, key_type_ref Key, data_type_ref Data,
+                unsigned DataLen) {
+    using namespace llvm::support;
+    for (unsigned I = 0, N = Data.size(); I != N; ++I)
+      endian::write<uint32_t>(Out, Data[I], little);
+  }
+};
+
 }
 
 bool GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
@@ -845,6 +1034,41 @@ bool GlobalModuleIndexBuilder::writeIndex(llvm::BitstreamWriter &Stream) {
     Stream.EmitRecordWithBlob(IDTableAbbrev, Record, IdentifierTable);
   }
 
+  // Write the selector hash -> module file mapping.
+  {
+    llvm::OnDiskChainedHashTableGenerator<SelectorIndexWriterTrait> Generator;
+    SelectorIndexWriterTrait Trait;
+
+    // Populate the hash table.
+    for (SelectorMethodMap::iterator S = SelectorMethods.begin(),
+                                     SEnd = SelectorMethods.end();
+         S != SEnd; ++S) {
+      Generator.insert(S->first, S->second, Trait);
+    }
+
+    // Create the on-disk hash table in a buffer.
+    SmallString<4096> SelectorTable;
+    uint32_t BucketOffset;
+    {
+      using namespace llvm::support;
+      llvm::raw_svector_ostream Out(SelectorTable);
+      // Make sure that no bucket is at offset 0
+      endian::write<uint32_t>(Out, 0, little);
+      BucketOffset = Generator.Emit(Out, Trait);
+    }
+
+    // Create a blob abbreviation
+    auto Abbrev = std::make_shared<BitCodeAbbrev>();
+    Abbrev->Add(BitCodeAbbrevOp(SELECTOR_INDEX));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+    unsigned SelTableAbbrev = Stream.EmitAbbrev(std::move(Abbrev));
+
+    // Write the selector table
+    uint64_t Record[] = {SELECTOR_INDEX, BucketOffset};
+    Stream.EmitRecordWithBlob(SelTableAbbrev, Record, SelectorTable);
+  }
+
   Stream.ExitBlock();
   return false;
 }
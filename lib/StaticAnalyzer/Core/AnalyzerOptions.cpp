@@ -76,6 +76,7 @@ AnalyzerOptions::getExplorationStrategy() const {
                 ExplorationStrategyKind::UnexploredFirstLocationQueue)
           .Case("bfs_block_dfs_contents",
                 ExplorationStrategyKind::BFSBlockDFSContents)
+          .Case("coverage_guided", ExplorationStrategyKind::CoverageGuided)
           .Default(None);
   assert(K.hasValue() && "User mode is invalid.");
   return K.getValue();
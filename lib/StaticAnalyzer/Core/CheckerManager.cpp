@@ -26,7 +26,9 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/TimeProfiler.h"
 #include <cassert>
+#include <chrono>
 #include <vector>
 
 using namespace clang;
@@ -770,17 +772,51 @@ void CheckerManager::runCheckersForPrintStateJson(raw_ostream &Out,
   Out << NL;
 }
 
+//===----------------------------------------------------------------------===//
+// Profiling of the checker callbacks.
+//===----------------------------------------------------------------------===//
+
+static uint64_t getNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+CheckerCallbackProfile::Scope::Scope(CheckerCallbackProfile &Profile)
+    : Profile(Profile), Start(getNanoseconds()) {
+  if (llvm::timeTraceProfilerEnabled())
+    llvm::timeTraceProfilerBegin(Profile.Callback, Profile.CheckerName);
+}
+
+CheckerCallbackProfile::Scope::~Scope() {
+  if (llvm::timeTraceProfilerEnabled())
+    llvm::timeTraceProfilerEnd();
+  ++Profile.NumCalls;
+  Profile.Nanoseconds += getNanoseconds() - Start;
+}
+
+template <typename T>
+void CheckerManager::profileCallback(CheckerFn<T> &Fn, StringRef Callback) {
+  if (!AOptions.ShouldProfileCheckers)
+    return;
+  CallbackProfiles.push_back(std::make_unique<CheckerCallbackProfile>(
+      Fn.Checker->getCheckerName(), Callback));
+  Fn.Profile = CallbackProfiles.back().get();
+}
+
 //===----------------------------------------------------------------------===//
 // Internal registration functions for AST traversing.
 //===----------------------------------------------------------------------===//
 
 void CheckerManager::_registerForDecl(CheckDeclFunc checkfn,
                                       HandlesDeclFunc isForDeclFn) {
+  profileCallback(checkfn, "checkASTDecl");
   DeclCheckerInfo info = { checkfn, isForDeclFn };
   DeclCheckers.push_back(info);
 }
 
 void CheckerManager::_registerForBody(CheckDeclFunc checkfn) {
+  profileCallback(checkfn, "checkASTCodeBody");
   BodyCheckers.push_back(checkfn);
 }
 
@@ -790,95 +826,117 @@ void CheckerManager::_registerForBody(CheckDeclFunc checkfn) {
 
 void CheckerManager::_registerForPreStmt(CheckStmtFunc checkfn,
                                          HandlesStmtFunc isForStmtFn) {
+  profileCallback(checkfn, "checkPreStmt");
   StmtCheckerInfo info = { checkfn, isForStmtFn, /*IsPreVisit*/true };
   StmtCheckers.push_back(info);
 }
 
 void CheckerManager::_registerForPostStmt(CheckStmtFunc checkfn,
                                           HandlesStmtFunc isForStmtFn) {
+  profileCallback(checkfn, "checkPostStmt");
   StmtCheckerInfo info = { checkfn, isForStmtFn, /*IsPreVisit*/false };
   StmtCheckers.push_back(info);
 }
 
 void CheckerManager::_registerForPreObjCMessage(CheckObjCMessageFunc checkfn) {
+  profileCallback(checkfn, "checkPreObjCMessage");
   PreObjCMessageCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForObjCMessageNil(CheckObjCMessageFunc checkfn) {
+  profileCallback(checkfn, "checkObjCMessageNil");
   ObjCMessageNilCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForPostObjCMessage(CheckObjCMessageFunc checkfn) {
+  profileCallback(checkfn, "checkPostObjCMessage");
   PostObjCMessageCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForPreCall(CheckCallFunc checkfn) {
+  profileCallback(checkfn, "checkPreCall");
   PreCallCheckers.push_back(checkfn);
 }
 void CheckerManager::_registerForPostCall(CheckCallFunc checkfn) {
+  profileCallback(checkfn, "checkPostCall");
   PostCallCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForLocation(CheckLocationFunc checkfn) {
+  profileCallback(checkfn, "checkLocation");
   LocationCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForBind(CheckBindFunc checkfn) {
+  profileCallback(checkfn, "checkBind");
   BindCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForEndAnalysis(CheckEndAnalysisFunc checkfn) {
+  profileCallback(checkfn, "checkEndAnalysis");
   EndAnalysisCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForBeginFunction(CheckBeginFunctionFunc checkfn) {
+  profileCallback(checkfn, "checkBeginFunction");
   BeginFunctionCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForEndFunction(CheckEndFunctionFunc checkfn) {
+  profileCallback(checkfn, "checkEndFunction");
   EndFunctionCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForBranchCondition(
                                              CheckBranchConditionFunc checkfn) {
+  profileCallback(checkfn, "checkBranchCondition");
   BranchConditionCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForNewAllocator(CheckNewAllocatorFunc checkfn) {
+  profileCallback(checkfn, "checkNewAllocator");
   NewAllocatorCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForLiveSymbols(CheckLiveSymbolsFunc checkfn) {
+  profileCallback(checkfn, "checkLiveSymbols");
   LiveSymbolsCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForDeadSymbols(CheckDeadSymbolsFunc checkfn) {
+  profileCallback(checkfn, "checkDeadSymbols");
   DeadSymbolsCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForRegionChanges(CheckRegionChangesFunc checkfn) {
+  profileCallback(checkfn, "checkRegionChanges");
   RegionChangesCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForPointerEscape(CheckPointerEscapeFunc checkfn){
+  profileCallback(checkfn, "checkPointerEscape");
   PointerEscapeCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForConstPointerEscape(
                                           CheckPointerEscapeFunc checkfn) {
+  profileCallback(checkfn, "checkConstPointerEscape");
   PointerEscapeCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForEvalAssume(EvalAssumeFunc checkfn) {
+  profileCallback(checkfn, "evalAssume");
   EvalAssumeCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForEvalCall(EvalCallFunc checkfn) {
+  profileCallback(checkfn, "evalCall");
   EvalCallCheckers.push_back(checkfn);
 }
 
 void CheckerManager::_registerForEndOfTranslationUnit(
                                             CheckEndOfTranslationUnit checkfn) {
+  profileCallback(checkfn, "checkEndOfTranslationUnit");
   EndOfTranslationUnitCheckers.push_back(checkfn);
 }
 
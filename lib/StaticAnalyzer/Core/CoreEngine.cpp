@@ -47,6 +47,14 @@ STATISTIC(NumReachedMaxSteps,
             "The # of times we reached the max number of steps.");
 STATISTIC(NumPathsExplored,
             "The # of paths explored by the analyzer.");
+STATISTIC(NumGraphCompactions,
+            "The # of times the exploded graph was compacted.");
+STATISTIC(NumNodesCompacted,
+            "The # of nodes removed by compacting the exploded graph.");
+STATISTIC(MaxGraphMemory,
+            "The maximum memory (in bytes) allocated for a single analysis.");
+STATISTIC(MaxGraphNodes,
+            "The maximum # of nodes in the graph of a single analysis.");
 
 //===----------------------------------------------------------------------===//
 // Core analysis engine.
@@ -67,6 +75,8 @@ static std::unique_ptr<WorkList> generateWorkList(AnalyzerOptions &Opts,
       return WorkList::makeUnexploredFirstPriorityQueue();
     case ExplorationStrategyKind::UnexploredFirstLocationQueue:
       return WorkList::makeUnexploredFirstPriorityLocationQueue();
+    case ExplorationStrategyKind::CoverageGuided:
+      return WorkList::makeCoverageGuidedQueue();
   }
   llvm_unreachable("Unknown AnalyzerOptions::ExplorationStrategyKind");
 }
@@ -74,7 +84,8 @@ static std::unique_ptr<WorkList> generateWorkList(AnalyzerOptions &Opts,
 CoreEngine::CoreEngine(SubEngine &subengine, FunctionSummariesTy *FS,
                        AnalyzerOptions &Opts)
     : SubEng(subengine), WList(generateWorkList(Opts, subengine)),
-      BCounterFactory(G.getAllocator()), FunctionSummaries(FS) {}
+      BCounterFactory(G.getAllocator()), FunctionSummaries(FS),
+      GraphMemoryBudget(uint64_t(Opts.GraphMemoryBudget) << 20) {}
 
 /// ExecuteWorkList - Run the worklist algorithm for a maximum number of steps.
 bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
@@ -126,6 +137,9 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
   if(!UnlimitedSteps)
     G.reserve(std::min(Steps,PreReservationCap));
 
+  // Compacting the graph is only safe if nothing inspects it as a whole.
+  bool MayCompactGraph = GraphMemoryBudget && SubEng.canCompactGraph();
+
   while (WList->hasWork()) {
     if (!UnlimitedSteps) {
       if (Steps == 0) {
@@ -146,11 +160,46 @@ bool CoreEngine::ExecuteWorkList(const LocationContext *L, unsigned Steps,
     ExplodedNode *Node = WU.getNode();
 
     dispatchWorkItem(Node, Node->getLocation(), WU);
+
+    MaxGraphSize = std::max(MaxGraphSize, G.size());
+    if (MayCompactGraph && shouldCompactGraph())
+      compactGraph();
   }
+  MaxGraphNodes.updateMax(MaxGraphSize);
+  MaxGraphMemory.updateMax(G.getAllocator().getTotalMemory());
   SubEng.processEndWorklist();
   return WList->hasWork();
 }
 
+bool CoreEngine::shouldCompactGraph() const {
+  // The memory of the nodes removed by the last compaction is reused before
+  // the allocator grows again.
+  if (G.hasFreeNodes())
+    return false;
+
+  if (G.getAllocator().getBytesAllocated() < GraphMemoryBudget)
+    return false;
+
+  // Don't compact over and over again if most of the graph is still needed.
+  return G.size() >= 2 * uint64_t(NumNodesAfterCompaction);
+}
+
+void CoreEngine::compactGraph() {
+  SmallVector<const ExplodedNode *, 256> Live;
+  WList->visitUnits(
+      [&Live](const WorkListUnit &U) { Live.push_back(U.getNode()); });
+  for (const auto &I : blocksExhausted)
+    Live.push_back(I.second);
+  for (const auto &I : blocksAborted)
+    Live.push_back(I.second);
+  SmallVector<const ExplodedNode *, 16> Subgraphs;
+  SubEng.collectLiveNodes(Live, Subgraphs);
+
+  ++NumGraphCompactions;
+  NumNodesCompacted += G.compact(Live, Subgraphs);
+  NumNodesAfterCompaction = G.size();
+}
+
 void CoreEngine::dispatchWorkItem(ExplodedNode* Pred, ProgramPoint Loc,
                                   const WorkListUnit& WU) {
   // Dispatch on the location type.
@@ -25,7 +25,9 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/SymExpr.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SymbolManager.h"
 #include "llvm/ADT/ImmutableMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
@@ -178,9 +180,11 @@ EnvironmentManager::removeDeadBindings(Environment Env,
   MarkLiveCallback CB(SymReaper);
   ScanReachableSymbols RSScaner(ST, CB);
 
+#if !CLANG_ANALYZER_HASH_TRIE_STATE
   llvm::ImmutableMapRef<EnvironmentEntry, SVal>
     EBMapRef(NewEnv.ExprBindings.getRootWithoutRetain(),
              F.getTreeFactory());
+#endif
 
   // Iterate over the block-expr bindings.
   for (Environment::iterator I = Env.begin(), E = Env.end();
@@ -190,14 +194,20 @@ EnvironmentManager::removeDeadBindings(Environment Env,
 
     if (SymReaper.isLive(BlkExpr.getStmt(), BlkExpr.getLocationContext())) {
       // Copy the binding to the new map.
+#if CLANG_ANALYZER_HASH_TRIE_STATE
+      NewEnv.ExprBindings = F.add(NewEnv.ExprBindings, BlkExpr, X);
+#else
       EBMapRef = EBMapRef.add(BlkExpr, X);
+#endif
 
       // Mark all symbols in the block expr's value live.
       RSScaner.scan(X);
     }
   }
 
+#if !CLANG_ANALYZER_HASH_TRIE_STATE
   NewEnv.ExprBindings = EBMapRef.asImmutableMap();
+#endif
   return NewEnv;
 }
 
@@ -234,52 +244,44 @@ void Environment::printJson(raw_ostream &Out, const ASTContext &Ctx,
 
   LCtx->printJson(Out, NL, Space, IsDot, [&](const LocationContext *LC) {
     // LCtx items begin
-    bool HasItem = false;
-    unsigned int InnerSpace = Space + 1;
-
-    // Store the last ExprBinding which we will print.
-    BindingsTy::iterator LastI = ExprBindings.end();
-    for (BindingsTy::iterator I = ExprBindings.begin(); I != ExprBindings.end();
-         ++I) {
-      if (I->first.getLocationContext() != LC)
+    // The bindings are not ordered by their statements in the map, so sort
+    // them by statement to keep the output stable.
+    SmallVector<std::pair<int64_t, const BindingsTy::value_type *>, 16> Items;
+    for (const BindingsTy::value_type &I : *this) {
+      if (I.first.getLocationContext() != LC)
         continue;
 
-      if (!HasItem) {
-        HasItem = true;
-        Out << '[' << NL;
-      }
-
-      const Stmt *S = I->first.getStmt();
-      (void)S;
+      const Stmt *S = I.first.getStmt();
       assert(S != nullptr && "Expected non-null Stmt");
+      Items.push_back(std::make_pair(S->getID(Ctx), &I));
+    }
 
-      LastI = I;
+    if (Items.empty()) {
+      Out << "null ";
+      return;
     }
 
-    for (BindingsTy::iterator I = ExprBindings.begin(); I != ExprBindings.end();
-         ++I) {
-      if (I->first.getLocationContext() != LC)
-        continue;
+    llvm::sort(Items, llvm::less_first());
 
-      const Stmt *S = I->first.getStmt();
+    unsigned int InnerSpace = Space + 1;
+    Out << '[' << NL;
+    for (const auto &Item : Items) {
+      const Stmt *S = Item.second->first.getStmt();
       Indent(Out, InnerSpace, IsDot)
-          << "{ \"stmt_id\": " << S->getID(Ctx) << ", \"pretty\": ";
+          << "{ \"stmt_id\": " << Item.first << ", \"pretty\": ";
       S->printJson(Out, nullptr, PP, /*AddQuotes=*/true);
 
       Out << ", \"value\": ";
-      I->second.printJson(Out, /*AddQuotes=*/true);
+      Item.second->second.printJson(Out, /*AddQuotes=*/true);
 
       Out << " }";
 
-      if (I != LastI)
+      if (&Item != &Items.back())
         Out << ',';
       Out << NL;
     }
 
-    if (HasItem)
-      Indent(Out, --InnerSpace, IsDot) << ']';
-    else
-      Out << "null ";
+    Indent(Out, --InnerSpace, IsDot) << ']';
   });
 
   Indent(Out, --Space, IsDot) << "]}," << NL;
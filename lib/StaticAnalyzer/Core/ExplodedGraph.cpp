@@ -29,6 +29,7 @@
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Casting.h"
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -186,6 +187,62 @@ void ExplodedGraph::reclaimRecentlyAllocatedNodes() {
   ChangedNodes.clear();
 }
 
+unsigned ExplodedGraph::compact(ArrayRef<const ExplodedNode *> Live,
+                                ArrayRef<const ExplodedNode *> Subgraphs) {
+  // Collect the given subgraphs.
+  llvm::DenseSet<const ExplodedNode *> Below;
+  SmallVector<const ExplodedNode *, 32> Worklist(Subgraphs.begin(),
+                                                 Subgraphs.end());
+  while (!Worklist.empty()) {
+    const ExplodedNode *N = Worklist.pop_back_val();
+    if (!N || !Below.insert(N).second)
+      continue;
+    Worklist.append(N->succ_begin(), N->succ_end());
+  }
+
+  // Mark the given nodes, the subgraphs, the roots, and everything they were
+  // derived from.
+  llvm::DenseSet<const ExplodedNode *> Reachable;
+  Worklist.append(Live.begin(), Live.end());
+  Worklist.append(Below.begin(), Below.end());
+  Worklist.append(Roots.begin(), Roots.end());
+  while (!Worklist.empty()) {
+    const ExplodedNode *N = Worklist.pop_back_val();
+    if (!N || !Reachable.insert(N).second)
+      continue;
+    Worklist.append(N->pred_begin(), N->pred_end());
+  }
+
+  if (Reachable.size() >= Nodes.size())
+    return 0;
+
+  // The predecessors of a kept node are kept as well, so only the successor
+  // lists of the kept nodes need to forget about the removed nodes.
+  auto IsRemoved = [&Reachable](const ExplodedNode *N) {
+    return !Reachable.count(N);
+  };
+  NodeVector Removed;
+  for (ExplodedNode &N : Nodes) {
+    if (IsRemoved(&N))
+      Removed.push_back(&N);
+    else
+      N.Succs.removeNodes(IsRemoved);
+  }
+
+  llvm::erase_if(ChangedNodes, IsRemoved);
+  llvm::erase_if(EndNodes, IsRemoved);
+
+  for (ExplodedNode *N : Removed) {
+    Nodes.RemoveNode(N);
+    --NumNodes;
+    // Destroying the node releases its state, which is recycled by the
+    // ProgramStateManager once no other node refers to it.
+    N->~ExplodedNode();
+    FreeNodes.push_back(N);
+  }
+  return Removed.size();
+}
+
 //===----------------------------------------------------------------------===//
 // ExplodedNode.
 //===----------------------------------------------------------------------===//
@@ -218,6 +275,30 @@ void ExplodedNode::NodeGroup::replaceNode(ExplodedNode *node) {
   assert(Storage.is<ExplodedNode *>());
 }
 
+void ExplodedNode::NodeGroup::removeNodes(
+    llvm::function_ref<bool(const ExplodedNode *)> ShouldRemove) {
+  if (getFlag())
+    return;
+
+  GroupStorage &Storage = reinterpret_cast<GroupStorage&>(P);
+  if (Storage.isNull())
+    return;
+
+  if (ExplodedNodeVector *V = Storage.dyn_cast<ExplodedNodeVector *>()) {
+    ExplodedNodeVector::iterator NewEnd =
+        std::remove_if(V->begin(), V->end(), ShouldRemove);
+    while (V->end() != NewEnd)
+      V->pop_back();
+    // Keep empty() accurate; the vector itself is owned by the allocator.
+    if (V->empty())
+      P = 0;
+    return;
+  }
+
+  if (ShouldRemove(Storage.get<ExplodedNode *>()))
+    P = 0;
+}
+
 void ExplodedNode::NodeGroup::addNode(ExplodedNode *N, ExplodedGraph &G) {
   assert(!getFlag());
 
@@ -624,6 +624,28 @@ void ExprEngine::processEndWorklist() {
   getCheckerManager().runCheckersForEndAnalysis(G, BR, *this);
 }
 
+void ExprEngine::collectLiveNodes(
+    SmallVectorImpl<const ExplodedNode *> &Nodes,
+    SmallVectorImpl<const ExplodedNode *> &Subgraphs) {
+  for (const BugReportEquivClass &EQ :
+       llvm::make_range(BR.EQClasses_begin(), BR.EQClasses_end()))
+    for (const std::unique_ptr<BugReport> &R : EQ.getReports())
+      if (const auto *PR = dyn_cast<PathSensitiveBugReport>(R.get())) {
+        // Whether such a report is suppressed depends on the paths that
+        // continue from its error node.
+        if (PR->getBugType().isSuppressOnSink())
+          Subgraphs.push_back(PR->getErrorNode());
+        else
+          Nodes.push_back(PR->getErrorNode());
+      }
+}
+
+bool ExprEngine::canCompactGraph() const {
+  // Checkers that run at the end of the analysis may walk the whole graph, or
+  // refer to nodes they kept aside.
+  return !getCheckerManager().hasEndAnalysisCheckers();
+}
+
 void ExprEngine::processCFGElement(const CFGElement E, ExplodedNode *Pred,
                                    unsigned StmtIdx, NodeBuilderContext *Ctx) {
   PrettyStackTraceLocationContext CrashInfo(Pred->getLocationContext());
@@ -2330,6 +2352,15 @@ void ExprEngine::processEndOfFunction(NodeBuilderContext& BC,
 
   ExplodedNodeSet Dst;
   if (Pred->getLocationContext()->inTopFrame()) {
+    // Track whether the function never returns null, which is recorded in its
+    // summary.
+    const Expr *RetE = RS ? RS->getRetValue() : nullptr;
+    bool IsNonNull =
+        RetE && Loc::isLocType(RetE->getType()) &&
+        State->isNull(State->getSVal(RS, Pred->getLocationContext()))
+            .isConstrainedFalse();
+    ReturnsNonNull = ReturnsNonNull.getValueOr(true) && IsNonNull;
+
     // Remove dead symbols.
     ExplodedNodeSet AfterRemovedDead;
     removeDeadOnEndOfFunction(BC, Pred, AfterRemovedDead);
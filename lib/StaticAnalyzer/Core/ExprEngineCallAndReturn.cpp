@@ -700,6 +700,16 @@ ProgramStateRef ExprEngine::bindReturnValue(const CallEvent &Call,
     R = IsHeapPointer ? svalBuilder.getConjuredHeapSymbolVal(E, LCtx, Count)
                       : svalBuilder.conjureSymbolVal(nullptr, E, LCtx, ResultTy,
                                                      Count);
+
+    // The function summaries may know that the function never returns null.
+    const FunctionDecl *Definition;
+    if (isa<SimpleFunctionCall>(Call) && Loc::isLocType(ResultTy))
+      if (const auto *FD = dyn_cast_or_null<FunctionDecl>(Call.getDecl()))
+        if (FD->hasBody(Definition) &&
+            Engine.FunctionSummaries->returnsNonNull(Definition))
+          if (ProgramStateRef NonNull =
+                  State->assume(R.castAs<DefinedOrUnknownSVal>(), true))
+            State = NonNull;
   }
   return State->BindExpr(E, LCtx, R);
 }
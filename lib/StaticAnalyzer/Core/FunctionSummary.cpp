@@ -11,6 +11,18 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/StaticAnalyzer/Core/PathSensitive/FunctionSummary.h"
+#include "clang/Basic/Version.h"
+#include "clang/CrossTU/CrossTranslationUnit.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <tuple>
 
 using namespace clang;
 using namespace ento;
@@ -28,3 +40,127 @@ unsigned FunctionSummariesTy::getTotalNumVisitedBasicBlocks() {
     Total += I.second.VisitedBasicBlocks.count();
   return Total;
 }
+
+/// Returns the key under which the summary of \p D is stored between runs:
+/// the ODR hash of its body followed by its USR, so that a function whose
+/// body changed does not match its previous summary. The functions it calls
+/// are not part of the key, so changing them does not invalidate it.
+static Optional<std::string> getPersistentKey(const Decl *D) {
+  const auto *FD = dyn_cast<FunctionDecl>(D);
+  const FunctionDecl *Definition;
+  if (!FD || !FD->hasBody(Definition))
+    return None;
+  Optional<std::string> USR =
+      cross_tu::CrossTranslationUnitContext::getLookupName(Definition);
+  if (!USR)
+    return None;
+  unsigned Hash = const_cast<FunctionDecl *>(Definition)->getODRHash();
+  return llvm::utohexstr(Hash) + ' ' + *USR;
+}
+
+std::string
+FunctionSummariesTy::getPersistentSummaryDir(const AnalyzerOptions &Opts) {
+  std::string Config;
+  llvm::raw_string_ostream OS(Config);
+  OS << getClangFullVersion() << '\n'
+     << Opts.maxBlockVisitOnPath << ' ' << Opts.InlineMaxStackDepth << ' '
+     << Opts.InliningMode << ' ' << Opts.NoRetryExhausted << ' '
+     << Opts.AnalysisPurgeOpt << ' ' << Opts.eagerlyAssumeBinOpBifurcation
+     << '\n'
+     << Opts.UserMode << ' ' << Opts.IPAMode << ' '
+     << Opts.CXXMemberInliningMode << ' ' << Opts.ExplorationStrategy << ' '
+     << Opts.MaxNodesPerTopLevelFunction << ' ' << Opts.MaxInlinableSize << ' '
+     << Opts.MaxTimesInlineLarge << ' '
+     << Opts.MinCFGSizeTreatFunctionsAsLarge << '\n';
+  // Checkers may stop paths early, so they also affect the budget.
+  for (const auto &CheckerOrPackage : Opts.CheckersAndPackages)
+    OS << CheckerOrPackage.first << ':' << CheckerOrPackage.second << '\n';
+
+  SmallString<128> Dir(Opts.SummaryCacheDir);
+  llvm::sys::path::append(Dir, llvm::utohexstr(llvm::xxHash64(OS.str())));
+  return Dir.str().str();
+}
+
+// The facts recorded in the summary files, each followed by the key of a
+// function.
+static constexpr StringLiteral ReachedMaxBlockCountFact = "exhausts-budget";
+static constexpr StringLiteral ReturnsNonNullFact = "returns-nonnull";
+
+bool FunctionSummariesTy::isPersistentReachedMaxBlockCount(const Decl *D) {
+  Optional<std::string> Key = getPersistentKey(D);
+  return Key && PersistentReachedMaxBlockCount.count(*Key);
+}
+
+bool FunctionSummariesTy::isPersistentReturnsNonNull(const Decl *D) {
+  Optional<std::string> Key = getPersistentKey(D);
+  return Key && PersistentReturnsNonNull.count(*Key);
+}
+
+static std::string getSummaryFileName(StringRef TUName) {
+  return llvm::utohexstr(llvm::xxHash64(TUName)) + ".summaries";
+}
+
+void FunctionSummariesTy::loadPersistentSummaries(StringRef Dir,
+                                                  StringRef TUName) {
+  // Only the previous run on the same translation unit is used, so that the
+  // result does not depend on which other translation units were analyzed
+  // before.
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, getSummaryFileName(TUName));
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return;
+  SmallVector<StringRef, 32> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    StringRef Fact, Key;
+    std::tie(Fact, Key) = Line.split(' ');
+    if (Fact == ReachedMaxBlockCountFact)
+      PersistentReachedMaxBlockCount.insert(Key);
+    else if (Fact == ReturnsNonNullFact)
+      PersistentReturnsNonNull.insert(Key);
+  }
+}
+
+void FunctionSummariesTy::storePersistentSummaries(StringRef Dir,
+                                                   StringRef TUName) {
+  std::vector<std::string> Lines;
+  for (const auto &I : Map) {
+    if (!I.second.ReachedMaxBlockCount && !I.second.ReturnsNonNull)
+      continue;
+    Optional<std::string> Key = getPersistentKey(I.first);
+    if (!Key)
+      continue;
+    if (I.second.ReachedMaxBlockCount)
+      Lines.push_back((ReachedMaxBlockCountFact + " " + *Key).str());
+    if (I.second.ReturnsNonNull)
+      Lines.push_back((ReturnsNonNullFact + " " + *Key).str());
+  }
+  llvm::sort(Lines);
+
+  // Every translation unit, and every shard of it, writes its own file, so
+  // that concurrent runs do not lose each other's summaries.
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, getSummaryFileName(TUName));
+  if (Lines.empty()) {
+    llvm::sys::fs::remove(Path);
+    return;
+  }
+
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::create_directories(Dir) ||
+      llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%.tmp", FD, TempPath))
+    return;
+  llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  for (const std::string &Line : Lines)
+    OS << Line << '\n';
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    llvm::sys::fs::remove(TempPath);
+  } else if (llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+  }
+}
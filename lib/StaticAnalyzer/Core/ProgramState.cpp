@@ -18,11 +18,18 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/DynamicType.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/SubEngine.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 using namespace ento;
 
+#define DEBUG_TYPE "ProgramState"
+
+STATISTIC(NumStatesCreated, "The # of program states created");
+STATISTIC(NumStatesReused,
+          "The # of requests for a state that already existed");
+
 namespace clang { namespace  ento {
 /// Increments the number of times this state is referenced.
 
@@ -404,9 +411,12 @@ ProgramStateRef ProgramStateManager::getPersistentState(ProgramState &State) {
   State.Profile(ID);
   void *InsertPos;
 
-  if (ProgramState *I = StateSet.FindNodeOrInsertPos(ID, InsertPos))
+  if (ProgramState *I = StateSet.FindNodeOrInsertPos(ID, InsertPos)) {
+    ++NumStatesReused;
     return I;
+  }
 
+  ++NumStatesCreated;
   ProgramState *newState = nullptr;
   if (!freeStates.empty()) {
     newState = freeStates.back();
@@ -17,16 +17,76 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/ProgramStateTrait.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/RangedConstraintManager.h"
 #include "llvm/ADT/FoldingSet.h"
-#include "llvm/ADT/ImmutableSet.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace clang;
 using namespace ento;
 
-void RangeSet::IntersectInRange(BasicValueFactory &BV, Factory &F,
+// Order the ranges by their values rather than by the addresses of their
+// bounds, so that the order is consistent across runs.
+static bool isLess(const Range &LHS, const Range &RHS) {
+  return Range::isLess(LHS.From(), RHS.From()) ||
+         (!Range::isLess(RHS.From(), LHS.From()) &&
+          Range::isLess(LHS.To(), RHS.To()));
+}
+
+RangeSet RangeSet::Factory::getRangeSet(ArrayRef<Range> Ranges) {
+  if (Ranges.empty())
+    return getEmptySet();
+
+  // The ranges are usually produced in order, so only sort them when needed.
+  SmallVector<Range, 8> Sorted;
+  if (std::adjacent_find(Ranges.begin(), Ranges.end(),
+                         [](const Range &LHS, const Range &RHS) {
+                           return !isLess(LHS, RHS);
+                         }) != Ranges.end()) {
+    Sorted.assign(Ranges.begin(), Ranges.end());
+    llvm::sort(Sorted, isLess);
+    Sorted.erase(std::unique(Sorted.begin(), Sorted.end()), Sorted.end());
+    Ranges = Sorted;
+  }
+
+  auto I = Cache.find_as(Ranges);
+  if (I != Cache.end())
+    return RangeSet(*I);
+
+  Range *Elements = Alloc.Allocate<Range>(Ranges.size());
+  std::uninitialized_copy(Ranges.begin(), Ranges.end(), Elements);
+  const Storage *S = new (Alloc) Storage(Elements, Ranges.size());
+  Cache.insert(S);
+  return RangeSet(S);
+}
+
+RangeSet RangeSet::addRange(Factory &F, const RangeSet &RS) {
+  if (isEmpty())
+    return RS;
+  if (RS.isEmpty())
+    return *this;
+
+  SmallVector<Range, 8> Ranges(begin(), end());
+  Ranges.append(RS.begin(), RS.end());
+  return F.getRangeSet(Ranges);
+}
+
+void RangeSet::IntersectInRange(BasicValueFactory &BV,
                       const llvm::APSInt &Lower, const llvm::APSInt &Upper,
-                      PrimRangeSet &newRanges, PrimRangeSet::iterator &i,
-                      PrimRangeSet::iterator &e) const {
+                      SmallVectorImpl<Range> &newRanges, iterator &i,
+                      iterator e) const {
+  // The ranges are sorted and do not overlap, so skip the ones entirely
+  // before the intersection range with a binary search.
+  i = std::partition_point(i, e,
+                           [&](const Range &R) {
+                             return Range::isLess(R.To(), Lower);
+                           });
+
+  // Reuse the bounds of the existing ranges whenever they are equal to the
+  // bounds of the intersection range, which spares a lookup in the factory.
+  auto getValue = [&BV](const llvm::APSInt &V,
+                        const llvm::APSInt &Bound) -> const llvm::APSInt & {
+    return V == Bound ? Bound : BV.getValue(V);
+  };
+
   // There are six cases for each range R in the set:
   //   1. R is entirely before the intersection range.
   //   2. R is entirely after the intersection range.
@@ -36,33 +96,33 @@ void RangeSet::IntersectInRange(BasicValueFactory &BV, Factory &F,
   //   6. R is entirely contained in the intersection range.
   // These correspond to each of the conditions below.
   for (/* i = begin(), e = end() */; i != e; ++i) {
-    if (i->To() < Lower) {
+    if (Range::isLess(i->To(), Lower)) {
       continue;
     }
-    if (i->From() > Upper) {
+    if (Range::isLess(Upper, i->From())) {
       break;
     }
 
     if (i->Includes(Lower)) {
       if (i->Includes(Upper)) {
-        newRanges =
-            F.add(newRanges, Range(BV.getValue(Lower), BV.getValue(Upper)));
+        newRanges.push_back(
+            Range(getValue(Lower, i->From()), getValue(Upper, i->To())));
         break;
       } else
-        newRanges = F.add(newRanges, Range(BV.getValue(Lower), i->To()));
+        newRanges.push_back(Range(getValue(Lower, i->From()), i->To()));
     } else {
       if (i->Includes(Upper)) {
-        newRanges = F.add(newRanges, Range(i->From(), BV.getValue(Upper)));
+        newRanges.push_back(Range(i->From(), getValue(Upper, i->To())));
         break;
       } else
-        newRanges = F.add(newRanges, *i);
+        newRanges.push_back(*i);
     }
   }
 }
 
 const llvm::APSInt &RangeSet::getMinValue() const {
   assert(!isEmpty());
-  return ranges.begin()->From();
+  return begin()->From();
 }
 
 bool RangeSet::pin(llvm::APSInt &Lower, llvm::APSInt &Upper) const {
@@ -158,68 +218,73 @@ RangeSet RangeSet::Intersect(BasicValueFactory &BV, Factory &F,
   if (!pin(Lower, Upper))
     return F.getEmptySet();
 
-  PrimRangeSet newRanges = F.getEmptySet();
+  SmallVector<Range, 8> newRanges;
 
-  PrimRangeSet::iterator i = begin(), e = end();
+  iterator i = begin(), e = end();
   if (Lower <= Upper)
-    IntersectInRange(BV, F, Lower, Upper, newRanges, i, e);
+    IntersectInRange(BV, Lower, Upper, newRanges, i, e);
   else {
     // The order of the next two statements is important!
     // IntersectInRange() does not reset the iteration state for i and e.
     // Therefore, the lower range most be handled first.
-    IntersectInRange(BV, F, BV.getMinValue(Upper), Upper, newRanges, i, e);
-    IntersectInRange(BV, F, Lower, BV.getMaxValue(Lower), newRanges, i, e);
+    IntersectInRange(BV, BV.getMinValue(Upper), Upper, newRanges, i, e);
+    IntersectInRange(BV, Lower, BV.getMaxValue(Lower), newRanges, i, e);
   }
 
-  return newRanges;
+  // Intersecting with a range that covers the whole set is common; avoid
+  // looking the set up again in that case.
+  if (Impl && newRanges.size() == Impl->size() &&
+      std::equal(newRanges.begin(), newRanges.end(), begin()))
+    return *this;
+
+  return F.getRangeSet(newRanges);
 }
 
 // Returns a set containing the values in the receiving set, intersected with
 // the range set passed as parameter.
 RangeSet RangeSet::Intersect(BasicValueFactory &BV, Factory &F,
                              const RangeSet &Other) const {
-  PrimRangeSet newRanges = F.getEmptySet();
+  SmallVector<Range, 8> newRanges;
 
   for (iterator i = Other.begin(), e = Other.end(); i != e; ++i) {
     RangeSet newPiece = Intersect(BV, F, i->From(), i->To());
-    for (iterator j = newPiece.begin(), ee = newPiece.end(); j != ee; ++j) {
-      newRanges = F.add(newRanges, *j);
-    }
+    newRanges.append(newPiece.begin(), newPiece.end());
   }
 
-  return newRanges;
+  return F.getRangeSet(newRanges);
 }
 
 // Turn all [A, B] ranges to [-B, -A]. Ranges [MIN, B] are turned to range set
 // [MIN, MIN] U [-B, MAX], when MIN and MAX are the minimal and the maximal
 // signed values of the type.
 RangeSet RangeSet::Negate(BasicValueFactory &BV, Factory &F) const {
-  PrimRangeSet newRanges = F.getEmptySet();
+  SmallVector<Range, 8> newRanges;
 
   for (iterator i = begin(), e = end(); i != e; ++i) {
     const llvm::APSInt &from = i->From(), &to = i->To();
     const llvm::APSInt &newTo = (from.isMinSignedValue() ?
                                  BV.getMaxValue(from) :
                                  BV.getValue(- from));
-    if (to.isMaxSignedValue() && !newRanges.isEmpty() &&
-        newRanges.begin()->From().isMinSignedValue()) {
-      assert(newRanges.begin()->To().isMinSignedValue() &&
+    // Only the first range may start at MIN, which adds [MIN, MIN].
+    auto MinRange = llvm::find_if(newRanges, [](const Range &R) {
+      return R.From().isMinSignedValue();
+    });
+    if (to.isMaxSignedValue() && MinRange != newRanges.end()) {
+      assert(MinRange->To().isMinSignedValue() &&
              "Ranges should not overlap");
       assert(!from.isMinSignedValue() && "Ranges should not overlap");
-      const llvm::APSInt &newFrom = newRanges.begin()->From();
-      newRanges =
-        F.add(F.remove(newRanges, *newRanges.begin()), Range(newFrom, newTo));
+      *MinRange = Range(MinRange->From(), newTo);
     } else if (!to.isMinSignedValue()) {
       const llvm::APSInt &newFrom = BV.getValue(- to);
-      newRanges = F.add(newRanges, Range(newFrom, newTo));
+      newRanges.push_back(Range(newFrom, newTo));
     }
     if (from.isMinSignedValue()) {
-      newRanges = F.add(newRanges, Range(BV.getMinValue(from),
-                                         BV.getMinValue(from)));
+      newRanges.push_back(Range(BV.getMinValue(from),
+                                BV.getMinValue(from)));
     }
   }
 
-  return newRanges;
+  return F.getRangeSet(newRanges);
 }
 
 void RangeSet::print(raw_ostream &os) const {
@@ -11,12 +11,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/StaticAnalyzer/Core/PathSensitive/WorkList.h"
-#include "llvm/ADT/PriorityQueue.h"
+#include "clang/Analysis/AnalysisDeclContext.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
+#include <algorithm>
 #include <deque>
+#include <tuple>
 #include <vector>
 
 using namespace clang;
@@ -26,6 +28,16 @@ using namespace ento;
 
 STATISTIC(MaxQueueSize, "Maximum size of the worklist");
 STATISTIC(MaxReachableSize, "Maximum size of auxiliary worklist set");
+STATISTIC(NumFrameBlocks,
+          "The # of basic blocks in the functions explored by the "
+          "coverage-guided worklist");
+STATISTIC(NumCoveredFrameBlocks,
+          "The # of basic blocks covered by the coverage-guided worklist");
+STATISTIC(PercentCoveredFrameBlocks,
+          "The % of basic blocks covered by the coverage-guided worklist");
+STATISTIC(NumPostponedBlockEntrances,
+          "The # of block entrances postponed by the coverage-guided worklist "
+          "because their path entered the block before");
 
 //===----------------------------------------------------------------------===//
 // Worklist classes for exploration of reachable states.
@@ -51,6 +63,11 @@ public:
     Stack.pop_back(); // This technically "invalidates" U, but we are fine.
     return U;
   }
+
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    llvm::for_each(Stack, Fn);
+  }
 };
 
 class BFS : public WorkList {
@@ -70,6 +87,11 @@ public:
     Queue.pop_front();
     return U;
   }
+
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    llvm::for_each(Queue, Fn);
+  }
 };
 
 } // namespace
@@ -119,6 +141,12 @@ namespace {
       Queue.pop_front();
       return U;
     }
+
+    void visitUnits(
+        llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+      llvm::for_each(Queue, Fn);
+      llvm::for_each(Stack, Fn);
+    }
   };
 
 } // namespace
@@ -181,6 +209,12 @@ public:
       return U;
     }
   }
+
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    llvm::for_each(StackUnexplored, Fn);
+    llvm::for_each(StackOthers, Fn);
+  }
 };
 
 } // namespace
@@ -218,9 +252,9 @@ class UnexploredFirstPriorityQueue : public WorkList {
   // Number of times a current location was reached.
   VisitedTimesMap NumReached;
 
-  // The top item is the largest one.
-  llvm::PriorityQueue<QueueItem, std::vector<QueueItem>, ExplorationComparator>
-      queue;
+  // A max-heap ordered by ExplorationComparator; the top item is the largest
+  // one. It is kept as a plain vector so that pending units can be visited.
+  std::vector<QueueItem> queue;
 
 public:
   bool hasWork() const override {
@@ -237,14 +271,22 @@ public:
       NumVisited = NumReached[LocId]++;
     }
 
-    queue.push(std::make_pair(U, std::make_pair(-NumVisited, ++Counter)));
+    queue.push_back(std::make_pair(U, std::make_pair(-NumVisited, ++Counter)));
+    std::push_heap(queue.begin(), queue.end(), ExplorationComparator());
   }
 
   WorkListUnit dequeue() override {
-    QueueItem U = queue.top();
-    queue.pop();
+    std::pop_heap(queue.begin(), queue.end(), ExplorationComparator());
+    QueueItem U = queue.back();
+    queue.pop_back();
     return U.first;
   }
+
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    for (const QueueItem &I : queue)
+      Fn(I.first);
+  }
 };
 } // namespace
 
@@ -280,9 +322,9 @@ class UnexploredFirstPriorityLocationQueue : public WorkList {
   // Number of times a current location was reached.
   VisitedTimesMap NumReached;
 
-  // The top item is the largest one.
-  llvm::PriorityQueue<QueueItem, std::vector<QueueItem>, ExplorationComparator>
-      queue;
+  // A max-heap ordered by ExplorationComparator; the top item is the largest
+  // one. It is kept as a plain vector so that pending units can be visited.
+  std::vector<QueueItem> queue;
 
 public:
   bool hasWork() const override {
@@ -295,15 +337,23 @@ public:
     if (auto BE = N->getLocation().getAs<BlockEntrance>())
       NumVisited = NumReached[BE->getBlock()]++;
 
-    queue.push(std::make_pair(U, std::make_pair(-NumVisited, ++Counter)));
+    queue.push_back(std::make_pair(U, std::make_pair(-NumVisited, ++Counter)));
+    std::push_heap(queue.begin(), queue.end(), ExplorationComparator());
   }
 
   WorkListUnit dequeue() override {
-    QueueItem U = queue.top();
-    queue.pop();
+    std::pop_heap(queue.begin(), queue.end(), ExplorationComparator());
+    QueueItem U = queue.back();
+    queue.pop_back();
     return U.first;
   }
 
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    for (const QueueItem &I : queue)
+      Fn(I.first);
+  }
+
 };
 
 }
@@ -311,3 +361,104 @@ public:
 std::unique_ptr<WorkList> WorkList::makeUnexploredFirstPriorityLocationQueue() {
   return std::make_unique<UnexploredFirstPriorityLocationQueue>();
 }
+
+namespace {
+/// A priority queue which steers the exploration towards the basic blocks
+/// that were not covered yet.
+///
+/// A block entrance which covers a new block is expanded first. Coverage is
+/// tracked per CFG block rather than per stack frame, so that a function
+/// inlined at several call sites is only covered once. The other nodes are
+/// expanded in DFS order, except that a path entering a block it already
+/// entered, according to its own block counter, is postponed behind the paths
+/// which entered their block fewer times.
+class CoverageGuidedQueue : public WorkList {
+  enum Tier : unsigned { Regular, Uncovered };
+
+  // Compare by tier first, then by the number of times the path entered the
+  // block before (negated to prefer less often entered blocks), then by
+  // insertion time (prefer expanding nodes inserted later first).
+  using QueuePriority = std::tuple<unsigned, int, unsigned long>;
+  using QueueItem = std::pair<WorkListUnit, QueuePriority>;
+
+  struct ExplorationComparator {
+    bool operator() (const QueueItem &LHS, const QueueItem &RHS) {
+      return LHS.second < RHS.second;
+    }
+  };
+
+  unsigned long Counter = 0;
+
+  // The blocks reached so far.
+  llvm::DenseSet<const CFGBlock *> Covered;
+
+  // The CFGs seen so far.
+  llvm::DenseSet<const CFG *> CFGs;
+
+  unsigned NumBlocks = 0;
+
+  // A max-heap ordered by ExplorationComparator.
+  std::vector<QueueItem> queue;
+
+  void addCFG(const CFG *C) {
+    if (!C || !CFGs.insert(C).second)
+      return;
+    // The exit block has no block entrance, and the entry block is covered as
+    // soon as the function is entered.
+    NumBlocks += C->getNumBlockIDs() - 1;
+    Covered.insert(&C->getEntry());
+  }
+
+public:
+  ~CoverageGuidedQueue() override {
+    NumFrameBlocks += NumBlocks;
+    NumCoveredFrameBlocks += Covered.size();
+    if (NumFrameBlocks > 0)
+      PercentCoveredFrameBlocks =
+          (NumCoveredFrameBlocks * 100) / NumFrameBlocks;
+  }
+
+  bool hasWork() const override {
+    return !queue.empty();
+  }
+
+  void enqueue(const WorkListUnit &U) override {
+    const ExplodedNode *N = U.getNode();
+    const StackFrameContext *SFC = N->getLocationContext()->getStackFrame();
+    addCFG(SFC->getCFG());
+
+    QueuePriority Priority(Regular, 0, ++Counter);
+    if (auto BE = N->getLocation().getAs<BlockEntrance>()) {
+      const CFGBlock *Block = BE->getBlock();
+      if (Covered.insert(Block).second) {
+        std::get<0>(Priority) = Uncovered;
+      } else if (unsigned NumVisited = U.getBlockCounter().getNumVisited(
+                     SFC, Block->getBlockID())) {
+        ++NumPostponedBlockEntrances;
+        std::get<1>(Priority) = -int(NumVisited);
+      }
+    }
+
+    queue.push_back(std::make_pair(U, Priority));
+    std::push_heap(queue.begin(), queue.end(), ExplorationComparator());
+    MaxQueueSize.updateMax(queue.size());
+  }
+
+  WorkListUnit dequeue() override {
+    std::pop_heap(queue.begin(), queue.end(), ExplorationComparator());
+    QueueItem U = queue.back();
+    queue.pop_back();
+    return U.first;
+  }
+
+  void visitUnits(
+      llvm::function_ref<void(const WorkListUnit &)> Fn) const override {
+    for (const QueueItem &I : queue)
+      Fn(I.first);
+  }
+};
+} // namespace
+
+std::unique_ptr<WorkList> WorkList::makeCoverageGuidedQueue() {
+  return std::make_unique<CoverageGuidedQueue>();
+}
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/StaticAnalyzer/Frontend/AnalysisConsumer.h"
+#include "IncrementalAnalysisCache.h"
 #include "ModelInjector.h"
 #include "clang/Analysis/PathDiagnostic.h"
 #include "clang/AST/Decl.h"
@@ -21,6 +22,7 @@
 #include "clang/Analysis/CFG.h"
 #include "clang/Analysis/CallGraph.h"
 #include "clang/Analysis/CodeInjector.h"
+#include "clang/Basic/DiagnosticFrontend.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/CrossTU/CrossTranslationUnit.h"
 #include "clang/Frontend/CompilerInstance.h"
@@ -33,11 +35,18 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/AnalysisManager.h"
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
 #include "clang/StaticAnalyzer/Frontend/CheckerRegistration.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
@@ -59,6 +68,8 @@ STATISTIC(NumVisitedBlocksInAnalyzedFunctions,
           "The # of visited basic blocks in the analyzed functions.");
 STATISTIC(PercentReachableBlocks, "The % of reachable basic blocks.");
 STATISTIC(MaxCFGSize, "The maximum number of basic blocks in a function.");
+STATISTIC(NumFunctionsReused,
+          "The # of functions whose reports were reused from a previous run.");
 
 //===----------------------------------------------------------------------===//
 // Special PathDiagnosticConsumers.
@@ -225,6 +236,27 @@ public:
   /// translation unit.
   FunctionSummariesTy FunctionSummaries;
 
+  /// The reports of the functions analyzed in a previous run, if incremental
+  /// analysis is enabled. Owned by AnalysisManager.
+  IncrementalAnalysisCache *IncrementalCache = nullptr;
+
+  /// The measurements of the analysis of a top-level function, collected if
+  /// analysis-profile-file is set.
+  struct FunctionProfile {
+    std::string Name;
+    AnalysisMode Mode;
+    double WallTime = 0;
+    unsigned MaxGraphSize = 0;
+    /// The memory allocated for the exploded graph of the function. Nodes
+    /// removed by graph compaction are reused, not freed, so this is the peak
+    /// for the function, but it does not shrink after a compaction.
+    size_t GraphAllocatedBytes = 0;
+
+    FunctionProfile(std::string Name, AnalysisMode Mode)
+        : Name(std::move(Name)), Mode(Mode) {}
+  };
+  std::vector<FunctionProfile> FunctionProfiles;
+
   AnalysisConsumer(CompilerInstance &CI, const std::string &outdir,
                    AnalyzerOptionsRef opts, ArrayRef<std::string> plugins,
                    CodeInjector *injector)
@@ -280,6 +312,21 @@ public:
       }
     }
 
+    // Recorded reports have no path, so they can only be reused when no
+    // consumer shows one.
+    if (!Opts->IncrementalAnalysisDir.empty()) {
+      if (llvm::all_of(PathConsumers, [](const PathDiagnosticConsumer *C) {
+            return C->getGenerationScheme() == PathDiagnosticConsumer::None;
+          })) {
+        IncrementalCache =
+            new IncrementalAnalysisCache(Opts->IncrementalAnalysisDir);
+        PathConsumers.push_back(IncrementalCache);
+      } else {
+        PP.getDiagnostics().Report(
+            diag::warn_analyzer_incremental_analysis_with_paths);
+      }
+    }
+
     // Create the analyzer component creators.
     switch (Opts->AnalysisStoreOpt) {
     default:
@@ -369,7 +416,12 @@ public:
 
   void RunPathSensitiveChecks(Decl *D,
                               ExprEngine::InliningModes IMode,
-                              SetOfConstDecls *VisitedCallees);
+                              SetOfConstDecls *VisitedCallees,
+                              FunctionProfile *Profile);
+
+  /// Write the measurements of the analyzed functions and of the checker
+  /// callbacks to analysis-profile-file.
+  void writeAnalysisProfile();
 
   /// Visitors for the RecursiveASTVisitor.
   bool shouldWalkTypesOfTypeLocs() const { return false; }
@@ -465,6 +517,18 @@ private:
 
   /// Check if we should skip (not analyze) the given function.
   AnalysisMode getModeForDecl(Decl *D, AnalysisMode Mode);
+
+  /// Check if the given declaration belongs to the shard of functions
+  /// selected by the 'function-shard-count' and 'function-shard-index'
+  /// options.
+  bool isInFunctionShard(const Decl *D);
+
+  /// Collect the functions of the call graph whose path-sensitive analysis
+  /// belongs to another shard.
+  void findFunctionsOfOtherShards(CallGraph &CG, SetOfConstDecls &Functions);
+
+  /// Check if the checks on the whole translation unit should run.
+  bool isFirstFunctionShard() const;
   void runAnalysisOnTranslationUnit(ASTContext &C);
 
   /// Print \p S to stderr if \c Opts->AnalyzerDisplayProgress is set.
@@ -549,6 +613,12 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     CG.addToCallGraph(LocalTUDecls[i]);
   }
 
+  // Let the functions reused from a previous run find the functions that
+  // were inlined into them.
+  if (IncrementalCache)
+    for (const auto &I : CG)
+      IncrementalCache->addFunction(I.first);
+
   // Walk over all of the call graph nodes in topological order, so that we
   // analyze parents before the children. Skip the functions inlined into
   // the previously processed functions. Use external Visited set to identify
@@ -557,6 +627,8 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
   // often.
   SetOfConstDecls Visited;
   SetOfConstDecls VisitedAsTopLevel;
+  SetOfConstDecls OtherShards;
+  findFunctionsOfOtherShards(CG, OtherShards);
   llvm::ReversePostOrderTraversal<clang::CallGraph*> RPOT(&CG);
   for (llvm::ReversePostOrderTraversal<clang::CallGraph*>::rpo_iterator
          I = RPOT.begin(), E = RPOT.end(); I != E; ++I) {
@@ -569,6 +641,9 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     if (!D)
       continue;
 
+    if (OtherShards.count(D))
+      continue;
+
     // Skip the functions which have been processed already or previously
     // inlined.
     if (shouldSkipFunction(D, Visited, VisitedAsTopLevel))
@@ -577,15 +652,21 @@ void AnalysisConsumer::HandleDeclsCallGraph(const unsigned LocalTUDeclsSize) {
     // Analyze the function.
     SetOfConstDecls VisitedCallees;
 
+    // Incremental analysis needs to know the inlined functions even when
+    // they are analyzed as top level again.
+    bool SkipVisitedCallees = Mgr->options.InliningMode == All;
     HandleCode(D, AM_Path, getInliningModeForFunction(D, Visited),
-               (Mgr->options.InliningMode == All ? nullptr : &VisitedCallees));
+               (SkipVisitedCallees && !IncrementalCache ? nullptr
+                                                        : &VisitedCallees));
 
     // Add the visited callees to the global visited set.
-    for (const Decl *Callee : VisitedCallees)
-      // Decls from CallGraph are already canonical. But Decls coming from
-      // CallExprs may be not. We should canonicalize them manually.
-      Visited.insert(isa<ObjCMethodDecl>(Callee) ? Callee
-                                                 : Callee->getCanonicalDecl());
+    if (!SkipVisitedCallees)
+      for (const Decl *Callee : VisitedCallees)
+        // Decls from CallGraph are already canonical. But Decls coming from
+        // CallExprs may be not. We should canonicalize them manually.
+        Visited.insert(isa<ObjCMethodDecl>(Callee)
+                           ? Callee
+                           : Callee->getCanonicalDecl());
     VisitedAsTopLevel.insert(D);
   }
 }
@@ -602,11 +683,13 @@ static bool isBisonFile(ASTContext &C) {
 void AnalysisConsumer::runAnalysisOnTranslationUnit(ASTContext &C) {
   BugReporter BR(*Mgr);
   TranslationUnitDecl *TU = C.getTranslationUnitDecl();
-  if (SyntaxCheckTimer)
-    SyntaxCheckTimer->startTimer();
-  checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
-  if (SyntaxCheckTimer)
-    SyntaxCheckTimer->stopTimer();
+  if (isFirstFunctionShard()) {
+    if (SyntaxCheckTimer)
+      SyntaxCheckTimer->startTimer();
+    checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
+    if (SyntaxCheckTimer)
+      SyntaxCheckTimer->stopTimer();
+  }
 
   // Run the AST-only checks using the order in which functions are defined.
   // If inlining is not turned on, use the simplest function order for path
@@ -631,7 +714,8 @@ void AnalysisConsumer::runAnalysisOnTranslationUnit(ASTContext &C) {
     HandleDeclsCallGraph(LocalTUDeclsSize);
 
   // After all decls handled, run checkers on the entire TranslationUnit.
-  checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
+  if (isFirstFunctionShard())
+    checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
 
   BR.FlushReports();
   RecVisitorBR = nullptr;
@@ -658,7 +742,31 @@ void AnalysisConsumer::HandleTranslationUnit(ASTContext &C) {
     reportAnalyzerProgress("All checks are disabled using a supplied option\n");
   } else {
     // Otherwise, just run the analysis.
+    const SourceManager &SM = C.getSourceManager();
+    const FileEntry *MainFile = SM.getFileEntryForID(SM.getMainFileID());
+    // Every shard of the translation unit keeps its own records.
+    std::string TUName;
+    if (MainFile) {
+      TUName = MainFile->getName();
+      if (Opts->FunctionShardCount > 1)
+        TUName += '#' + llvm::utostr(Opts->FunctionShardIndex);
+    }
+    std::string SummaryDir;
+    if (!Opts->SummaryCacheDir.empty() && MainFile) {
+      SummaryDir = FunctionSummariesTy::getPersistentSummaryDir(*Opts);
+      FunctionSummaries.loadPersistentSummaries(SummaryDir, TUName);
+    }
+    if (IncrementalCache && MainFile)
+      IncrementalCache->load(C, *Opts, TUName, LocalTUDecls);
+
     runAnalysisOnTranslationUnit(C);
+
+    if (!SummaryDir.empty())
+      FunctionSummaries.storePersistentSummaries(SummaryDir, TUName);
+    if (IncrementalCache)
+      IncrementalCache->store();
+    if (!Opts->AnalysisProfileFile.empty())
+      writeAnalysisProfile();
   }
 
   // Count how many basic blocks we have not covered.
@@ -736,6 +844,13 @@ AnalysisConsumer::getModeForDecl(Decl *D, AnalysisMode Mode) {
       getFunctionName(D) != Opts->AnalyzeSpecificFunction)
     return AM_None;
 
+  // With inlining, findFunctionsOfOtherShards() picks the functions to
+  // analyze path-sensitively, so that callees follow their callers.
+  if (!isInFunctionShard(D))
+    Mode &= Mgr->shouldInlineCall() ? AM_Path : AM_None;
+  if (Mode == AM_None)
+    return AM_None;
+
   // Unless -analyze-all is specified, treat decls differently depending on
   // where they came from:
   // - Main source file: run both path-sensitive and non-path-sensitive checks.
@@ -755,6 +870,76 @@ AnalysisConsumer::getModeForDecl(Decl *D, AnalysisMode Mode) {
   return Mode;
 }
 
+/// Check if the options split the functions of the translation unit into
+/// shards. Invalid values are only accepted in compatibility mode, in which
+/// case everything is analyzed.
+static bool hasFunctionShards(const AnalyzerOptions &Opts) {
+  return Opts.FunctionShardCount > 1 &&
+         Opts.FunctionShardIndex < Opts.FunctionShardCount;
+}
+
+bool AnalysisConsumer::isInFunctionShard(const Decl *D) {
+  if (!hasFunctionShards(*Opts))
+    return true;
+  // The shard only depends on the name of the function, so that every
+  // function is analyzed in exactly one shard.
+  return llvm::djbHash(getFunctionName(D)) % Opts->FunctionShardCount ==
+         Opts->FunctionShardIndex;
+}
+
+void AnalysisConsumer::findFunctionsOfOtherShards(CallGraph &CG,
+                                                  SetOfConstDecls &Functions) {
+  if (!hasFunctionShards(*Opts))
+    return;
+
+  // The functions nothing else calls belong to the shard picked by their
+  // names. Every other function belongs to the lowest shard of the roots it
+  // is reachable from, so that it is only analyzed as top level in a shard
+  // which had the chance to inline it, like in an unsharded run.
+  llvm::DenseSet<const CallGraphNode *> HasCaller;
+  for (const auto &I : CG)
+    for (const CallGraphNode *Callee : *I.second)
+      if (I.first && Callee != I.second.get())
+        HasCaller.insert(Callee);
+
+  std::vector<std::pair<unsigned, CallGraphNode *>> Roots;
+  for (const auto &I : CG)
+    if (I.first && !HasCaller.count(I.second.get()))
+      Roots.emplace_back(llvm::djbHash(getFunctionName(I.first)) %
+                             Opts->FunctionShardCount,
+                         I.second.get());
+  llvm::stable_sort(Roots, llvm::less_first());
+
+  // A node reached from a root is owned by the first root that reaches it,
+  // and so is everything reachable from it.
+  llvm::DenseMap<const CallGraphNode *, unsigned> Owner;
+  SmallVector<CallGraphNode *, 16> Worklist;
+  for (const auto &Root : Roots) {
+    if (!Owner.try_emplace(Root.second, Root.first).second)
+      continue;
+    Worklist.push_back(Root.second);
+    while (!Worklist.empty())
+      for (CallGraphNode *Callee : *Worklist.pop_back_val())
+        if (Owner.try_emplace(Callee, Root.first).second)
+          Worklist.push_back(Callee);
+  }
+
+  // The functions which are only reachable from cycles fall back to their
+  // names.
+  for (const auto &I : CG) {
+    if (!I.first)
+      continue;
+    auto OwnerI = Owner.find(I.second.get());
+    if (OwnerI == Owner.end() ? !isInFunctionShard(I.first)
+                              : OwnerI->second != Opts->FunctionShardIndex)
+      Functions.insert(I.first);
+  }
+}
+
+bool AnalysisConsumer::isFirstFunctionShard() const {
+  return !hasFunctionShards(*Opts) || Opts->FunctionShardIndex == 0;
+}
+
 void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
                                   ExprEngine::InliningModes IMode,
                                   SetOfConstDecls *VisitedCallees) {
@@ -770,11 +955,32 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
   if (Mgr->getAnalysisDeclContext(D)->isBodyAutosynthesized())
     return;
 
+  if (IncrementalCache &&
+      IncrementalCache->reuseReports(D, Mode, IMode,
+                                     Mgr->getPathDiagnosticConsumers(),
+                                     VisitedCallees)) {
+    NumFunctionsReused++;
+    return;
+  }
+
   DisplayFunction(D, Mode, IMode);
+  llvm::TimeTraceScope TimeScope("HandleCode",
+                                 [&]() { return getFunctionName(D); });
   CFG *DeclCFG = Mgr->getCFG(D);
   if (DeclCFG)
     MaxCFGSize.updateMax(DeclCFG->size());
 
+  if (IncrementalCache)
+    IncrementalCache->beginFunction(D, Mode, IMode);
+
+  FunctionProfile *Profile = nullptr;
+  double StartTime = 0;
+  if (!Opts->AnalysisProfileFile.empty()) {
+    FunctionProfiles.emplace_back(getFunctionName(D), Mode);
+    Profile = &FunctionProfiles.back();
+    StartTime = llvm::TimeRecord::getCurrentTime().getWallTime();
+  }
+
   BugReporter BR(*Mgr);
 
   if (Mode & AM_Syntax) {
@@ -788,10 +994,17 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
   BR.FlushReports();
 
   if ((Mode & AM_Path) && checkerMgr->hasPathSensitiveCheckers()) {
-    RunPathSensitiveChecks(D, IMode, VisitedCallees);
+    RunPathSensitiveChecks(D, IMode, VisitedCallees, Profile);
     if (IMode != ExprEngine::Inline_Minimal)
       NumFunctionsAnalyzed++;
   }
+
+  if (Profile)
+    Profile->WallTime =
+        llvm::TimeRecord::getCurrentTime(false).getWallTime() - StartTime;
+
+  if (IncrementalCache)
+    IncrementalCache->endFunction(VisitedCallees);
 }
 
 //===----------------------------------------------------------------------===//
@@ -800,7 +1013,8 @@ void AnalysisConsumer::HandleCode(Decl *D, AnalysisMode Mode,
 
 void AnalysisConsumer::RunPathSensitiveChecks(Decl *D,
                                               ExprEngine::InliningModes IMode,
-                                              SetOfConstDecls *VisitedCallees) {
+                                              SetOfConstDecls *VisitedCallees,
+                                              FunctionProfile *Profile) {
   // Construct the analysis engine.  First check if the CFG is valid.
   // FIXME: Inter-procedural analysis will need to handle invalid CFGs.
   if (!Mgr->getCFG(D))
@@ -820,6 +1034,20 @@ void AnalysisConsumer::RunPathSensitiveChecks(Decl *D,
   if (ExprEngineTimer)
     ExprEngineTimer->stopTimer();
 
+  // A function whose every path was explored and returned a non-null pointer
+  // is summarized as never returning null.
+  const FunctionDecl *Definition;
+  if (!Eng.hasWorkRemaining() && Eng.returnedOnlyNonNull())
+    if (const auto *FD = dyn_cast<FunctionDecl>(D))
+      if (FD->hasBody(Definition))
+        FunctionSummaries.markReturnsNonNull(Definition);
+
+  if (Profile) {
+    Profile->MaxGraphSize = Eng.getCoreEngine().getMaxGraphSize();
+    Profile->GraphAllocatedBytes =
+        Eng.getGraph().getAllocator().getTotalMemory();
+  }
+
   if (!Mgr->options.DumpExplodedGraphTo.empty())
     Eng.DumpGraph(Mgr->options.TrimGraph, Mgr->options.DumpExplodedGraphTo);
 
@@ -835,6 +1063,47 @@ void AnalysisConsumer::RunPathSensitiveChecks(Decl *D,
     BugReporterTimer->stopTimer();
 }
 
+void AnalysisConsumer::writeAnalysisProfile() {
+  auto toMicroseconds = [](double Seconds) -> int64_t {
+    return Seconds * 1e6;
+  };
+
+  llvm::json::Array Functions;
+  for (const FunctionProfile &P : FunctionProfiles) {
+    llvm::json::Object F{{"name", P.Name},
+                         {"wall-time-us", toMicroseconds(P.WallTime)}};
+    if (P.Mode & AM_Path) {
+      F["max-nodes"] = P.MaxGraphSize;
+      F["graph-allocated-bytes"] = int64_t(P.GraphAllocatedBytes);
+    }
+    Functions.push_back(std::move(F));
+  }
+
+  llvm::json::Array Callbacks;
+  for (const auto &P : checkerMgr->getCallbackProfiles()) {
+    if (!P->NumCalls)
+      continue;
+    Callbacks.push_back(llvm::json::Object{
+        {"checker", P->CheckerName},
+        {"callback", P->Callback},
+        {"calls", int64_t(P->NumCalls)},
+        {"wall-time-us", int64_t(P->Nanoseconds / 1000)}});
+  }
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Opts->AnalysisProfileFile, EC,
+                          llvm::sys::fs::OF_Text);
+  if (EC) {
+    PP.getDiagnostics().Report(diag::warn_analyzer_unable_to_open_profile_file)
+        << Opts->AnalysisProfileFile << EC.message();
+    return;
+  }
+  llvm::json::Value Profile =
+      llvm::json::Object{{"functions", std::move(Functions)},
+                         {"checker-callbacks", std::move(Callbacks)}};
+  OS << llvm::formatv("{0:2}", Profile) << '\n';
+}
+
 //===----------------------------------------------------------------------===//
 // AnalysisConsumer creation.
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,601 @@
+//===-- IncrementalAnalysisCache.cpp ----------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implements the records of the analyzed functions used by incremental
+// analysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncrementalAnalysisCache.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/DeclTemplate.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
+#include "clang/CrossTU/CrossTranslationUnit.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <tuple>
+
+using namespace clang;
+using namespace ento;
+
+static uint64_t combineHashes(uint64_t A, uint64_t B) {
+  uint64_t Data[] = {A, B};
+  return llvm::xxHash64(
+      StringRef(reinterpret_cast<const char *>(Data), sizeof(Data)));
+}
+
+/// Returns the definition of \p D if it is a function which can be recorded.
+static const FunctionDecl *getRecordableDefinition(const Decl *D) {
+  const auto *FD = dyn_cast_or_null<FunctionDecl>(D);
+  const FunctionDecl *Definition;
+  if (!FD || !FD->hasBody(Definition))
+    return nullptr;
+  return Definition;
+}
+
+static Optional<std::string> getUSR(const FunctionDecl *FD) {
+  return cross_tu::CrossTranslationUnitContext::getLookupName(FD);
+}
+
+/// Returns the fingerprint of the function definition \p FD. The ODR hash
+/// covers the semantics of the definition, and the source text covers its
+/// layout, on which the offsets of the recorded report locations depend.
+static uint64_t getFingerprint(const FunctionDecl *FD, const ASTContext &Ctx) {
+  const SourceManager &SM = Ctx.getSourceManager();
+  CharSourceRange Range = SM.getExpansionRange(FD->getSourceRange());
+  StringRef Text = Lexer::getSourceText(Range, SM, Ctx.getLangOpts());
+  return combineHashes(const_cast<FunctionDecl *>(FD)->getODRHash(),
+                       llvm::xxHash64(Text));
+}
+
+/// Returns the fingerprint of the analyzer configuration, that is of
+/// everything other than the source code that the reports depend on.
+static uint64_t getConfigFingerprint(const AnalyzerOptions &Opts) {
+  std::string Buffer;
+  llvm::raw_string_ostream OS(Buffer);
+  OS << getClangFullVersion() << '\n';
+
+  std::vector<std::pair<StringRef, StringRef>> Config;
+  for (const auto &Entry : Opts.Config)
+    Config.emplace_back(Entry.getKey(), Entry.getValue());
+  llvm::sort(Config);
+  for (const auto &Entry : Config)
+    OS << Entry.first << '=' << Entry.second << '\n';
+
+  for (const auto &CheckerOrPackage : Opts.CheckersAndPackages)
+    OS << CheckerOrPackage.first << ':' << CheckerOrPackage.second << '\n';
+  for (const std::string &CheckerOrPackage : Opts.SilencedCheckersAndPackages)
+    OS << CheckerOrPackage << '\n';
+
+  OS << Opts.AnalysisStoreOpt << ' ' << Opts.AnalysisConstraintsOpt << ' '
+     << Opts.AnalysisPurgeOpt << ' ' << Opts.maxBlockVisitOnPath << ' '
+     << Opts.AnalyzeAll << Opts.AnalyzeNestedBlocks
+     << Opts.eagerlyAssumeBinOpBifurcation << Opts.UnoptimizedCFG
+     << Opts.NoRetryExhausted << ' ' << Opts.InlineMaxStackDepth << ' '
+     << Opts.InliningMode << '\n';
+  return llvm::xxHash64(OS.str());
+}
+
+/// Collects the source ranges of the function definitions among the top-level
+/// declaration \p D and its children, which are fingerprinted individually.
+static void collectDefinitionRanges(
+    const Decl *D, const ASTContext &Ctx,
+    llvm::DenseMap<const SrcMgr::ContentCache *,
+                   std::vector<std::pair<unsigned, unsigned>>> &Ranges) {
+  if (isa<NamespaceDecl>(D) || isa<LinkageSpecDecl>(D) ||
+      isa<ExportDecl>(D)) {
+    for (const Decl *Child : cast<DeclContext>(D)->decls())
+      collectDefinitionRanges(Child, Ctx, Ranges);
+    return;
+  }
+
+  const auto *FD = dyn_cast<FunctionDecl>(D);
+  if (const auto *FTD = dyn_cast<FunctionTemplateDecl>(D))
+    FD = FTD->getTemplatedDecl();
+  if (!FD || !FD->doesThisDeclarationHaveABody())
+    return;
+
+  // This is the text which getFingerprint() hashes.
+  const SourceManager &SM = Ctx.getSourceManager();
+  CharSourceRange Range = SM.getExpansionRange(FD->getSourceRange());
+  StringRef Text = Lexer::getSourceText(Range, SM, Ctx.getLangOpts());
+  if (Text.empty())
+    return;
+  std::pair<FileID, unsigned> Begin = SM.getDecomposedLoc(Range.getBegin());
+  const SrcMgr::SLocEntry &Entry = SM.getSLocEntry(Begin.first);
+  if (!Entry.isFile())
+    return;
+  Ranges[Entry.getFile().getContentCache()].emplace_back(
+      Begin.second, Begin.second + Text.size());
+}
+
+/// Returns the fingerprint of the source text of the translation unit, other
+/// than the text of the function definitions among \p TopLevelDecls. Hashing
+/// the text rather than the declarations is cheap, and also covers the macro
+/// definitions and the command-line macros that any function may depend on.
+static uint64_t getSourceFingerprint(const ASTContext &Ctx,
+                                     const SetOfDecls &TopLevelDecls) {
+  llvm::DenseMap<const SrcMgr::ContentCache *,
+                 std::vector<std::pair<unsigned, unsigned>>>
+      Ranges;
+  for (const Decl *D : TopLevelDecls)
+    collectDefinitionRanges(D, Ctx, Ranges);
+
+  // The entries of the source manager are in the order in which the files
+  // were entered, which is the same in every run.
+  const SourceManager &SM = Ctx.getSourceManager();
+  llvm::SmallPtrSet<const SrcMgr::ContentCache *, 32> Seen;
+  uint64_t Hash = 0;
+  for (unsigned I = 0, E = SM.local_sloc_entry_size(); I != E; ++I) {
+    const SrcMgr::SLocEntry &Entry = SM.getLocalSLocEntry(I);
+    if (!Entry.isFile())
+      continue;
+    const SrcMgr::ContentCache *Content = Entry.getFile().getContentCache();
+    const llvm::MemoryBuffer *Buffer = Content->getRawBuffer();
+    if (!Buffer || !Seen.insert(Content).second)
+      continue;
+
+    StringRef Text = Buffer->getBuffer();
+    Hash = combineHashes(Hash, llvm::xxHash64(Buffer->getBufferIdentifier()));
+    unsigned Pos = 0;
+    auto RangesI = Ranges.find(Content);
+    if (RangesI != Ranges.end()) {
+      std::vector<std::pair<unsigned, unsigned>> &FileRanges = RangesI->second;
+      llvm::sort(FileRanges);
+      for (const auto &Range : FileRanges) {
+        if (Range.first < Pos || Range.second > Text.size())
+          continue;
+        Hash = combineHashes(
+            Hash, llvm::xxHash64(Text.slice(Pos, Range.first)));
+        Pos = Range.second;
+      }
+    }
+    Hash = combineHashes(Hash, llvm::xxHash64(Text.substr(Pos)));
+  }
+  return Hash;
+}
+
+static std::string toHex(uint64_t Value) { return llvm::utohexstr(Value); }
+
+static bool fromHex(Optional<StringRef> Str, uint64_t &Value) {
+  return Str && !Str->getAsInteger(16, Value);
+}
+
+void IncrementalAnalysisCache::load(ASTContext &C, const AnalyzerOptions &Opts,
+                                    StringRef TUName,
+                                    const SetOfDecls &TopLevelDecls) {
+  Ctx = &C;
+  FileName = toHex(llvm::xxHash64(TUName)) + ".json";
+
+  ContextFingerprint = combineHashes(getConfigFingerprint(Opts),
+                                     getSourceFingerprint(C, TopLevelDecls));
+
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, FileName);
+  auto File = llvm::MemoryBuffer::getFile(Path);
+  if (!File)
+    return;
+  llvm::Expected<llvm::json::Value> Root =
+      llvm::json::parse((*File)->getBuffer());
+  if (!Root) {
+    llvm::consumeError(Root.takeError());
+    return;
+  }
+
+  // A record which cannot be read is dropped, so its function is analyzed.
+  const llvm::json::Object *TU = Root->getAsObject();
+  uint64_t Fingerprint;
+  if (!TU || !fromHex(TU->getString("context"), Fingerprint) ||
+      Fingerprint != ContextFingerprint)
+    return;
+  const llvm::json::Array *Functions = TU->getArray("functions");
+  if (!Functions)
+    return;
+
+  auto ReadLocation = [](const llvm::json::Object &O, StringRef FunctionKey,
+                         StringRef OffsetKey) -> Optional<RecordedLocation> {
+    Optional<int64_t> Function = O.getInteger(FunctionKey);
+    Optional<int64_t> Offset = O.getInteger(OffsetKey);
+    if (!Function || !Offset || *Function < 0 || *Offset < 0)
+      return None;
+    return RecordedLocation{unsigned(*Function), unsigned(*Offset)};
+  };
+
+  for (const llvm::json::Value &FunctionValue : *Functions) {
+    const llvm::json::Object *F = FunctionValue.getAsObject();
+    if (!F)
+      continue;
+    Optional<StringRef> USR = F->getString("usr");
+    Optional<int64_t> Mode = F->getInteger("mode");
+    const llvm::json::Array *Callees = F->getArray("callees");
+    const llvm::json::Array *Reports = F->getArray("reports");
+    RecordedFunction Record;
+    if (!USR || !Mode || !Callees || !Reports ||
+        !fromHex(F->getString("fingerprint"), Record.Fingerprint))
+      continue;
+
+    bool IsValid = true;
+    for (const llvm::json::Value &CalleeValue : *Callees) {
+      const llvm::json::Object *Callee = CalleeValue.getAsObject();
+      Optional<StringRef> CalleeUSR =
+          Callee ? Callee->getString("usr") : None;
+      uint64_t CalleeFingerprint;
+      if (!CalleeUSR ||
+          !fromHex(Callee->getString("fingerprint"), CalleeFingerprint)) {
+        IsValid = false;
+        break;
+      }
+      Record.Callees.emplace_back(*CalleeUSR, CalleeFingerprint);
+    }
+
+    for (const llvm::json::Value &ReportValue : *Reports) {
+      if (!IsValid)
+        break;
+      const llvm::json::Object *R = ReportValue.getAsObject();
+      if (!R) {
+        IsValid = false;
+        break;
+      }
+      Optional<StringRef> CheckerName = R->getString("checker");
+      Optional<StringRef> BugType = R->getString("type");
+      Optional<StringRef> Category = R->getString("category");
+      Optional<StringRef> VerboseDesc = R->getString("description");
+      Optional<StringRef> ShortDesc = R->getString("shortDescription");
+      Optional<RecordedLocation> Location =
+          ReadLocation(*R, "function", "offset");
+      if (!CheckerName || !BugType || !Category || !VerboseDesc ||
+          !ShortDesc || !Location || Location->Function > Callees->size()) {
+        IsValid = false;
+        break;
+      }
+      Optional<RecordedLocation> UniqueingLocation;
+      if (R->get("uniqueingFunction")) {
+        UniqueingLocation =
+            ReadLocation(*R, "uniqueingFunction", "uniqueingOffset");
+        if (!UniqueingLocation ||
+            UniqueingLocation->Function > Callees->size()) {
+          IsValid = false;
+          break;
+        }
+      }
+      std::vector<std::pair<unsigned, unsigned>> Ranges;
+      if (const llvm::json::Array *RangeValues = R->getArray("ranges")) {
+        for (const llvm::json::Value &RangeValue : *RangeValues) {
+          const llvm::json::Object *Range = RangeValue.getAsObject();
+          Optional<int64_t> Begin = Range ? Range->getInteger("begin") : None;
+          Optional<int64_t> End = Range ? Range->getInteger("end") : None;
+          if (!Begin || !End || *Begin < 0 || *End < *Begin) {
+            IsValid = false;
+            break;
+          }
+          Ranges.emplace_back(unsigned(*Begin), unsigned(*End));
+        }
+      }
+      if (!IsValid)
+        break;
+      Record.Reports.push_back({*CheckerName, *BugType, *Category,
+                                *VerboseDesc, *ShortDesc, *Location,
+                                UniqueingLocation, std::move(Ranges)});
+    }
+
+    if (IsValid)
+      PreviousRecords[{*USR, unsigned(*Mode)}] = std::move(Record);
+  }
+}
+
+void IncrementalAnalysisCache::store() {
+  if (!Ctx)
+    return;
+
+  llvm::json::Array Functions;
+  for (const auto &I : Records) {
+    const RecordedFunction &Record = I.second;
+    llvm::json::Array Callees;
+    for (const auto &Callee : Record.Callees)
+      Callees.push_back(llvm::json::Object{
+          {"usr", Callee.first}, {"fingerprint", toHex(Callee.second)}});
+
+    llvm::json::Array Reports;
+    for (const RecordedReport &Report : Record.Reports) {
+      llvm::json::Object R{{"checker", Report.CheckerName},
+                           {"type", Report.BugType},
+                           {"category", Report.Category},
+                           {"description", Report.VerboseDesc},
+                           {"shortDescription", Report.ShortDesc},
+                           {"function", Report.Location.Function},
+                           {"offset", Report.Location.Offset}};
+      if (Report.UniqueingLocation) {
+        R["uniqueingFunction"] = Report.UniqueingLocation->Function;
+        R["uniqueingOffset"] = Report.UniqueingLocation->Offset;
+      }
+      if (!Report.Ranges.empty()) {
+        llvm::json::Array Ranges;
+        for (const auto &Range : Report.Ranges)
+          Ranges.push_back(llvm::json::Object{{"begin", Range.first},
+                                              {"end", Range.second}});
+        R["ranges"] = std::move(Ranges);
+      }
+      Reports.push_back(std::move(R));
+    }
+
+    Functions.push_back(llvm::json::Object{
+        {"usr", I.first.first},
+        {"mode", I.first.second},
+        {"fingerprint", toHex(Record.Fingerprint)},
+        {"callees", std::move(Callees)},
+        {"reports", std::move(Reports)}});
+  }
+
+  // Write to a temporary file first, so that an interrupted run does not
+  // leave a truncated file behind.
+  SmallString<128> Path(Dir);
+  llvm::sys::path::append(Path, FileName);
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::create_directories(Dir) ||
+      llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%.tmp", FD, TempPath))
+    return;
+  llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << llvm::json::Value(llvm::json::Object{
+      {"context", toHex(ContextFingerprint)},
+      {"functions", std::move(Functions)}});
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    llvm::sys::fs::remove(TempPath);
+  } else if (llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+  }
+}
+
+void IncrementalAnalysisCache::addFunction(const Decl *D) {
+  if (PreviousRecords.empty())
+    return;
+  if (const FunctionDecl *Definition = getRecordableDefinition(D))
+    if (Optional<std::string> USR = getUSR(Definition))
+      Definitions[*USR] = Definition;
+}
+
+bool IncrementalAnalysisCache::reuseReports(
+    const Decl *D, unsigned Mode, unsigned IMode,
+    ArrayRef<PathDiagnosticConsumer *> Consumers,
+    SetOfConstDecls *VisitedCallees) {
+  const FunctionDecl *Definition = getRecordableDefinition(D);
+  if (!Definition || PreviousRecords.empty())
+    return false;
+  Optional<std::string> USR = getUSR(Definition);
+  if (!USR)
+    return false;
+  RecordKey Key(std::move(*USR), Mode);
+  auto I = PreviousRecords.find(Key);
+  if (I == PreviousRecords.end())
+    return false;
+  const RecordedFunction &Record = I->second;
+
+  uint64_t Fingerprint = combineHashes(getFingerprint(Definition, *Ctx), IMode);
+  if (Fingerprint != Record.Fingerprint)
+    return false;
+
+  SmallVector<const FunctionDecl *, 8> Functions;
+  Functions.push_back(Definition);
+  for (const auto &Callee : Record.Callees) {
+    const FunctionDecl *CalleeDefinition = Definitions.lookup(Callee.first);
+    if (!CalleeDefinition ||
+        getFingerprint(CalleeDefinition, *Ctx) != Callee.second)
+      return false;
+    Functions.push_back(CalleeDefinition);
+  }
+
+  const SourceManager &SM = Ctx->getSourceManager();
+  auto GetSourceLocation = [&](unsigned Function, unsigned Offset) {
+    std::pair<FileID, unsigned> Begin = SM.getDecomposedExpansionLoc(
+        Functions[Function]->getSourceRange().getBegin());
+    return SM.getComposedLoc(Begin.first, Begin.second + Offset);
+  };
+  auto GetLocation = [&](const RecordedLocation &Loc) {
+    return PathDiagnosticLocation(GetSourceLocation(Loc.Function, Loc.Offset),
+                                  SM);
+  };
+
+  for (const RecordedReport &Report : Record.Reports) {
+    PathDiagnosticLocation Location = GetLocation(Report.Location);
+    SmallVector<SourceRange, 4> Ranges;
+    for (const auto &Range : Report.Ranges)
+      Ranges.emplace_back(
+          GetSourceLocation(Report.Location.Function, Range.first),
+          GetSourceLocation(Report.Location.Function, Range.second));
+    PathDiagnosticLocation UniqueingLocation;
+    const Decl *UniqueingDecl = nullptr;
+    if (Report.UniqueingLocation) {
+      UniqueingLocation = GetLocation(*Report.UniqueingLocation);
+      UniqueingDecl = Functions[Report.UniqueingLocation->Function];
+    }
+
+    for (PathDiagnosticConsumer *Consumer : Consumers) {
+      if (Consumer == this)
+        continue;
+      auto PD = std::make_unique<PathDiagnostic>(
+          Report.CheckerName, Functions[Report.Location.Function],
+          Report.BugType, Report.VerboseDesc, Report.ShortDesc,
+          Report.Category, UniqueingLocation, UniqueingDecl,
+          std::make_unique<FilesToLineNumsMap>());
+      auto EndPiece = std::make_shared<PathDiagnosticEventPiece>(
+          Location, Report.VerboseDesc);
+      for (SourceRange Range : Ranges)
+        EndPiece->addRange(Range);
+      PD->setEndOfPath(std::move(EndPiece));
+      Consumer->HandlePathDiagnostic(std::move(PD));
+    }
+  }
+
+  if (VisitedCallees)
+    VisitedCallees->insert(Functions.begin() + 1, Functions.end());
+  Records[Key] = Record;
+  return true;
+}
+
+void IncrementalAnalysisCache::beginFunction(const Decl *D, unsigned Mode,
+                                             unsigned IMode) {
+  CurrentFunction = nullptr;
+  if (!Ctx)
+    return;
+  const FunctionDecl *Definition = getRecordableDefinition(D);
+  if (!Definition)
+    return;
+  Optional<std::string> USR = getUSR(Definition);
+  if (!USR)
+    return;
+  CurrentFunction = Definition;
+  CurrentKey = RecordKey(std::move(*USR), Mode);
+  CurrentFingerprint =
+      combineHashes(getFingerprint(Definition, *Ctx), IMode);
+}
+
+void IncrementalAnalysisCache::endFunction(
+    const SetOfConstDecls *VisitedCallees) {
+  if (CurrentFunction) {
+    RecordedFunction Record;
+    Record.Fingerprint = CurrentFingerprint;
+
+    // Sort the callees, so that the records do not depend on the order in
+    // which the functions were inlined.
+    std::vector<std::pair<std::string, const FunctionDecl *>> Callees;
+    bool IsRecordable = true;
+    if (VisitedCallees) {
+      for (const Decl *Callee : *VisitedCallees) {
+        const FunctionDecl *CalleeDefinition = getRecordableDefinition(Callee);
+        Optional<std::string> USR =
+            CalleeDefinition ? getUSR(CalleeDefinition) : None;
+        if (!USR) {
+          IsRecordable = false;
+          break;
+        }
+        Callees.emplace_back(std::move(*USR), CalleeDefinition);
+      }
+    }
+    llvm::sort(Callees);
+    Callees.erase(std::unique(Callees.begin(), Callees.end()), Callees.end());
+
+    SmallVector<const FunctionDecl *, 8> Functions;
+    Functions.push_back(CurrentFunction);
+    for (const auto &Callee : Callees) {
+      Record.Callees.emplace_back(Callee.first,
+                                  getFingerprint(Callee.second, *Ctx));
+      Functions.push_back(Callee.second);
+    }
+
+    if (IsRecordable && recordReports(Record, Functions))
+      Records[CurrentKey] = std::move(Record);
+    CurrentFunction = nullptr;
+  }
+
+  std::vector<PathDiagnostic *> Recorded;
+  for (PathDiagnostic &PD : Diags)
+    Recorded.push_back(&PD);
+  Diags.clear();
+  for (PathDiagnostic *PD : Recorded)
+    delete PD;
+}
+
+Optional<IncrementalAnalysisCache::RecordedLocation>
+IncrementalAnalysisCache::getRecordedLocation(
+    SourceLocation Loc, const Decl *D,
+    ArrayRef<const FunctionDecl *> Functions) const {
+  const FunctionDecl *Definition = getRecordableDefinition(D);
+  if (!Definition || !Loc.isValid())
+    return None;
+  auto I = llvm::find(Functions, Definition);
+  if (I == Functions.end())
+    return None;
+
+  // The location must lie within the definition, whose source text is part of
+  // its fingerprint.
+  const SourceManager &SM = Ctx->getSourceManager();
+  CharSourceRange Range = SM.getExpansionRange(Definition->getSourceRange());
+  std::pair<FileID, unsigned> Begin =
+      SM.getDecomposedLoc(Range.getBegin());
+  std::pair<FileID, unsigned> End = SM.getDecomposedLoc(Range.getEnd());
+  std::pair<FileID, unsigned> Pos =
+      SM.getDecomposedExpansionLoc(Loc);
+  if (Pos.first != Begin.first || End.first != Begin.first ||
+      Pos.second < Begin.second || Pos.second > End.second)
+    return None;
+  return RecordedLocation{unsigned(I - Functions.begin()),
+                          Pos.second - Begin.second};
+}
+
+bool IncrementalAnalysisCache::recordReports(
+    RecordedFunction &Record, ArrayRef<const FunctionDecl *> Functions) {
+  for (const PathDiagnostic &PD : Diags) {
+    // Extra notes and fix-its are shown even without a path, but are not
+    // recorded.
+    if (PD.path.empty() || !PD.path.back()->getFixits().empty() ||
+        llvm::any_of(PD.path, [](const PathDiagnosticPieceRef &Piece) {
+          return isa<PathDiagnosticNotePiece>(Piece.get());
+        }))
+      return false;
+
+    Optional<RecordedLocation> Location = getRecordedLocation(
+        PD.getLocation().asLocation(), PD.getDeclWithIssue(), Functions);
+    if (!Location)
+      return false;
+    Optional<RecordedLocation> UniqueingLocation;
+    if (PD.getUniqueingLoc().isValid()) {
+      UniqueingLocation = getRecordedLocation(
+          PD.getUniqueingLoc().asLocation(), PD.getUniqueingDecl(), Functions);
+      if (!UniqueingLocation)
+        return false;
+    }
+
+    std::vector<std::pair<unsigned, unsigned>> Ranges;
+    const Decl *LocationDecl = Functions[Location->Function];
+    for (SourceRange Range : PD.path.back()->getRanges()) {
+      // Ranges are recorded as file offsets, which macro locations do not
+      // map back to.
+      if (Range.getBegin().isMacroID() || Range.getEnd().isMacroID())
+        return false;
+      Optional<RecordedLocation> Begin =
+          getRecordedLocation(Range.getBegin(), LocationDecl, Functions);
+      Optional<RecordedLocation> End =
+          getRecordedLocation(Range.getEnd(), LocationDecl, Functions);
+      if (!Begin || !End)
+        return false;
+      Ranges.emplace_back(Begin->Offset, End->Offset);
+    }
+
+    Record.Reports.push_back(
+        {PD.getCheckerName(), PD.getBugType(), PD.getCategory(),
+         PD.getVerboseDescription(), PD.getShortDescription(), *Location,
+         UniqueingLocation, std::move(Ranges)});
+  }
+
+  // Sort the reports, so that the records are stored in the same order in
+  // every run.
+  llvm::sort(Record.Reports,
+             [](const RecordedReport &LHS, const RecordedReport &RHS) {
+               return std::tie(LHS.Location.Function, LHS.Location.Offset,
+                               LHS.CheckerName, LHS.VerboseDesc) <
+                      std::tie(RHS.Location.Function, RHS.Location.Offset,
+                               RHS.CheckerName, RHS.VerboseDesc);
+             });
+  return true;
+}
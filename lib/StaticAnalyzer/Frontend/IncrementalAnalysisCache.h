@@ -0,0 +1,157 @@
+//===-- IncrementalAnalysisCache.h ------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file defines the clang::ento::IncrementalAnalysisCache class, which
+/// records the reports emitted for every analyzed function of a translation
+/// unit, so that the next run of the analyzer on the same translation unit can
+/// skip the functions which did not change and emit their recorded reports
+/// instead.
+///
+/// A function is identified by its USR. Its fingerprint combines the ODR hash
+/// and the source text of its definition, and it is recorded along with the
+/// fingerprints of the functions that were inlined into it. The records of a
+/// translation unit are discarded as a whole when the analyzer configuration
+/// changes, or when any source text of the translation unit outside of the
+/// function definitions changes, including that of the included headers.
+///
+/// Only the location, the ranges and the message of a recorded report are
+/// kept, so the cache is only used when reports are emitted without paths.
+/// Functions whose reports have extra notes or fix-its are not recorded.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_SA_FRONTEND_INCREMENTALANALYSISCACHE_H
+#define LLVM_CLANG_SA_FRONTEND_INCREMENTALANALYSISCACHE_H
+
+#include "clang/Analysis/PathDiagnostic.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/FunctionSummary.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang {
+
+class ASTContext;
+class Decl;
+class FunctionDecl;
+
+namespace ento {
+
+class AnalyzerOptions;
+
+class IncrementalAnalysisCache : public PathDiagnosticConsumer {
+public:
+  IncrementalAnalysisCache(StringRef Dir) : Dir(Dir) {}
+
+  StringRef getName() const override { return "IncrementalAnalysisCache"; }
+  PathGenerationScheme getGenerationScheme() const override { return None; }
+  bool supportsCrossFileDiagnostics() const override { return true; }
+
+  void FlushDiagnosticsImpl(std::vector<const PathDiagnostic *> &Diags,
+                            FilesMade *filesMade) override {}
+
+  /// Load the records of the translation unit \p TUName, unless the analyzer
+  /// configuration \p Opts or the source text outside of the function
+  /// definitions among \p TopLevelDecls changed since they were stored.
+  void load(ASTContext &Ctx, const AnalyzerOptions &Opts, StringRef TUName,
+            const SetOfDecls &TopLevelDecls);
+
+  /// Store the records of the functions analyzed or reused in this run.
+  void store();
+
+  /// Make the definition \p D available to the functions that inlined it in
+  /// the previous run.
+  void addFunction(const Decl *D);
+
+  /// If the records of the previous run still hold for the analysis of \p D
+  /// with the analysis mode \p Mode and the inlining mode \p IMode, emit the
+  /// recorded reports to \p Consumers, add the functions that were inlined
+  /// into \p D to \p VisitedCallees and return true.
+  bool reuseReports(const Decl *D, unsigned Mode, unsigned IMode,
+                    ArrayRef<PathDiagnosticConsumer *> Consumers,
+                    SetOfConstDecls *VisitedCallees);
+
+  /// Start recording the reports of the analysis of \p D.
+  void beginFunction(const Decl *D, unsigned Mode, unsigned IMode);
+
+  /// Finish recording the reports of the function passed to beginFunction(),
+  /// which inlined the functions \p VisitedCallees.
+  void endFunction(const SetOfConstDecls *VisitedCallees);
+
+private:
+  /// The location of a report, as an offset from the beginning of the
+  /// definition of a recorded function.
+  struct RecordedLocation {
+    /// The function the location is in: 0 for the analyzed function itself,
+    /// or one plus the index of a function inlined into it.
+    unsigned Function;
+    unsigned Offset;
+  };
+
+  struct RecordedReport {
+    std::string CheckerName;
+    std::string BugType;
+    std::string Category;
+    std::string VerboseDesc;
+    std::string ShortDesc;
+    RecordedLocation Location;
+    Optional<RecordedLocation> UniqueingLocation;
+    /// The ranges highlighted at the location, in the same function.
+    std::vector<std::pair<unsigned, unsigned>> Ranges;
+  };
+
+  struct RecordedFunction {
+    uint64_t Fingerprint;
+    /// The USRs and fingerprints of the functions inlined into this one.
+    std::vector<std::pair<std::string, uint64_t>> Callees;
+    std::vector<RecordedReport> Reports;
+  };
+
+  /// Records are keyed by the USR of the function and the analysis mode.
+  using RecordKey = std::pair<std::string, unsigned>;
+
+  Optional<RecordedLocation>
+  getRecordedLocation(SourceLocation Loc, const Decl *D,
+                      ArrayRef<const FunctionDecl *> Functions) const;
+
+  bool recordReports(RecordedFunction &Record,
+                     ArrayRef<const FunctionDecl *> Functions);
+
+  std::string Dir;
+  std::string FileName;
+  ASTContext *Ctx = nullptr;
+
+  /// The fingerprint of the analyzer configuration and of the declarations
+  /// of the translation unit other than function definitions.
+  uint64_t ContextFingerprint = 0;
+
+  /// The records loaded from the previous run.
+  std::map<RecordKey, RecordedFunction> PreviousRecords;
+
+  /// The records of this run.
+  std::map<RecordKey, RecordedFunction> Records;
+
+  /// The definitions that may be inlined, by USR.
+  llvm::StringMap<const FunctionDecl *> Definitions;
+
+  /// The function whose reports are being recorded.
+  const FunctionDecl *CurrentFunction = nullptr;
+  RecordKey CurrentKey;
+  uint64_t CurrentFingerprint = 0;
+};
+
+} // namespace ento
+} // namespace clang
+
+#endif
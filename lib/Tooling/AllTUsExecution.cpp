@@ -7,10 +7,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/AllTUsExecution.h"
+#include "clang/Tooling/SharedPreambleCache.h"
 #include "clang/Tooling/ToolExecutorPluginRegistry.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include <chrono>
 
 namespace clang {
 namespace tooling {
@@ -34,7 +39,15 @@ class ThreadSafeToolResults : public ToolResults {
 public:
   void addResult(StringRef Key, StringRef Value) override {
     std::unique_lock<std::mutex> LockGuard(Mutex);
-    Results.addResult(Key, Value);
+    if (Consumer)
+      Consumer(Key, Value);
+    else
+      Results.addResult(Key, Value);
+  }
+
+  void setConsumer(AllTUsToolExecutor::ResultConsumer NewConsumer) {
+    std::unique_lock<std::mutex> LockGuard(Mutex);
+    Consumer = std::move(NewConsumer);
   }
 
   std::vector<std::pair<llvm::StringRef, llvm::StringRef>>
@@ -49,9 +62,46 @@ public:
 
 private:
   InMemoryToolResults Results;
+  AllTUsToolExecutor::ResultConsumer Consumer;
   std::mutex Mutex;
 };
 
+/// Reads the per-file processing times written by a previous run. Each line
+/// holds the number of seconds followed by a tab and the file path.
+llvm::StringMap<double> readTimings(StringRef Path) {
+  llvm::StringMap<double> Timings;
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return Timings;
+  SmallVector<StringRef, 0> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', /*MaxSplit=*/-1,
+                               /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    StringRef Seconds, File;
+    std::tie(Seconds, File) = Line.split('\t');
+    double Value;
+    if (!File.empty() && !Seconds.getAsDouble(Value))
+      Timings[File] = Value;
+  }
+  return Timings;
+}
+
+void writeTimings(StringRef Path, const llvm::StringMap<double> &Timings) {
+  std::vector<StringRef> Files;
+  for (const auto &Entry : Timings)
+    Files.push_back(Entry.getKey());
+  llvm::sort(Files);
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_Text);
+  if (EC) {
+    llvm::errs() << "Failed to write timings to " << Path << ": "
+                 << EC.message() << "\n";
+    return;
+  }
+  for (StringRef File : Files)
+    OS << llvm::format("%.3f", Timings.lookup(File)) << "\t" << File << "\n";
+}
+
 } // namespace
 
 llvm::cl::opt<std::string>
@@ -60,6 +110,21 @@ llvm::cl::opt<std::string>
                           "This flag only applies to all-TUs."),
            llvm::cl::init(".*"));
 
+llvm::cl::opt<std::string> ExecutorTimingsFile(
+    "execute-timings-file",
+    llvm::cl::desc("Read the per-file processing times of a previous run from "
+                   "this file to schedule the slowest files first, and update "
+                   "it at the end of the run. "
+                   "This flag only applies to all-TUs."),
+    llvm::cl::init(""));
+
+llvm::cl::opt<bool> ExecutorSharePreambles(
+    "execute-share-preambles",
+    llvm::cl::desc("Precompile the preambles shared by several files and "
+                   "reuse them instead of parsing the same headers for every "
+                   "file. This flag only applies to all-TUs."),
+    llvm::cl::init(false));
+
 AllTUsToolExecutor::AllTUsToolExecutor(
     const CompilationDatabase &Compilations, unsigned ThreadCount,
     std::shared_ptr<PCHContainerOperations> PCHContainerOps)
@@ -74,6 +139,11 @@ AllTUsToolExecutor::AllTUsToolExecutor(
       Results(new ThreadSafeToolResults), Context(Results.get()),
       ThreadCount(ThreadCount) {}
 
+void AllTUsToolExecutor::setResultConsumer(ResultConsumer Consumer) {
+  static_cast<ThreadSafeToolResults *>(Results.get())
+      ->setConsumer(std::move(Consumer));
+}
+
 llvm::Error AllTUsToolExecutor::execute(
     llvm::ArrayRef<
         std::pair<std::unique_ptr<FrontendActionFactory>, ArgumentsAdjuster>>
@@ -103,6 +173,46 @@ llvm::Error AllTUsToolExecutor::execute(
     if (RegexFilter.match(File))
       Files.push_back(File);
   }
+
+  // Schedule the most expensive files first: the thread pool hands out tasks
+  // in order, so the cheap files fill the gaps at the end of the run instead
+  // of a few large files determining its total duration. Files without a
+  // recorded timing are new or were not processed before, they are ordered
+  // by size and scheduled ahead of the files with a known cost.
+  llvm::StringMap<double> Timings;
+  if (!ExecutorTimingsFile.empty())
+    Timings = readTimings(ExecutorTimingsFile);
+  struct FileCost {
+    std::string File;
+    bool HasTiming;
+    double Cost;
+  };
+  std::vector<FileCost> Costs;
+  Costs.reserve(Files.size());
+  for (std::string &File : Files) {
+    auto Timing = Timings.find(File);
+    if (Timing != Timings.end()) {
+      Costs.push_back({std::move(File), true, Timing->second});
+      continue;
+    }
+    uint64_t Size = 0;
+    auto Overlay = OverlayFiles.find(File);
+    if (Overlay != OverlayFiles.end())
+      Size = Overlay->second.size();
+    else if (llvm::sys::fs::file_size(File, Size))
+      Size = 0;
+    Costs.push_back({std::move(File), false, static_cast<double>(Size)});
+  }
+  std::stable_sort(Costs.begin(), Costs.end(),
+                   [](const FileCost &LHS, const FileCost &RHS) {
+                     if (LHS.HasTiming != RHS.HasTiming)
+                       return RHS.HasTiming;
+                     return LHS.Cost > RHS.Cost;
+                   });
+  Files.clear();
+  for (FileCost &Cost : Costs)
+    Files.push_back(std::move(Cost.File));
+
   // Add a counter to track the progress.
   const std::string TotalNumStr = std::to_string(Files.size());
   unsigned Counter = 0;
@@ -113,6 +223,10 @@ llvm::Error AllTUsToolExecutor::execute(
 
   auto &Action = Actions.front();
 
+  std::unique_ptr<SharedPreambleCache> PreambleCache;
+  if (ExecutorSharePreambles)
+    PreambleCache = std::make_unique<SharedPreambleCache>();
+
   {
     llvm::ThreadPool Pool(ThreadCount == 0 ? llvm::hardware_concurrency()
                                            : ThreadCount);
@@ -121,6 +235,7 @@ llvm::Error AllTUsToolExecutor::execute(
           [&](std::string Path) {
             Log("[" + std::to_string(Count()) + "/" + TotalNumStr +
                 "] Processing file " + Path);
+            auto Start = std::chrono::steady_clock::now();
             // Each thread gets an indepent copy of a VFS to allow different
             // concurrent working directories.
             IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS =
@@ -129,12 +244,17 @@ llvm::Error AllTUsToolExecutor::execute(
                            std::make_shared<PCHContainerOperations>(), FS);
             Tool.appendArgumentsAdjuster(Action.second);
             Tool.appendArgumentsAdjuster(getDefaultArgumentsAdjusters());
+            Tool.setPreambleCache(PreambleCache.get());
             for (const auto &FileAndContent : OverlayFiles)
               Tool.mapVirtualFile(FileAndContent.first(),
                                   FileAndContent.second);
             if (Tool.run(Action.first.get()))
               AppendError(llvm::Twine("Failed to run action on ") + Path +
                           "\n");
+            std::chrono::duration<double> Elapsed =
+                std::chrono::steady_clock::now() - Start;
+            std::unique_lock<std::mutex> LockGuard(TUMutex);
+            Timings[Path] = Elapsed.count();
           },
           File);
     }
@@ -142,6 +262,9 @@ llvm::Error AllTUsToolExecutor::execute(
     Pool.wait();
   }
 
+  if (!ExecutorTimingsFile.empty())
+    writeTimings(ExecutorTimingsFile, Timings);
+
   if (!ErrorMsg.empty())
     return make_string_error(ErrorMsg);
 
@@ -7,7 +7,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/Version.h"
 #include "clang/Lex/DependencyDirectivesSourceMinimizer.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Threading.h"
 
@@ -15,8 +21,183 @@ using namespace clang;
 using namespace tooling;
 using namespace dependencies;
 
+namespace {
+
+/// Keeps the message of the first diagnostic reported by the minimizer.
+class MinimizationErrorCollector : public DiagnosticConsumer {
+public:
+  std::string Message;
+
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    if (!Message.empty())
+      return;
+    SmallString<64> Buf;
+    Info.FormatDiagnostic(Buf);
+    Message = Buf.str();
+  }
+};
+
+} // end anonymous namespace
+
+/// Identifies the format of the entries of the on-disk cache. Bump the number
+/// when the format changes.
+static const char MinimizedSourceEntryMagic[] = {'M', 'S', 'C', '1'};
+
+MinimizedSourceDiskCache::MinimizedSourceDiskCache(StringRef Path)
+    : Path(Path) {
+  // If the directory can't be created, every lookup misses and every store
+  // fails, which only makes the cache useless.
+  llvm::sys::fs::create_directories(Path);
+}
+
+void MinimizedSourceDiskCache::getEntryPath(
+    StringRef Contents, SmallVectorImpl<char> &EntryPath) const {
+  // The minimizer changes between compiler versions, so its version is part of
+  // the key.
+  llvm::MD5 Hash;
+  Hash.update(getClangFullRepositoryVersion());
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Name;
+  llvm::MD5::stringifyResult(Result, Name);
+  Name += ".min";
+
+  EntryPath.clear();
+  EntryPath.append(Path.begin(), Path.end());
+  llvm::sys::path::append(EntryPath, Name);
+}
+
+bool MinimizedSourceDiskCache::lookup(
+    StringRef Contents, SmallVectorImpl<char> &MinimizedContents,
+    PreprocessorSkippedRangeMapping &Mapping) {
+  SmallString<256> EntryPath;
+  getEntryPath(Contents, EntryPath);
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(EntryPath, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return false;
+
+  // The entry consists of the magic, the number of skipped ranges, the offset
+  // and length of every range, followed by the minimized contents.
+  StringRef Data = (*Buffer)->getBuffer();
+  const size_t HeaderSize = sizeof(MinimizedSourceEntryMagic) + 4;
+  if (Data.size() < HeaderSize ||
+      !Data.startswith(StringRef(MinimizedSourceEntryMagic,
+                                 sizeof(MinimizedSourceEntryMagic))))
+    return false;
+  using namespace llvm::support;
+  const unsigned char *Ptr = reinterpret_cast<const unsigned char *>(
+      Data.data() + sizeof(MinimizedSourceEntryMagic));
+  uint32_t NumRanges = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if ((Data.size() - HeaderSize) / 8 < NumRanges)
+    return false;
+
+  Mapping.clear();
+  for (uint32_t I = 0; I != NumRanges; ++I) {
+    uint32_t Offset = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    Mapping[Offset] = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  }
+  MinimizedContents.clear();
+  MinimizedContents.append(reinterpret_cast<const char *>(Ptr), Data.end());
+  // Keep the implicit null terminator that the minimizer would have added.
+  MinimizedContents.push_back('\0');
+  MinimizedContents.pop_back();
+  ++NumHits;
+  return true;
+}
+
+void MinimizedSourceDiskCache::store(
+    StringRef Contents, StringRef MinimizedContents,
+    const PreprocessorSkippedRangeMapping &Mapping) {
+  SmallString<256> EntryPath;
+  getEntryPath(Contents, EntryPath);
+
+  // Write the ranges in a deterministic order, so that concurrent writers of
+  // the same entry produce identical files.
+  SmallVector<std::pair<unsigned, unsigned>, 16> Ranges(Mapping.begin(),
+                                                        Mapping.end());
+  llvm::sort(Ranges);
+
+  SmallString<256> TempPath;
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(Twine(EntryPath) + "-%%%%%%%%.tmp",
+                                      FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    llvm::support::endian::Writer Writer(OS, llvm::support::little);
+    OS.write(MinimizedSourceEntryMagic, sizeof(MinimizedSourceEntryMagic));
+    Writer.write<uint32_t>(Ranges.size());
+    for (const auto &Range : Ranges) {
+      Writer.write<uint32_t>(Range.first);
+      Writer.write<uint32_t>(Range.second);
+    }
+    OS << MinimizedContents;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return;
+    }
+  }
+
+  // Publish the entry atomically. Another process may have published the same
+  // entry in the meantime, in which case this simply replaces it.
+  if (llvm::sys::fs::rename(TempPath, EntryPath))
+    llvm::sys::fs::remove(TempPath);
+}
+
+/// Minimizes \p Input once more with a diagnostics engine attached to find out
+/// why the minimization failed. This is only done on the failure path, so the
+/// common case doesn't pay for setting up the diagnostics.
+static std::string getMinimizationError(StringRef Input) {
+  MinimizationErrorCollector Collector;
+  DiagnosticsEngine Diags(new DiagnosticIDs(), new DiagnosticOptions(),
+                          &Collector, /*ShouldOwnClient=*/false);
+  llvm::SmallString<1024> MinimizedFileContents;
+  SmallVector<minimize_source_to_dependency_directives::Token, 64> Tokens;
+  minimizeSourceToDependencyDirectives(Input, MinimizedFileContents, Tokens,
+                                       &Diags);
+  if (Collector.Message.empty())
+    return "minimization failed";
+  return std::move(Collector.Message);
+}
+
+/// Minimizes \p Input and computes the skipped PP ranges that speedup skipping
+/// over inactive preprocessor blocks.
+///
+/// \returns True on error.
+static bool minimizeAndComputeSkippedRanges(
+    StringRef Input, llvm::SmallString<1024> &MinimizedFileContents,
+    PreprocessorSkippedRangeMapping &Mapping) {
+  SmallVector<minimize_source_to_dependency_directives::Token, 64> Tokens;
+  if (minimizeSourceToDependencyDirectives(Input, MinimizedFileContents,
+                                           Tokens))
+    return true;
+
+  llvm::SmallVector<minimize_source_to_dependency_directives::SkippedRange, 32>
+      SkippedRanges;
+  minimize_source_to_dependency_directives::computeSkippedRanges(Tokens,
+                                                                 SkippedRanges);
+  for (const auto &Range : SkippedRanges) {
+    if (Range.Length < 16) {
+      // Ignore small ranges as non-profitable.
+      // FIXME: This is a heuristic, its worth investigating the tradeoffs
+      // when it should be applied.
+      continue;
+    }
+    Mapping[Range.Offset] = Range.Length;
+  }
+  return false;
+}
+
 CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
-    StringRef Filename, llvm::vfs::FileSystem &FS, bool Minimize) {
+    StringRef Filename, llvm::vfs::FileSystem &FS, bool Minimize,
+    std::string *MinimizationError, MinimizedSourceDiskCache *DiskCache) {
   // Load the file and its content from the file system.
   llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>> MaybeFile =
       FS.openFileForRead(Filename);
@@ -33,14 +214,20 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
     return MaybeBuffer.getError();
 
   llvm::SmallString<1024> MinimizedFileContents;
-  // Minimize the file down to directives that might affect the dependencies.
+  PreprocessorSkippedRangeMapping Mapping;
+  // Minimize the file down to directives that might affect the dependencies,
+  // unless a previous run already did it.
   const auto &Buffer = *MaybeBuffer;
-  SmallVector<minimize_source_to_dependency_directives::Token, 64> Tokens;
-  if (!Minimize || minimizeSourceToDependencyDirectives(
-                       Buffer->getBuffer(), MinimizedFileContents, Tokens)) {
+  bool IsCached = Minimize && DiskCache &&
+                  DiskCache->lookup(Buffer->getBuffer(), MinimizedFileContents,
+                                    Mapping);
+  if (!IsCached &&
+      (!Minimize || minimizeAndComputeSkippedRanges(
+                        Buffer->getBuffer(), MinimizedFileContents, Mapping))) {
     // Use the original file unless requested otherwise, or
     // if the minimization failed.
-    // FIXME: Propage the diagnostic if desired by the client.
+    if (Minimize && MinimizationError)
+      *MinimizationError = getMinimizationError(Buffer->getBuffer());
     CachedFileSystemEntry Result;
     Result.MaybeStat = std::move(*Stat);
     Result.Contents.reserve(Buffer->getBufferSize() + 1);
@@ -50,6 +237,8 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
     Result.Contents.pop_back();
     return Result;
   }
+  if (!IsCached && DiskCache)
+    DiskCache->store(Buffer->getBuffer(), MinimizedFileContents, Mapping);
 
   CachedFileSystemEntry Result;
   size_t Size = MinimizedFileContents.size();
@@ -69,23 +258,6 @@ CachedFileSystemEntry CachedFileSystemEntry::createFileEntry(
   // Now make the null terminator implicit again, so that Clang's lexer can find
   // it right where the buffer ends.
   Result.Contents.pop_back();
-
-  // Compute the skipped PP ranges that speedup skipping over inactive
-  // preprocessor blocks.
-  llvm::SmallVector<minimize_source_to_dependency_directives::SkippedRange, 32>
-      SkippedRanges;
-  minimize_source_to_dependency_directives::computeSkippedRanges(Tokens,
-                                                                 SkippedRanges);
-  PreprocessorSkippedRangeMapping Mapping;
-  for (const auto &Range : SkippedRanges) {
-    if (Range.Length < 16) {
-      // Ignore small ranges as non-profitable.
-      // FIXME: This is a heuristic, its worth investigating the tradeoffs
-      // when it should be applied.
-      continue;
-    }
-    Mapping[Range.Offset] = Range.Length;
-  }
   Result.PPSkippedRangeMapping = std::move(Mapping);
 
   return Result;
@@ -101,12 +273,13 @@ CachedFileSystemEntry::createDirectoryEntry(llvm::vfs::Status &&Stat) {
 
 DependencyScanningFilesystemSharedCache::
     DependencyScanningFilesystemSharedCache() {
-  // This heuristic was chosen using a empirical testing on a
-  // reasonably high core machine (iMacPro 18 cores / 36 threads). The cache
-  // sharding gives a performance edge by reducing the lock contention.
+  // Use a few times more shards than threads, so that two threads rarely need
+  // the same shard at the same time even at high core counts. A fixed ratio of
+  // threads per shard stops scaling once all the shards are contended.
   // FIXME: A better heuristic might also consider the OS to account for
   // the different cost of lock contention on different OSes.
-  NumShards = std::max(2u, llvm::hardware_concurrency() / 4);
+  NumShards =
+      llvm::PowerOf2Ceil(std::max(8u, llvm::hardware_concurrency() * 4));
   CacheShards = std::make_unique<CacheShard[]>(NumShards);
 }
 
@@ -116,12 +289,60 @@ DependencyScanningFilesystemSharedCache::
 /// thread safe call.
 DependencyScanningFilesystemSharedCache::SharedFileSystemEntry &
 DependencyScanningFilesystemSharedCache::get(StringRef Key) {
-  CacheShard &Shard = CacheShards[llvm::hash_value(Key) % NumShards];
+  CacheShard &Shard = CacheShards[llvm::hash_value(Key) & (NumShards - 1)];
   std::unique_lock<std::mutex> LockGuard(Shard.CacheLock);
   auto It = Shard.Cache.try_emplace(Key);
   return It.first->getValue();
 }
 
+void DependencyScanningFilesystemSharedCache::noteMinimizationResult(
+    StringRef Filename, StringRef Error) {
+  if (Error.empty()) {
+    ++NumMinimizedFiles;
+    return;
+  }
+  std::unique_lock<std::mutex> LockGuard(MinimizationFallbacksLock);
+  MinimizationFallbacks.emplace_back(Filename, Error);
+}
+
+void DependencyScanningFilesystemSharedCache::invalidate(
+    llvm::function_ref<bool(StringRef Key, const CachedFileSystemEntry &Entry)>
+        ShouldInvalidate) {
+  // Bump the generation first, so that no worker keeps using an entry that is
+  // reset below.
+  ++Generation;
+  for (unsigned I = 0; I < NumShards; ++I) {
+    CacheShard &Shard = CacheShards[I];
+    std::unique_lock<std::mutex> LockGuard(Shard.CacheLock);
+    for (auto &Entry : Shard.Cache) {
+      SharedFileSystemEntry &SharedEntry = Entry.getValue();
+      std::unique_lock<std::mutex> ValueLockGuard(SharedEntry.ValueLock);
+      if (!SharedEntry.Value.isValid() ||
+          !ShouldInvalidate(Entry.getKey(), SharedEntry.Value))
+        continue;
+      SharedEntry.IsPopulated = false;
+      SharedEntry.Value = CachedFileSystemEntry();
+    }
+  }
+}
+
+void DependencyScanningFilesystemSharedCache::printMinimizationStats(
+    raw_ostream &OS) const {
+  std::unique_lock<std::mutex> LockGuard(MinimizationFallbacksLock);
+  auto Fallbacks = MinimizationFallbacks;
+  llvm::sort(Fallbacks);
+
+  OS << "*** Dependency Directive Minimization Stats:\n";
+  OS << "  " << NumMinimizedFiles << " files minimized\n";
+  OS << "  " << Fallbacks.size()
+     << " files fell back to their original contents\n";
+  for (const auto &Fallback : Fallbacks)
+    OS << "    " << Fallback.first << ": " << Fallback.second << "\n";
+  if (DiskCache)
+    OS << "  " << DiskCache->getNumHits()
+       << " minimized files loaded from the on-disk cache\n";
+}
+
 /// Whitelist file extensions that should be minimized, treating no extension as
 /// a source file that should be minimized.
 ///
@@ -163,7 +384,9 @@ DependencyScanningWorkerFilesystem::getOrCreateFileSystemEntry(
   DependencyScanningFilesystemSharedCache::SharedFileSystemEntry
       &SharedCacheEntry = SharedCache.get(Filename);
   const CachedFileSystemEntry *Result;
-  {
+  if (SharedCacheEntry.IsPopulated.load(std::memory_order_acquire)) {
+    Result = &SharedCacheEntry.Value;
+  } else {
     std::unique_lock<std::mutex> LockGuard(SharedCacheEntry.ValueLock);
     CachedFileSystemEntry &CacheEntry = SharedCacheEntry.Value;
 
@@ -182,11 +405,17 @@ DependencyScanningWorkerFilesystem::getOrCreateFileSystemEntry(
       } else if (MaybeStatus->isDirectory())
         CacheEntry = CachedFileSystemEntry::createDirectoryEntry(
             std::move(*MaybeStatus));
-      else
+      else {
+        std::string MinimizationError;
         CacheEntry = CachedFileSystemEntry::createFileEntry(
-            Filename, FS, !KeepOriginalSource);
+            Filename, FS, !KeepOriginalSource, &MinimizationError,
+            SharedCache.getDiskCache());
+        if (!KeepOriginalSource && CacheEntry.getStatus())
+          SharedCache.noteMinimizationResult(Filename, MinimizationError);
+      }
     }
 
+    SharedCacheEntry.IsPopulated.store(true, std::memory_order_release);
     Result = &CacheEntry;
   }
 
@@ -28,7 +28,8 @@ DependencyScanningTool::DependencyScanningTool(
 }
 
 llvm::Expected<std::string> DependencyScanningTool::getDependencyFile(
-    const tooling::CompilationDatabase &Compilations, StringRef CWD) {
+    const tooling::CompilationDatabase &Compilations, StringRef CWD,
+    std::vector<std::string> *FileDeps) {
   /// Prints out all of the gathered dependencies into a string.
   class MakeDependencyPrinterConsumer : public DependencyConsumer {
   public:
@@ -70,6 +71,11 @@ llvm::Expected<std::string> DependencyScanningTool::getDependencyFile(
       Generator.printDependencies(S);
     }
 
+    void collectFileDeps(std::vector<std::string> &FileDeps) {
+      FileDeps.insert(FileDeps.end(), Dependencies.begin(),
+                      Dependencies.end());
+    }
+
   private:
     std::unique_ptr<DependencyOutputOptions> Opts;
     std::vector<std::string> Dependencies;
@@ -132,6 +138,14 @@ llvm::Expected<std::string> DependencyScanningTool::getDependencyFile(
       return;
     }
 
+    void collectFileDeps(std::vector<std::string> &FileDeps) {
+      FileDeps.insert(FileDeps.end(), Dependencies.begin(),
+                      Dependencies.end());
+      for (auto &&Dep : ClangModuleDeps)
+        for (auto &&File : Dep.second.FileDeps)
+          FileDeps.push_back(File.getKey());
+    }
+
   private:
     std::vector<std::string> Dependencies;
     std::unordered_map<std::string, ModuleDeps> ClangModuleDeps;
@@ -156,6 +170,8 @@ llvm::Expected<std::string> DependencyScanningTool::getDependencyFile(
       return std::move(Result);
     std::string Output;
     Consumer.printDependencies(Output);
+    if (FileDeps)
+      Consumer.collectFileDeps(*FileDeps);
     return Output;
   } else {
     FullDependencyPrinterConsumer Consumer;
@@ -165,10 +181,58 @@ llvm::Expected<std::string> DependencyScanningTool::getDependencyFile(
       return std::move(Result);
     std::string Output;
     Consumer.printDependencies(Output, Input);
+    if (FileDeps)
+      Consumer.collectFileDeps(*FileDeps);
     return Output;
   }
 }
 
+llvm::Expected<FullDependencies> DependencyScanningTool::getFullDependencies(
+    const tooling::CompilationDatabase &Compilations, StringRef CWD) {
+  class FullDependencyConsumer : public DependencyConsumer {
+  public:
+    void handleFileDependency(const DependencyOutputOptions &Opts,
+                              StringRef File) override {
+      Deps.FileDeps.push_back(File);
+    }
+
+    void handleModuleDependency(ModuleDeps MD) override {
+      ClangModuleDeps[MD.ContextHash + MD.ModuleName] = std::move(MD);
+    }
+
+    void handleContextHash(std::string Hash) override {
+      Deps.ContextHash = std::move(Hash);
+    }
+
+    FullDependencies takeDependencies() {
+      for (auto &&Dep : ClangModuleDeps)
+        Deps.DiscoveredModules.push_back(std::move(Dep.second));
+      llvm::sort(Deps.DiscoveredModules,
+                 [](const ModuleDeps &LHS, const ModuleDeps &RHS) {
+                   return LHS.ModuleName < RHS.ModuleName;
+                 });
+      for (const ModuleDeps &MD : Deps.DiscoveredModules)
+        if (MD.ImportedByMainFile)
+          Deps.ClangModuleDeps.push_back(MD.ModuleName);
+      return std::move(Deps);
+    }
+
+  private:
+    FullDependencies Deps;
+    std::unordered_map<std::string, ModuleDeps> ClangModuleDeps;
+  };
+
+  assert(Compilations.getAllCompileCommands().size() == 1 &&
+         "Expected a compilation database with a single command!");
+  std::string Input = Compilations.getAllCompileCommands().front().Filename;
+
+  FullDependencyConsumer Consumer;
+  auto Result = Worker.computeDependencies(Input, CWD, Compilations, Consumer);
+  if (Result)
+    return std::move(Result);
+  return Consumer.takeDependencies();
+}
+
 } // end namespace dependencies
 } // end namespace tooling
 } // end namespace clang
@@ -74,10 +74,10 @@ public:
       StringRef WorkingDirectory, DependencyConsumer &Consumer,
       llvm::IntrusiveRefCntPtr<DependencyScanningWorkerFilesystem> DepFS,
       ExcludedPreprocessorDirectiveSkipMapping *PPSkipMappings,
-      ScanningOutputFormat Format)
+      ScanningOutputFormat Format, std::vector<std::string> CommandLine)
       : WorkingDirectory(WorkingDirectory), Consumer(Consumer),
         DepFS(std::move(DepFS)), PPSkipMappings(PPSkipMappings),
-        Format(Format) {}
+        Format(Format), CommandLine(std::move(CommandLine)) {}
 
   bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
                      FileManager *FileMgr,
@@ -142,8 +142,9 @@ public:
                                                         Consumer));
       break;
     case ScanningOutputFormat::Full:
-      Compiler.addDependencyCollector(
-          std::make_shared<ModuleDepCollector>(Compiler, Consumer));
+    case ScanningOutputFormat::ModuleGraph:
+      Compiler.addDependencyCollector(std::make_shared<ModuleDepCollector>(
+          Compiler, Consumer, CommandLine));
       break;
     }
 
@@ -162,13 +163,16 @@ private:
   llvm::IntrusiveRefCntPtr<DependencyScanningWorkerFilesystem> DepFS;
   ExcludedPreprocessorDirectiveSkipMapping *PPSkipMappings;
   ScanningOutputFormat Format;
+  /// The driver command line of the translation unit.
+  std::vector<std::string> CommandLine;
 };
 
 } // end anonymous namespace
 
 DependencyScanningWorker::DependencyScanningWorker(
     DependencyScanningService &Service)
-    : Format(Service.getFormat()) {
+    : SharedCacheGeneration(Service.getSharedCache().getGeneration()),
+      SharedCache(Service.getSharedCache()), Format(Service.getFormat()) {
   DiagOpts = new DiagnosticOptions();
   PCHContainerOps = std::make_shared<PCHContainerOperations>();
   RealFS = new ProxyFileSystemWithoutChdir(llvm::vfs::getRealFileSystem());
@@ -201,6 +205,20 @@ llvm::Error DependencyScanningWorker::computeDependencies(
     const std::string &Input, StringRef WorkingDirectory,
     const CompilationDatabase &CDB, DependencyConsumer &Consumer) {
   RealFS->setCurrentWorkingDirectory(WorkingDirectory);
+  // Everything that points into the entries of the shared cache is stale once
+  // they were invalidated: the local cache of the file system, the skip
+  // mappings of the minimized buffers, and the files held by the reused file
+  // manager.
+  unsigned Generation = SharedCache.getGeneration();
+  if (Generation != SharedCacheGeneration) {
+    if (PPSkipMappings)
+      PPSkipMappings->clear();
+    if (DepFS)
+      DepFS->clearLocalCache();
+    if (Files)
+      Files = new FileManager(FileSystemOptions(), RealFS);
+    SharedCacheGeneration = Generation;
+  }
   return runWithDiags(DiagOpts.get(), [&](DiagnosticConsumer &DC) {
     /// Create the tool that uses the underlying file system to ensure that any
     /// file system requests that are made by the driver do not go through the
@@ -210,8 +228,11 @@ llvm::Error DependencyScanningWorker::computeDependencies(
     Tool.setRestoreWorkingDir(false);
     Tool.setPrintErrorMessage(false);
     Tool.setDiagnosticConsumer(&DC);
-    DependencyScanningAction Action(WorkingDirectory, Consumer, DepFS,
-                                    PPSkipMappings.get(), Format);
+    std::vector<CompileCommand> Commands = CDB.getCompileCommands(Input);
+    DependencyScanningAction Action(
+        WorkingDirectory, Consumer, DepFS, PPSkipMappings.get(), Format,
+        Commands.empty() ? std::vector<std::string>()
+                         : std::move(Commands.front().CommandLine));
     return !Tool.run(&Action);
   });
 }
@@ -9,14 +9,83 @@
 
 #include "clang/Tooling/DependencyScanning/ModuleDepCollector.h"
 
+#include "clang/Driver/Options.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningWorker.h"
+#include "llvm/Option/ArgList.h"
 
 using namespace clang;
 using namespace tooling;
 using namespace dependencies;
 
+std::vector<std::string> ModuleDeps::getFullCommandLine(
+    llvm::function_ref<std::string(StringRef ModuleName)> LookupPCMPath)
+    const {
+  std::vector<std::string> Ret = NonPathCommandLine;
+
+  // Sort the dependencies to get a deterministic command line.
+  std::vector<StringRef> Deps;
+  for (auto &&Dep : ClangModuleDeps)
+    Deps.push_back(Dep.getKey());
+  llvm::sort(Deps);
+  for (StringRef Dep : Deps)
+    Ret.push_back("-fmodule-file=" + LookupPCMPath(Dep));
+
+  Ret.push_back("-o");
+  Ret.push_back(LookupPCMPath(ModuleName));
+  return Ret;
+}
+
+/// \returns The driver name of the language that the module maps should be
+/// parsed as to build modules compatible with the given translation unit.
+static StringRef getModuleMapLanguage(const CompilerInstance &CI) {
+  const LangOptions &LangOpts = CI.getLangOpts();
+  if (LangOpts.ObjC)
+    return LangOpts.CPlusPlus ? "objective-c++" : "objective-c";
+  return LangOpts.CPlusPlus ? "c++" : "c";
+}
+
+/// Drops the arguments that only concern the translation unit itself, such as
+/// its input and output and its dependency file, from the driver command line
+/// \p TUCommandLine. What remains determines how the modules are built.
+static std::vector<std::string>
+getModuleCommandLine(ArrayRef<std::string> TUCommandLine) {
+  std::vector<std::string> Ret;
+  if (TUCommandLine.empty())
+    return Ret;
+  Ret.push_back(TUCommandLine.front());
+
+  SmallVector<const char *, 64> Argv;
+  for (const std::string &Arg : TUCommandLine.drop_front())
+    Argv.push_back(Arg.c_str());
+  unsigned MissingArgIndex, MissingArgCount;
+  llvm::opt::InputArgList Args = driver::getDriverOptTable().ParseArgs(
+      Argv, MissingArgIndex, MissingArgCount,
+      /*FlagsToInclude=*/0, /*FlagsToExclude=*/driver::options::CLOption);
+
+  using namespace driver::options;
+  for (const llvm::opt::Arg *A : Args) {
+    const llvm::opt::Option &Opt = A->getOption();
+    if (Opt.matches(OPT_INPUT) || Opt.matches(OPT_o) || Opt.matches(OPT_c) ||
+        Opt.matches(OPT_E) || Opt.matches(OPT_S) ||
+        Opt.matches(OPT_fsyntax_only) || Opt.matches(OPT_x) ||
+        Opt.matches(OPT_M_Group) || Opt.matches(OPT_fmodules_cache_path) ||
+        Opt.matches(OPT_fimplicit_modules) ||
+        Opt.matches(OPT_fno_implicit_modules))
+      continue;
+    // These are added by clang-scan-deps to the translation unit command.
+    if (Opt.matches(OPT_Xclang) &&
+        (StringRef(A->getValue()) == "-Eonly" ||
+         StringRef(A->getValue()) == "-sys-header-deps"))
+      continue;
+    llvm::opt::ArgStringList Rendered;
+    A->render(Args, Rendered);
+    Ret.insert(Ret.end(), Rendered.begin(), Rendered.end());
+  }
+  return Ret;
+}
+
 void ModuleDepCollectorPP::FileChanged(SourceLocation Loc,
                                        FileChangeReason Reason,
                                        SrcMgr::CharacteristicKind FileType,
@@ -104,6 +173,13 @@ void ModuleDepCollectorPP::handleTopLevelModule(const Module *M) {
       });
 
   addAllSubmoduleDeps(M, MD);
+
+  MD.NonPathCommandLine = MDC.ModuleCommandLine;
+  MD.NonPathCommandLine.insert(
+      MD.NonPathCommandLine.end(),
+      {"-fno-implicit-modules", "-Xclang", "-emit-module",
+       "-fmodule-name=" + MD.ModuleName, "-x",
+       getModuleMapLanguage(Instance), "-c", MD.ClangModuleMapFile});
 }
 
 void ModuleDepCollectorPP::addAllSubmoduleDeps(const Module *M,
@@ -124,9 +200,10 @@ void ModuleDepCollectorPP::addModuleDep(const Module *M, ModuleDeps &MD) {
 }
 
 ModuleDepCollector::ModuleDepCollector(CompilerInstance &I,
-                                       DependencyConsumer &C)
-    : Instance(I), Consumer(C), ContextHash(I.getInvocation().getModuleHash()) {
-}
+                                       DependencyConsumer &C,
+                                       ArrayRef<std::string> TUCommandLine)
+    : Instance(I), Consumer(C), ContextHash(I.getInvocation().getModuleHash()),
+      ModuleCommandLine(getModuleCommandLine(TUCommandLine)) {}
 
 void ModuleDepCollector::attachToPreprocessor(Preprocessor &PP) {
   PP.addPPCallbacks(std::make_unique<ModuleDepCollectorPP>(Instance, *this));
@@ -24,7 +24,9 @@
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -159,6 +161,13 @@ std::vector<std::string> unescapeCommandLine(JSONCommandLineSyntax Syntax,
   return parser.parse();
 }
 
+llvm::cl::opt<bool> IndexCompilationDatabase(
+    "index-compilation-database",
+    llvm::cl::desc("Load compile_commands.json through an index stored next to "
+                   "it, so that only the entries of the processed files are "
+                   "parsed. The index is written on the first load."),
+    llvm::cl::init(false));
+
 // This plugin locates a nearby compile_command.json file, and also infers
 // compile commands for files not present in the database.
 class JSONCompilationDatabasePlugin : public CompilationDatabasePlugin {
@@ -166,8 +175,13 @@ class JSONCompilationDatabasePlugin : public CompilationDatabasePlugin {
   loadFromDirectory(StringRef Directory, std::string &ErrorMessage) override {
     SmallString<1024> JSONDatabasePath(Directory);
     llvm::sys::path::append(JSONDatabasePath, "compile_commands.json");
-    auto Base = JSONCompilationDatabase::loadFromFile(
-        JSONDatabasePath, ErrorMessage, JSONCommandLineSyntax::AutoDetect);
+    std::unique_ptr<CompilationDatabase> Base;
+    if (IndexCompilationDatabase)
+      Base = IndexedJSONCompilationDatabase::loadFromFile(
+          JSONDatabasePath, ErrorMessage, JSONCommandLineSyntax::AutoDetect);
+    else
+      Base = JSONCompilationDatabase::loadFromFile(
+          JSONDatabasePath, ErrorMessage, JSONCommandLineSyntax::AutoDetect);
     return Base ? inferTargetAndDriverMode(
                       inferMissingCompileCommands(expandResponseFiles(
                           std::move(Base), llvm::vfs::getRealFileSystem())))
@@ -258,6 +272,20 @@ JSONCompilationDatabase::getAllCompileCommands() const {
   return Commands;
 }
 
+/// Computes the path under which the entry for \p FileName, compiled in
+/// \p Directory, is indexed.
+static void getNativeFilePath(StringRef Directory, StringRef FileName,
+                              SmallVectorImpl<char> &NativeFilePath) {
+  if (llvm::sys::path::is_relative(FileName)) {
+    SmallString<128> AbsolutePath(Directory);
+    llvm::sys::path::append(AbsolutePath, FileName);
+    llvm::sys::path::remove_dots(AbsolutePath, /*remove_dot_dot=*/ true);
+    llvm::sys::path::native(AbsolutePath, NativeFilePath);
+  } else {
+    llvm::sys::path::native(FileName, NativeFilePath);
+  }
+}
+
 static llvm::StringRef stripExecutableExtension(llvm::StringRef Name) {
   Name.consume_back(".exe");
   return Name;
@@ -414,18 +442,10 @@ bool JSONCompilationDatabase::parse(std::string &ErrorMessage) {
       return false;
     }
     SmallString<8> FileStorage;
-    StringRef FileName = File->getValue(FileStorage);
+    SmallString<8> DirectoryStorage;
     SmallString<128> NativeFilePath;
-    if (llvm::sys::path::is_relative(FileName)) {
-      SmallString<8> DirectoryStorage;
-      SmallString<128> AbsolutePath(
-          Directory->getValue(DirectoryStorage));
-      llvm::sys::path::append(AbsolutePath, FileName);
-      llvm::sys::path::remove_dots(AbsolutePath, /*remove_dot_dot=*/ true);
-      llvm::sys::path::native(AbsolutePath, NativeFilePath);
-    } else {
-      llvm::sys::path::native(FileName, NativeFilePath);
-    }
+    getNativeFilePath(Directory->getValue(DirectoryStorage),
+                      File->getValue(FileStorage), NativeFilePath);
     auto Cmd = CompileCommandRef(Directory, File, *Command, Output);
     IndexByFile[NativeFilePath].push_back(Cmd);
     AllCommands.push_back(Cmd);
@@ -433,3 +453,303 @@ bool JSONCompilationDatabase::parse(std::string &ErrorMessage) {
   }
   return true;
 }
+
+// The index starts with a header holding the magic, the size and modification
+// time of the database it was built from, and the number of entries. The
+// entries follow, sorted by file path, then the file paths they refer to.
+static const char IndexMagic[8] = {'C', 'D', 'B', 'I', 'D', 'X', '0', '1'};
+static const size_t IndexHeaderSize = sizeof(IndexMagic) + 8 + 8 + 4;
+// The offset and length of the file path, the offset and length of the entry
+// in the database.
+static const size_t IndexEntrySize = 4 + 4 + 8 + 8;
+
+/// Finds the byte ranges of the objects in the top-level array of a JSON
+/// compilation database, without parsing the objects themselves.
+static bool findObjects(StringRef Database,
+                        std::vector<std::pair<uint64_t, uint64_t>> &Ranges) {
+  size_t I = Database.find_first_not_of(" \t\r\n");
+  if (I == StringRef::npos || Database[I] != '[')
+    return false;
+  unsigned Depth = 0;
+  size_t Begin = 0;
+  for (++I; I < Database.size(); ++I) {
+    char C = Database[I];
+    if (C == '"') {
+      for (++I; I < Database.size() && Database[I] != '"'; ++I)
+        if (Database[I] == '\\')
+          ++I;
+      if (I >= Database.size())
+        return false;
+    } else if (C == '{' || C == '[') {
+      if (Depth++ != 0)
+        continue;
+      if (C != '{')
+        return false;
+      Begin = I;
+    } else if (C == '}' || C == ']') {
+      if (Depth == 0)
+        return C == ']';
+      if (--Depth == 0)
+        Ranges.push_back({Begin, I + 1 - Begin});
+    }
+  }
+  return false;
+}
+
+/// Parses the compile commands in a single object of the database.
+static bool parseObject(StringRef Object, JSONCommandLineSyntax Syntax,
+                        std::vector<CompileCommand> &Commands,
+                        std::string &ErrorMessage) {
+  std::string Array = ("[" + Object + "]").str();
+  auto Database =
+      JSONCompilationDatabase::loadFromBuffer(Array, ErrorMessage, Syntax);
+  if (!Database)
+    return false;
+  for (CompileCommand &Command : Database->getAllCompileCommands())
+    Commands.push_back(std::move(Command));
+  return true;
+}
+
+static bool getDatabaseStatus(StringRef DatabasePath, uint64_t &Size,
+                              uint64_t &ModTime, std::string &ErrorMessage) {
+  llvm::sys::fs::file_status Status;
+  if (std::error_code EC = llvm::sys::fs::status(DatabasePath, Status)) {
+    ErrorMessage = "Error while opening JSON database: " + EC.message();
+    return false;
+  }
+  Size = Status.getSize();
+  ModTime = Status.getLastModificationTime().time_since_epoch().count();
+  return true;
+}
+
+std::unique_ptr<IndexedJSONCompilationDatabase>
+IndexedJSONCompilationDatabase::loadFromFile(StringRef FilePath,
+                                             std::string &ErrorMessage,
+                                             JSONCommandLineSyntax Syntax) {
+  uint64_t DatabaseSize, DatabaseModTime;
+  if (!getDatabaseStatus(FilePath, DatabaseSize, DatabaseModTime,
+                         ErrorMessage))
+    return nullptr;
+  std::unique_ptr<IndexedJSONCompilationDatabase> Database(
+      new IndexedJSONCompilationDatabase(FilePath, Syntax));
+  if (!Database->loadIndex(DatabaseSize, DatabaseModTime) &&
+      !Database->buildIndex(DatabaseSize, DatabaseModTime, ErrorMessage))
+    return nullptr;
+  return Database;
+}
+
+std::string IndexedJSONCompilationDatabase::getIndexPath(
+    StringRef DatabasePath) {
+  return (DatabasePath + ".idx").str();
+}
+
+bool IndexedJSONCompilationDatabase::loadIndex(uint64_t DatabaseSize,
+                                               uint64_t DatabaseModTime) {
+  auto Buffer = llvm::MemoryBuffer::getFile(getIndexPath(DatabasePath),
+                                            /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!Buffer)
+    return false;
+  StringRef Data = (*Buffer)->getBuffer();
+  if (Data.size() < IndexHeaderSize ||
+      !Data.startswith(StringRef(IndexMagic, sizeof(IndexMagic))))
+    return false;
+  using namespace llvm::support;
+  const unsigned char *Ptr =
+      reinterpret_cast<const unsigned char *>(Data.data() + sizeof(IndexMagic));
+  if (endian::readNext<uint64_t, little, unaligned>(Ptr) != DatabaseSize ||
+      endian::readNext<uint64_t, little, unaligned>(Ptr) != DatabaseModTime)
+    return false;
+  uint64_t NumEntries = endian::readNext<uint32_t, little, unaligned>(Ptr);
+  if ((Data.size() - IndexHeaderSize) / IndexEntrySize < NumEntries)
+    return false;
+  // Check the bounds once, so that the lookups don't need to.
+  uint64_t StringsSize =
+      Data.size() - IndexHeaderSize - NumEntries * IndexEntrySize;
+  for (uint64_t I = 0; I != NumEntries; ++I) {
+    uint64_t PathOffset = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    uint64_t PathLength = endian::readNext<uint32_t, little, unaligned>(Ptr);
+    uint64_t Begin = endian::readNext<uint64_t, little, unaligned>(Ptr);
+    uint64_t Length = endian::readNext<uint64_t, little, unaligned>(Ptr);
+    if (PathOffset + PathLength > StringsSize || Begin > DatabaseSize ||
+        Length > DatabaseSize - Begin)
+      return false;
+  }
+  Index = std::move(*Buffer);
+  return true;
+}
+
+bool IndexedJSONCompilationDatabase::buildIndex(uint64_t DatabaseSize,
+                                                uint64_t DatabaseModTime,
+                                                std::string &ErrorMessage) {
+  // Parse the database once, and match its commands with the byte ranges of
+  // the objects they come from.
+  auto Parsed =
+      JSONCompilationDatabase::loadFromFile(DatabasePath, ErrorMessage, Syntax);
+  if (!Parsed)
+    return false;
+  StringRef Database = Parsed->Database->getBuffer();
+  std::vector<std::pair<uint64_t, uint64_t>> Ranges;
+  if (!findObjects(Database, Ranges) ||
+      Ranges.size() != Parsed->AllCommands.size()) {
+    ErrorMessage = "Error while indexing JSON database: expected an array of "
+                   "objects.";
+    return false;
+  }
+
+  struct IndexEntry {
+    std::string File;
+    uint64_t Begin;
+    uint64_t Length;
+  };
+  std::vector<IndexEntry> Entries;
+  Entries.reserve(Ranges.size());
+  for (size_t I = 0, E = Ranges.size(); I != E; ++I) {
+    const auto &CommandRef = Parsed->AllCommands[I];
+    SmallString<8> DirectoryStorage;
+    SmallString<32> FilenameStorage;
+    SmallString<128> NativeFilePath;
+    getNativeFilePath(std::get<0>(CommandRef)->getValue(DirectoryStorage),
+                      std::get<1>(CommandRef)->getValue(FilenameStorage),
+                      NativeFilePath);
+    Entries.push_back(
+        {NativeFilePath.str().str(), Ranges[I].first, Ranges[I].second});
+  }
+  llvm::sort(Entries, [](const IndexEntry &LHS, const IndexEntry &RHS) {
+    return std::tie(LHS.File, LHS.Begin) < std::tie(RHS.File, RHS.Begin);
+  });
+
+  std::string Data;
+  {
+    llvm::raw_string_ostream OS(Data);
+    llvm::support::endian::Writer Writer(OS, llvm::support::little);
+    OS.write(IndexMagic, sizeof(IndexMagic));
+    Writer.write<uint64_t>(DatabaseSize);
+    Writer.write<uint64_t>(DatabaseModTime);
+    Writer.write<uint32_t>(Entries.size());
+    uint32_t PathOffset = 0;
+    for (const IndexEntry &Entry : Entries) {
+      Writer.write<uint32_t>(PathOffset);
+      Writer.write<uint32_t>(Entry.File.size());
+      Writer.write<uint64_t>(Entry.Begin);
+      Writer.write<uint64_t>(Entry.Length);
+      PathOffset += Entry.File.size();
+    }
+    for (const IndexEntry &Entry : Entries)
+      OS << Entry.File;
+  }
+  Index = llvm::MemoryBuffer::getMemBufferCopy(Data);
+
+  // Saving the index is best effort: the database may live in a read-only
+  // directory, in which case it is indexed again by the next load.
+  std::string IndexPath = getIndexPath(DatabasePath);
+  SmallString<256> TempPath;
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(IndexPath + "-%%%%%%%%.tmp", FD,
+                                      TempPath))
+    return true;
+  llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << Data;
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    llvm::sys::fs::remove(TempPath);
+  } else if (llvm::sys::fs::rename(TempPath, IndexPath)) {
+    llvm::sys::fs::remove(TempPath);
+  }
+  return true;
+}
+
+uint32_t IndexedJSONCompilationDatabase::getNumEntries() const {
+  using namespace llvm::support;
+  return endian::read32le(Index->getBufferStart() + IndexHeaderSize - 4);
+}
+
+StringRef IndexedJSONCompilationDatabase::getEntryFile(uint32_t I) const {
+  using namespace llvm::support;
+  const char *Entry =
+      Index->getBufferStart() + IndexHeaderSize + I * IndexEntrySize;
+  const char *Strings =
+      Index->getBufferStart() + IndexHeaderSize +
+      static_cast<uint64_t>(getNumEntries()) * IndexEntrySize;
+  return StringRef(Strings + endian::read32le(Entry),
+                   endian::read32le(Entry + 4));
+}
+
+std::pair<uint64_t, uint64_t>
+IndexedJSONCompilationDatabase::getEntryRange(uint32_t I) const {
+  using namespace llvm::support;
+  const char *Entry =
+      Index->getBufferStart() + IndexHeaderSize + I * IndexEntrySize;
+  return {endian::read64le(Entry + 8), endian::read64le(Entry + 16)};
+}
+
+std::vector<CompileCommand>
+IndexedJSONCompilationDatabase::getCompileCommands(StringRef FilePath) const {
+  SmallString<128> NativeFilePath;
+  llvm::sys::path::native(FilePath, NativeFilePath);
+
+  std::pair<uint32_t, uint32_t> Entries = findEntries(NativeFilePath);
+  if (Entries.first == Entries.second) {
+    // Fall back to matching the path through symlinks and suffixes.
+    std::call_once(MatchTrieFlag, [this] {
+      for (const std::string &File : getAllFiles())
+        MatchTrie.insert(File);
+    });
+    std::string Error;
+    llvm::raw_string_ostream ES(Error);
+    StringRef Match = MatchTrie.findEquivalent(NativeFilePath, ES);
+    if (Match.empty())
+      return {};
+    Entries = findEntries(Match);
+  }
+
+  std::vector<CompileCommand> Commands;
+  for (uint32_t I = Entries.first; I != Entries.second; ++I) {
+    std::pair<uint64_t, uint64_t> Range = getEntryRange(I);
+    auto Object = llvm::MemoryBuffer::getFileSlice(
+        DatabasePath, Range.second, Range.first, /*IsVolatile=*/true);
+    std::string ErrorMessage;
+    if (!Object ||
+        !parseObject((*Object)->getBuffer(), Syntax, Commands, ErrorMessage))
+      return {};
+  }
+  return Commands;
+}
+
+std::pair<uint32_t, uint32_t>
+IndexedJSONCompilationDatabase::findEntries(StringRef NativeFilePath) const {
+  // Binary search the entries of the file, which are adjacent in the index.
+  uint32_t Low = 0, High = getNumEntries();
+  while (Low < High) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    if (getEntryFile(Mid) < NativeFilePath)
+      Low = Mid + 1;
+    else
+      High = Mid;
+  }
+  uint32_t End = Low;
+  while (End != getNumEntries() && getEntryFile(End) == NativeFilePath)
+    ++End;
+  return {Low, End};
+}
+
+std::vector<std::string> IndexedJSONCompilationDatabase::getAllFiles() const {
+  std::vector<std::string> Result;
+  for (uint32_t I = 0, E = getNumEntries(); I != E; ++I) {
+    StringRef File = getEntryFile(I);
+    if (Result.empty() || Result.back() != File)
+      Result.push_back(File.str());
+  }
+  return Result;
+}
+
+std::vector<CompileCommand>
+IndexedJSONCompilationDatabase::getAllCompileCommands() const {
+  std::string ErrorMessage;
+  auto Database =
+      JSONCompilationDatabase::loadFromFile(DatabasePath, ErrorMessage, Syntax);
+  if (!Database)
+    return {};
+  return Database->getAllCompileCommands();
+}
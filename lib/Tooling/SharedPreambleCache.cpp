@@ -0,0 +1,344 @@
+//===- SharedPreambleCache.cpp - Preambles shared between TUs -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Tooling/SharedPreambleCache.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/ASTUnit.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/PrecompiledPreamble.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+using namespace tooling;
+
+namespace {
+
+using StandaloneDiagnostics = std::vector<ASTUnit::StandaloneDiagnostic>;
+
+/// Records the diagnostics reported while building a preamble, with their
+/// locations stored as file offsets.
+class PreambleDiagnosticRecorder : public DiagnosticConsumer {
+public:
+  PreambleDiagnosticRecorder(StandaloneDiagnostics &Diagnostics)
+      : Diagnostics(Diagnostics) {}
+
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP) override {
+    this->LangOpts = &LangOpts;
+  }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    StoredDiagnostic Stored(Level, Info);
+    ASTUnit::StandaloneDiagnostic SD;
+    SD.ID = Stored.getID();
+    SD.Level = Stored.getLevel();
+    SD.Message = Stored.getMessage();
+    SD.LocOffset = 0;
+    if (Stored.getLocation().isValid() && LangOpts) {
+      const SourceManager &SM = Stored.getLocation().getManager();
+      SourceLocation FileLoc = SM.getFileLoc(Stored.getLocation());
+      SD.Filename = SM.getFilename(FileLoc);
+      SD.LocOffset = SM.getFileOffset(FileLoc);
+      for (const CharSourceRange &Range : Stored.getRanges()) {
+        CharSourceRange FileRange =
+            Lexer::makeFileCharRange(Range, SM, *LangOpts);
+        if (FileRange.isValid())
+          SD.Ranges.emplace_back(SM.getFileOffset(FileRange.getBegin()),
+                                 SM.getFileOffset(FileRange.getEnd()));
+      }
+    }
+    Diagnostics.push_back(std::move(SD));
+  }
+
+private:
+  StandaloneDiagnostics &Diagnostics;
+  const LangOptions *LangOpts = nullptr;
+};
+
+/// Reports the diagnostics of a preamble when the main file is entered, so
+/// that they come before the diagnostics of the rest of the translation unit.
+class PreambleDiagnosticReplayer : public PPCallbacks {
+public:
+  PreambleDiagnosticReplayer(
+      const Preprocessor &PP, StringRef PreambleMainFileName,
+      std::shared_ptr<const StandaloneDiagnostics> Diagnostics)
+      : SM(PP.getSourceManager()), Diags(PP.getDiagnostics()),
+        PreambleMainFileName(PreambleMainFileName),
+        Diagnostics(std::move(Diagnostics)) {}
+
+  void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                   SrcMgr::CharacteristicKind FileType,
+                   FileID PrevFID) override {
+    if (!Diagnostics || Reason != EnterFile ||
+        SM.getFileID(Loc) != SM.getMainFileID())
+      return;
+    for (const ASTUnit::StandaloneDiagnostic &SD : *Diagnostics)
+      Diags.Report(translate(SD));
+    Diagnostics.reset();
+  }
+
+private:
+  /// Maps \p SD into this translation unit. The preamble region of the main
+  /// file the preamble was built for is identical to that of this main file.
+  StoredDiagnostic translate(const ASTUnit::StandaloneDiagnostic &SD) {
+    SourceLocation FileLoc;
+    if (SD.Filename == PreambleMainFileName) {
+      FileLoc = SM.getLocForStartOfFile(SM.getMainFileID());
+    } else if (!SD.Filename.empty()) {
+      if (auto File = SM.getFileManager().getFile(SD.Filename))
+        FileLoc = SM.getLocForStartOfFile(SM.translateFile(*File));
+    }
+    if (FileLoc.isInvalid())
+      return StoredDiagnostic(SD.Level, SD.ID, SD.Message);
+
+    SmallVector<CharSourceRange, 4> Ranges;
+    for (const auto &Range : SD.Ranges)
+      Ranges.push_back(
+          CharSourceRange::getCharRange(FileLoc.getLocWithOffset(Range.first),
+                                        FileLoc.getLocWithOffset(Range.second)));
+    return StoredDiagnostic(SD.Level, SD.ID, SD.Message,
+                            FullSourceLoc(FileLoc.getLocWithOffset(SD.LocOffset),
+                                          SM),
+                            Ranges, None);
+  }
+
+  const SourceManager &SM;
+  DiagnosticsEngine &Diags;
+  std::string PreambleMainFileName;
+  std::shared_ptr<const StandaloneDiagnostics> Diagnostics;
+};
+
+/// Forwards the diagnostics of a translation unit that uses a shared preamble
+/// to another consumer, starting with the diagnostics of the preamble.
+class SharedPreambleDiagConsumer : public DiagnosticConsumer {
+public:
+  SharedPreambleDiagConsumer(
+      DiagnosticConsumer *Target, DiagnosticOptions &DiagOpts,
+      StringRef PreambleMainFileName,
+      std::shared_ptr<const StandaloneDiagnostics> Diagnostics)
+      : Target(Target), PreambleMainFileName(PreambleMainFileName),
+        Diagnostics(std::move(Diagnostics)) {
+    if (!Target) {
+      OwnedTarget = std::make_unique<TextDiagnosticPrinter>(llvm::errs(),
+                                                            &DiagOpts);
+      this->Target = OwnedTarget.get();
+    }
+  }
+
+  void BeginSourceFile(const LangOptions &LangOpts,
+                       const Preprocessor *PP) override {
+    Target->BeginSourceFile(LangOpts, PP);
+    // The preprocessor is only const to keep diagnostic consumers from
+    // changing the translation unit; the callbacks do not.
+    if (PP && Diagnostics)
+      const_cast<Preprocessor *>(PP)->addPPCallbacks(
+          std::make_unique<PreambleDiagnosticReplayer>(
+              *PP, PreambleMainFileName, std::move(Diagnostics)));
+  }
+
+  void EndSourceFile() override { Target->EndSourceFile(); }
+
+  void finish() override { Target->finish(); }
+
+  bool IncludeInDiagnosticCounts() const override {
+    return Target->IncludeInDiagnosticCounts();
+  }
+
+  void clear() override {
+    DiagnosticConsumer::clear();
+    Target->clear();
+  }
+
+  void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                        const Diagnostic &Info) override {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    Target->HandleDiagnostic(Level, Info);
+  }
+
+private:
+  DiagnosticConsumer *Target;
+  std::unique_ptr<DiagnosticConsumer> OwnedTarget;
+  std::string PreambleMainFileName;
+  std::shared_ptr<const StandaloneDiagnostics> Diagnostics;
+};
+
+} // end anonymous namespace
+
+/// A precompiled preamble along with the diagnostics reported while building
+/// it, which the translation units using it do not report themselves.
+struct SharedPreambleCache::BuiltPreamble {
+  BuiltPreamble(PrecompiledPreamble Preamble) : Preamble(std::move(Preamble)) {}
+
+  PrecompiledPreamble Preamble;
+  /// The main file of the translation unit the preamble was built for.
+  std::string MainFileName;
+  StandaloneDiagnostics Diagnostics;
+};
+
+SharedPreambleCache::SharedPreambleCache() = default;
+
+SharedPreambleCache::~SharedPreambleCache() = default;
+
+/// Returns the contents of the main file of \p Invocation, taking the
+/// remapped files into account.
+static std::unique_ptr<llvm::MemoryBuffer>
+getMainFileBuffer(const CompilerInvocation &Invocation,
+                  llvm::vfs::FileSystem &VFS) {
+  StringRef MainFile = Invocation.getFrontendOpts().Inputs[0].getFile();
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  for (const auto &RB : PPOpts.RemappedFileBuffers)
+    if (RB.first == MainFile)
+      return llvm::MemoryBuffer::getMemBufferCopy(RB.second->getBuffer(),
+                                                  MainFile);
+  auto Buffer = VFS.getBufferForFile(MainFile);
+  if (!Buffer)
+    return nullptr;
+  return std::move(*Buffer);
+}
+
+/// Returns the key of the preamble of a translation unit: its cc1 arguments,
+/// minus those naming the main file, followed by the preamble itself.
+static std::string getCacheKey(ArrayRef<const char *> CC1Args,
+                               StringRef MainFile, StringRef PreambleBytes) {
+  std::string Key;
+  for (size_t I = 0, E = CC1Args.size(); I != E; ++I) {
+    StringRef Arg = CC1Args[I];
+    if (Arg == MainFile)
+      continue;
+    if (Arg == "-main-file-name") {
+      ++I;
+      continue;
+    }
+    Key += Arg;
+    Key += '\0';
+  }
+  Key += '\0';
+  Key += PreambleBytes;
+  return Key;
+}
+
+std::unique_ptr<DiagnosticConsumer> SharedPreambleCache::usePreamble(
+    std::unique_ptr<CompilerInvocation> &Invocation,
+    ArrayRef<const char *> CC1Args,
+    IntrusiveRefCntPtr<llvm::vfs::FileSystem> VFS,
+    std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+    DiagnosticConsumer *DiagConsumer) {
+  const FrontendOptions &FrontendOpts = Invocation->getFrontendOpts();
+  if (FrontendOpts.Inputs.size() != 1 || !FrontendOpts.Inputs[0].isFile() ||
+      FrontendOpts.Inputs[0].getKind().getFormat() != InputKind::Source ||
+      !Invocation->getPreprocessorOpts().ImplicitPCHInclude.empty())
+    return nullptr;
+
+  std::unique_ptr<llvm::MemoryBuffer> MainFileBuffer =
+      getMainFileBuffer(*Invocation, *VFS);
+  if (!MainFileBuffer)
+    return nullptr;
+  PreambleBounds Bounds = ComputePreambleBounds(
+      *Invocation->getLangOpts(), MainFileBuffer.get(), /*MaxLines=*/0);
+  if (Bounds.Size == 0)
+    return nullptr;
+
+  std::string Key =
+      getCacheKey(CC1Args, FrontendOpts.Inputs[0].getFile(),
+                  MainFileBuffer->getBuffer().take_front(Bounds.Size));
+  std::shared_ptr<const BuiltPreamble> Preamble;
+  bool Claimed = false;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> LockGuard(Lock);
+      Entry &E = Cache[Key];
+      // Nobody else uses this preamble yet, parse the translation unit as
+      // usual.
+      if (!Preamble && ++E.NumUses == 1)
+        return nullptr;
+      // Wait for the translation unit that claimed the preamble to build it.
+      PreambleBuilt.wait(LockGuard, [&] { return !E.Building; });
+      if (E.Failed)
+        return nullptr;
+      // The preamble was never built, or the one we found to be out of date
+      // has not been replaced yet: build it ourselves.
+      if (E.Preamble == Preamble) {
+        E.Building = Claimed = true;
+        break;
+      }
+      Preamble = E.Preamble;
+    }
+    if (Preamble->Preamble.CanReuse(*Invocation, MainFileBuffer.get(), Bounds,
+                                    VFS.get()))
+      break;
+  }
+
+  if (Claimed) {
+    // This translation unit is the only one building the preamble. Errors in
+    // the preamble are reported when the translation units are parsed without
+    // it, other diagnostics are replayed for each of them.
+    StandaloneDiagnostics Diagnostics;
+    PreambleDiagnosticRecorder Recorder(Diagnostics);
+    IntrusiveRefCntPtr<DiagnosticsEngine> PreambleDiags =
+        CompilerInstance::createDiagnostics(&Invocation->getDiagnosticOpts(),
+                                            &Recorder,
+                                            /*ShouldOwnClient=*/false);
+    PreambleCallbacks Callbacks;
+    auto NewPreamble = PrecompiledPreamble::Build(
+        *Invocation, MainFileBuffer.get(), Bounds, *PreambleDiags, VFS,
+        PCHContainerOps, /*StoreInMemory=*/false, Callbacks);
+    bool Failed = !NewPreamble || PreambleDiags->hasErrorOccurred();
+    if (!Failed) {
+      auto Built = std::make_shared<BuiltPreamble>(std::move(*NewPreamble));
+      Built->MainFileName = FrontendOpts.Inputs[0].getFile();
+      Built->Diagnostics = std::move(Diagnostics);
+      Preamble = std::move(Built);
+    }
+    {
+      std::lock_guard<std::mutex> LockGuard(Lock);
+      Entry &E = Cache[Key];
+      E.Building = false;
+      E.Failed = Failed;
+      if (!Failed)
+        E.Preamble = Preamble;
+    }
+    PreambleBuilt.notify_all();
+    if (Failed)
+      return nullptr;
+  }
+
+  // The preamble has to be visible through the file system the translation
+  // unit is parsed with, which cannot be replaced at this point.
+  auto PreambleInvocation = std::make_unique<CompilerInvocation>(*Invocation);
+  IntrusiveRefCntPtr<llvm::vfs::FileSystem> PreambleVFS = VFS;
+  Preamble->Preamble.AddImplicitPreamble(*PreambleInvocation, PreambleVFS,
+                                         MainFileBuffer.get());
+  if (PreambleVFS != VFS)
+    return nullptr;
+  // The invocation now owns the main file buffer.
+  MainFileBuffer.release();
+  Invocation = std::move(PreambleInvocation);
+
+  {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    ++NumReuses;
+  }
+  std::shared_ptr<const StandaloneDiagnostics> Diagnostics(
+      Preamble, &Preamble->Diagnostics);
+  return std::make_unique<SharedPreambleDiagConsumer>(
+      DiagConsumer, Invocation->getDiagnosticOpts(), Preamble->MainFileName,
+      std::move(Diagnostics));
+}
+
+unsigned SharedPreambleCache::getNumReuses() const {
+  std::lock_guard<std::mutex> LockGuard(Lock);
+  return NumReuses;
+}
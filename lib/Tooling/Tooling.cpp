@@ -34,6 +34,7 @@
 #include "clang/Lex/PreprocessorOptions.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/SharedPreambleCache.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallString.h"
@@ -49,6 +50,7 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
@@ -354,6 +356,14 @@ bool ToolInvocation::run() {
     Invocation->getPreprocessorOpts().addRemappedFile(It.getKey(),
                                                       Input.release());
   }
+  std::unique_ptr<DiagnosticConsumer> PreambleDiagConsumer;
+  if (PreambleCache)
+    PreambleDiagConsumer = PreambleCache->usePreamble(
+        Invocation, *CC1Args, &Files->getVirtualFileSystem(), PCHContainerOps,
+        DiagConsumer);
+  llvm::SaveAndRestore<DiagnosticConsumer *> RestoreDiagConsumer(
+      DiagConsumer,
+      PreambleDiagConsumer ? PreambleDiagConsumer.get() : DiagConsumer);
   return runInvocation(BinaryName, Compilation.get(), std::move(Invocation),
                        std::move(PCHContainerOps));
 }
@@ -546,6 +556,7 @@ int ClangTool::run(ToolAction *Action) {
       ToolInvocation Invocation(std::move(CommandLine), Action, Files.get(),
                                 PCHContainerOps);
       Invocation.setDiagnosticConsumer(DiagConsumer);
+      Invocation.setPreambleCache(PreambleCache);
 
       if (!Invocation.run()) {
         // FIXME: Diagnostics should be used instead.
@@ -606,6 +617,10 @@ void ClangTool::setPrintErrorMessage(bool PrintErrorMessage) {
   this->PrintErrorMessage = PrintErrorMessage;
 }
 
+void ClangTool::setPreambleCache(SharedPreambleCache *PreambleCache) {
+  this->PreambleCache = PreambleCache;
+}
+
 namespace clang {
 namespace tooling {
 
@@ -0,0 +1,37 @@
+// RUN: rm -f %t.json
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config analysis-profile-file=%t.json \
+// RUN:   -analyzer-config profile-checkers=true -verify %s
+// RUN: FileCheck --input-file=%t.json %s
+
+// Without profile-checkers, only the functions are measured.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config analysis-profile-file=%t.json -verify %s
+// RUN: FileCheck --input-file=%t.json %s --check-prefix=NOCHECKERS
+
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config analysis-profile-file=%t.nonexistent/profile.json \
+// RUN:   %s 2>&1 | FileCheck %s --check-prefix=UNWRITABLE
+
+// expected-no-diagnostics
+
+// CHECK:      "checker-callbacks": [
+// CHECK:        "checker": "core.DivideZero",
+// CHECK:      "functions": [
+// CHECK-NEXT:   {
+// CHECK-NEXT:     "graph-allocated-bytes": {{[0-9]+}},
+// CHECK-NEXT:     "max-nodes": {{[0-9]+}},
+// CHECK-NEXT:     "name": "divide",
+// CHECK-NEXT:     "wall-time-us": {{[0-9]+}}
+// CHECK-NEXT:   }
+// CHECK-NEXT: ]
+
+// NOCHECKERS:      "checker-callbacks": [],
+// NOCHECKERS-NEXT: "functions": [
+// NOCHECKERS:        "name": "divide",
+
+// UNWRITABLE: warning: unable to open analysis profile file '{{.*}}profile.json': '{{.+}}' [-Wanalyzer-profile-file]
+
+int divide(int x) {
+  return 10 / x;
+}
@@ -0,0 +1,55 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: mkdir -p %t/ctudir
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu \
+// RUN:   -emit-pch -o %t/ctudir/ctu-other.c.ast %S/Inputs/ctu-other.c
+// RUN: %clang_extdef_map \
+// RUN:   -from-text-index %S/Inputs/ctu-other.c.externalDefMap.txt \
+// RUN:   -binary-index %t/ctudir/externalDefMap.bin
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -fsyntax-only -std=c89 -analyze \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-index-name=externalDefMap.bin \
+// RUN:   -verify %s
+// RUN: %clang_cc1 -triple x86_64-pc-linux-gnu -fsyntax-only -std=c89 -analyze \
+// RUN:   -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config experimental-enable-naive-ctu-analysis=true \
+// RUN:   -analyzer-config ctu-dir=%t/ctudir \
+// RUN:   -analyzer-config ctu-index-name=externalDefMap.bin \
+// RUN:   -analyzer-config display-ctu-progress=true 2>&1 %s | FileCheck %s
+//
+// The binary index can only be converted from a text index.
+// RUN: not %clang_extdef_map -binary-index %t/alone.bin %s -- 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=ALONE
+// RUN: echo "not-an-index-line" > %t/invalid.txt
+// RUN: not %clang_extdef_map -from-text-index %t/invalid.txt \
+// RUN:   -binary-index %t/invalid.bin 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=INVALID
+
+// CHECK: CTU loaded AST file: {{.*}}ctu-other.c.ast
+
+// ALONE: error: -from-text-index and -binary-index must be given together
+// INVALID: error: Invalid index file format
+
+void clang_analyzer_eval(int);
+
+typedef struct {
+  int a;
+  int b;
+} FooBar;
+extern FooBar fb;
+int f(int);
+void testGlobalVariable() {
+  clang_analyzer_eval(f(5) == 1); // expected-warning{{TRUE}}
+}
+
+int enumCheck(void);
+void testEnum() {
+  clang_analyzer_eval(enumCheck() == 42); // expected-warning{{TRUE}}
+}
+
+// Not in the index.
+int notInOtherTU(int);
+void testMissing() {
+  clang_analyzer_eval(notInOtherTU(1) == 1); // expected-warning{{UNKNOWN}}
+}
@@ -0,0 +1,24 @@
+// RUN: %clang_analyze_cc1 -w -analyzer-checker=core \
+// RUN:   -analyzer-config exploration_strategy=coverage_guided -verify %s
+
+extern int coin();
+
+int lateBlock(int n) {
+  int *x = 0;
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    if (coin())
+      sum += i;
+    else
+      sum -= i;
+  }
+  if (sum < 0)
+    return *x; // expected-warning{{Dereference of null pointer (loaded from variable 'x')}}
+  return sum;
+}
+
+void inlined() {
+  while (coin())
+    if (coin())
+      lateBlock(coin());
+}
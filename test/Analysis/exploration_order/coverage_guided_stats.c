@@ -0,0 +1,10 @@
+// RUN: %clang_analyze_cc1 -w -analyzer-checker=core \
+// RUN:   -analyzer-config exploration_strategy=coverage_guided \
+// RUN:   -analyzer-stats %S/coverage_guided.c 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// Every block of 'inlined' and of 'lateBlock', which is inlined into it, is
+// reached. 'lateBlock' is counted once, although it is inlined at every
+// iteration of the loop.
+// CHECK: ... Statistics Collected ...
+// CHECK-DAG: 100 WorkList - The % of basic blocks covered by the coverage-guided worklist
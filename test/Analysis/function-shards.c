@@ -0,0 +1,46 @@
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -verify=shard0,shard1 %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config function-shard-count=2,function-shard-index=0 \
+// RUN:   -verify=shard0 %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config function-shard-count=2,function-shard-index=1 \
+// RUN:   -verify=shard1 %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config function-shard-count=2,function-shard-index=1 \
+// RUN:   %s 2>&1 | FileCheck %s --check-prefix=SHARD1
+
+// Every function nothing else calls is analyzed in exactly one shard, picked
+// by a hash of its name.
+
+void f() {
+  int *p = 0;
+  *p = 1; // shard1-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+void g() {
+  int *p = 0;
+  *p = 2; // shard0-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+void h() {
+  int *p = 0;
+  *p = 3; // shard1-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+void bar() {
+  int *p = 0;
+  *p = 4; // shard0-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+// 'callee' hashes to shard 1, but belongs to the shard of its caller, which
+// inlines it. It is not analyzed as top level in shard 1, just like it is not
+// analyzed as top level without shards.
+// SHARD1-NOT: ANALYZE (Path, {{.*}} callee
+
+int callee(int *p) {
+  return *p; // shard0-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+void caller() {
+  callee(0);
+}
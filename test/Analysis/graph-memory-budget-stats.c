@@ -0,0 +1,10 @@
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,unix.Malloc \
+// RUN:   -analyzer-config graph-memory-budget=1 \
+// RUN:   -analyzer-stats %S/graph-memory-budget.c 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// Statistics are only collected in builds with assertions.
+
+// CHECK: ... Statistics Collected ...
+// CHECK-DAG: {{[1-9][0-9]*}} CoreEngine - The # of times the exploded graph was compacted.
+// CHECK-DAG: {{[1-9][0-9]*}} CoreEngine - The # of nodes removed by compacting the exploded graph.
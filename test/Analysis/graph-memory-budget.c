@@ -0,0 +1,58 @@
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,unix.Malloc \
+// RUN:   -analyzer-config graph-memory-budget=1 -verify %s
+
+// Compacting the graph must keep the error nodes of the reports emitted
+// before the graph outgrew its budget, as well as the paths still pending.
+// graph-memory-budget-stats.c checks that the graph is actually compacted.
+
+typedef __typeof(sizeof(int)) size_t;
+void *malloc(size_t);
+extern void exit(int) __attribute__((__noreturn__));
+int coin(void);
+
+int test(int *p, int n) {
+  if (!p)
+    return *p; // expected-warning{{Dereference of null pointer}}
+
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    if (coin())
+      sum += 1;
+    if (coin())
+      sum += 2;
+    if (coin())
+      sum += 4;
+    if (coin())
+      sum += 8;
+    if (coin())
+      sum += 16;
+  }
+  int *q = 0;
+  if (sum == 100)
+    return *q; // expected-warning{{Dereference of null pointer (loaded from variable 'q')}}
+  return sum;
+}
+
+// The leak is suppressed because every path from it ends in exit(). The sinks
+// below the leak must survive the compactions that happen before the report
+// is flushed.
+void leakBeforeExit(int n) {
+  int fatal = 1;
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    if (coin())
+      sum += 1;
+    if (coin())
+      sum += 2;
+    if (coin())
+      sum += 4;
+    if (coin())
+      sum += 8;
+    if (coin())
+      sum += 16;
+  }
+  void *m = malloc(1); // no-warning
+  m = 0;
+  if (fatal)
+    exit(1);
+}
@@ -0,0 +1,41 @@
+// RUN: rm -rf %t && mkdir %t
+//
+// Reused reports are printed exactly like the reports of a full run,
+// including their ranges.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache %s 2> %t/cold.txt
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache %s 2> %t/warm.txt
+// RUN: FileCheck %s --check-prefix=TEXT < %t/cold.txt
+// RUN: not grep ANALYZE %t/warm.txt
+// RUN: diff %t/cold.txt %t/warm.txt
+//
+// Recorded reports have no path, so nothing is reused for plist output, which
+// stays the same as without a cache, and a warning says so.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-output=plist \
+// RUN:   -o %t/cold.plist %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-output=plist \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -analyzer-display-progress -o %t/warm.plist %s 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=PLIST
+// RUN: diff %t/cold.plist %t/warm.plist
+// RUN: FileCheck %s --check-prefix=PATH < %t/warm.plist
+
+// TEXT: warning: Dereference of null pointer (loaded from variable 'p')
+// TEXT-NEXT: *p = 1;
+// TEXT-NEXT: ~
+
+// PLIST: warning: incremental analysis is disabled because reports are emitted with paths [-Wanalyzer-incremental-analysis]
+// PLIST: ANALYZE (Path,  Inline_Regular): {{.*}} caller
+
+// PATH: <string>&apos;p&apos; initialized to a null pointer value</string>
+
+int callee(int c) {
+  return c;
+}
+
+void caller(int c) {
+  int *p = 0;
+  if (callee(c))
+    *p = 1;
+}
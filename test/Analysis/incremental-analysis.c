@@ -0,0 +1,66 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: cp %s %t/input.c
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -verify %t/input.c 2>&1 | FileCheck %s --check-prefix=FIRST
+//
+// Nothing changed, so every report is reused.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -verify %t/input.c 2>&1 | FileCheck %s --check-prefix=SECOND \
+// RUN:   --allow-empty
+//
+// Changing a function also reanalyzes the functions it was inlined into.
+// RUN: sed -i 's/x + 0/x - 0/' %t/input.c
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -verify %t/input.c 2>&1 | FileCheck %s --check-prefix=THIRD \
+// RUN:   --implicit-check-not=ANALYZE
+//
+// Changing the text outside of the function definitions, here a macro, does not
+// reuse anything.
+// RUN: sed -i 's/#define UNUSED 1/#define UNUSED 2/' %t/input.c
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -verify %t/input.c 2>&1 | FileCheck %s --check-prefix=FIRST
+//
+// A different configuration does not reuse anything.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -analyzer-display-progress \
+// RUN:   -analyzer-config incremental-analysis-dir=%t/cache \
+// RUN:   -analyzer-config max-nodes=100000 \
+// RUN:   -verify %t/input.c 2>&1 | FileCheck %s --check-prefix=FIRST
+
+// FIRST-DAG: ANALYZE (Path,  Inline_Regular): {{.*}}input.c unchanged
+// FIRST-DAG: ANALYZE (Path,  Inline_Regular): {{.*}}input.c caller
+// FIRST-DAG: ANALYZE (Path,  Inline_Regular): {{.*}}input.c callsDivide
+
+// SECOND-NOT: ANALYZE
+
+// THIRD-DAG: ANALYZE (Syntax): {{.*}}input.c callee
+// THIRD-DAG: ANALYZE (Path,  Inline_Regular): {{.*}}input.c caller
+
+#define UNUSED 1
+
+void unchanged() {
+  int *p = 0;
+  *p = 1; // expected-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+int callee(int x) {
+  return x + 0;
+}
+
+void caller() {
+  int *p = 0;
+  if (callee(1))
+    *p = 2; // expected-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
+
+// The report is in the inlined function.
+int divide(int x) {
+  return 10 / x; // expected-warning{{Division by zero}}
+}
+
+void callsDivide() {
+  divide(0);
+}
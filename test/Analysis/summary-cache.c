@@ -0,0 +1,54 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config summary-cache-dir=%t -verify=first %s
+// RUN: cat %t/*/*.summaries | FileCheck %s
+//
+// Only the summaries of the previous run on the same translation unit are
+// used.
+// RUN: cp %s %t/other.c
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config summary-cache-dir=%t -verify=first %t/other.c
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config summary-cache-dir=%t -verify=second %s
+//
+// A different analysis budget does not use the summaries of the first one.
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config summary-cache-dir=%t -analyzer-max-loop 3 \
+// RUN:   -verify=first %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core,debug.ExprInspection \
+// RUN:   -analyzer-config summary-cache-dir=%t \
+// RUN:   -analyzer-config max-nodes=100000 -verify=first %s
+
+// CHECK: exhausts-budget {{[0-9A-F]+}} c:@F@spin{{$}}
+// CHECK: returns-nonnull {{[0-9A-F]+}} c:@F@getNonNull{{$}}
+
+// second-no-diagnostics
+
+void clang_analyzer_checkInlined(int);
+
+// Inlining this function exhausts the analysis budget, which is recorded in
+// the summary cache, so the second run does not try to inline it.
+void spin(int n) {
+  clang_analyzer_checkInlined(1); // first-warning{{TRUE}}
+  for (int i = 0; i < n; ++i)
+    ;
+}
+
+void caller(int n) {
+  spin(n);
+}
+
+// Variadic functions are not inlined, so this one is analyzed on its own, and
+// every path returns a non-null pointer. The second run knows this when it
+// evaluates the call.
+int *getNonNull(int n, ...) {
+  static int X;
+  return &X;
+}
+
+int useNonNull() {
+  int *p = getNonNull(0);
+  if (p)
+    return 0;
+  return *p; // first-warning{{Dereference of null pointer (loaded from variable 'p')}}
+}
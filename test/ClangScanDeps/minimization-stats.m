@@ -0,0 +1,30 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: mkdir -p %t.dir/Inputs
+// RUN: cp %s %t.dir/minimization-stats_input.m
+// RUN: cp %S/Inputs/header.h %t.dir/Inputs/header.h
+// RUN: echo '#if 0' > %t.dir/Inputs/fallback.h
+// RUN: echo '#define 1' >> %t.dir/Inputs/fallback.h
+// RUN: echo '#endif' >> %t.dir/Inputs/fallback.h
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/minimization-stats.json > %t.cdb
+//
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 \
+// RUN:   -print-minimization-stats 2>%t.dir/stats | FileCheck %s
+// RUN: FileCheck %s --check-prefix=STATS --input-file %t.dir/stats
+
+#import "header.h"
+#include "fallback.h"
+
+@class A, B; @class C;
+
+#if __has_include(<stdint//nonexistent.h>) || defined(FOO)
+#endif
+
+// CHECK: minimization-stats_input.m
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+// CHECK-NEXT: Inputs{{/|\\}}fallback.h
+
+// STATS: *** Dependency Directive Minimization Stats:
+// STATS-NEXT: 2 files minimized
+// STATS-NEXT: 1 files fell back to their original contents
+// STATS-NEXT: Inputs{{/|\\}}fallback.h: macro name must be an identifier
@@ -0,0 +1,44 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: rm -rf %t.cache
+// RUN: mkdir -p %t.dir
+// RUN: cp %s %t.dir/minimized-source-cache_input.cpp
+// RUN: mkdir %t.dir/Inputs
+// RUN: cp %S/Inputs/header.h %t.dir/Inputs/header.h
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/minimized-source-cache.json > %t.cdb
+//
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 \
+// RUN:   -minimized-source-cache-path %t.cache -print-minimization-stats \
+// RUN:   2>%t.dir/stats1 | FileCheck %s
+// RUN: FileCheck %s --check-prefix=COLD --input-file %t.dir/stats1
+//
+// The second scan reuses the minimized sources of the first one.
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 \
+// RUN:   -minimized-source-cache-path %t.cache -print-minimization-stats \
+// RUN:   2>%t.dir/stats2 | FileCheck %s
+// RUN: FileCheck %s --check-prefix=WARM --input-file %t.dir/stats2
+//
+// A changed file misses the cache.
+// RUN: echo "#define FOO" >> %t.dir/Inputs/header.h
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 1 \
+// RUN:   -minimized-source-cache-path %t.cache -print-minimization-stats \
+// RUN:   2>%t.dir/stats3 | FileCheck %s
+// RUN: FileCheck %s --check-prefix=CHANGED --input-file %t.dir/stats3
+
+#include "header.h"
+
+#if 0
+#define UNUSED_MACRO_THAT_MAKES_THIS_SKIPPED_RANGE_LONG_ENOUGH 1
+#endif
+
+// CHECK: minimized-source-cache_input.cpp
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+
+// COLD: 2 files minimized
+// COLD: 0 minimized files loaded from the on-disk cache
+
+// WARM: 2 files minimized
+// WARM: 2 minimized files loaded from the on-disk cache
+
+// CHANGED: 2 files minimized
+// CHANGED: 1 minimized files loaded from the on-disk cache
@@ -0,0 +1,98 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: rm -rf %t.module-cache
+// RUN: mkdir -p %t.dir
+// RUN: cp %s %t.dir/modules_graph_input.cpp
+// RUN: cp %s %t.dir/modules_graph_input2.cpp
+// RUN: mkdir %t.dir/Inputs
+// RUN: cp %S/Inputs/header.h %t.dir/Inputs/header.h
+// RUN: cp %S/Inputs/header2.h %t.dir/Inputs/header2.h
+// RUN: cp %S/Inputs/module.modulemap %t.dir/Inputs/module.modulemap
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/modules_graph_cdb.json > %t.cdb
+//
+// RUN: echo %t.dir > %t.result
+// RUN: clang-scan-deps -compilation-database %t.cdb -j 2 \
+// RUN:   -format experimental-module-graph -module-files-dir %t.dir/pcms \
+// RUN:   >> %t.result
+// RUN: FileCheck %s --input-file %t.result
+// RUN: FileCheck %s --check-prefix=DEDUP --input-file %t.result
+// RUN: FileCheck %s --check-prefix=CANON --input-file %t.result
+
+// FIXME: Backslash issues.
+// XFAIL: system-windows
+
+#include "header.h"
+
+// CHECK: [[PREFIX:(.*[/\\])+[a-zA-Z0-9.-]+]]
+// CHECK-NEXT: {
+// CHECK-NEXT:   "modules": [
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-module-deps": [
+// CHECK-NEXT:         "header2"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "clang-modulemap-file": "[[PREFIX]]/Inputs/module.modulemap",
+// CHECK-NEXT:       "command-line": [
+// CHECK-NEXT:         "clang",
+// CHECK:              "-fno-implicit-modules",
+// CHECK-NEXT:         "-Xclang",
+// CHECK-NEXT:         "-emit-module",
+// CHECK-NEXT:         "-fmodule-name=header1",
+// CHECK-NEXT:         "-x",
+// CHECK-NEXT:         "c++",
+// CHECK-NEXT:         "-c",
+// CHECK-NEXT:         "[[PREFIX]]/Inputs/module.modulemap",
+// CHECK-NEXT:         "-fmodule-file=[[PREFIX]]/pcms/[[HASH:[A-Z0-9]+]]/header2.pcm",
+// CHECK-NEXT:         "-o",
+// CHECK-NEXT:         "[[PREFIX]]/pcms/[[HASH]]/header1.pcm"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "context-hash": "[[HASH]]",
+// CHECK-NEXT:       "file-deps": [
+// CHECK-NEXT:         "[[PREFIX]]/Inputs/header.h",
+// CHECK-NEXT:         "[[PREFIX]]/Inputs/module.modulemap"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "name": "header1",
+// CHECK-NEXT:       "pcm-path": "[[PREFIX]]/pcms/[[HASH]]/header1.pcm",
+// CHECK-NEXT:       "working-directory": "[[PREFIX]]"
+// CHECK-NEXT:     },
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-module-deps": [],
+// CHECK-NEXT:       "clang-modulemap-file": "[[PREFIX]]/Inputs/module.modulemap",
+// CHECK-NEXT:       "command-line": [
+// CHECK-NEXT:         "clang",
+// CHECK:              "-fmodule-name=header2",
+// CHECK:              "-o",
+// CHECK-NEXT:         "[[PREFIX]]/pcms/[[HASH]]/header2.pcm"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "context-hash": "[[HASH]]",
+// CHECK:            "name": "header2",
+// CHECK:        "translation-units": [
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-context-hash": "[[HASH]]",
+// CHECK-NEXT:       "clang-module-deps": [
+// CHECK-NEXT:         "header1"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "file-deps": [
+// CHECK-NEXT:         "[[PREFIX]]/modules_graph_input.cpp"
+// CHECK-NEXT:       ],
+// CHECK-NEXT:       "input-file": "[[PREFIX]]/modules_graph_input.cpp",
+// CHECK-NEXT:       "module-args": [
+// CHECK-NEXT:         "-fno-implicit-modules",
+// CHECK-NEXT:         "-fmodule-file=[[PREFIX]]/pcms/[[HASH]]/header1.pcm"
+// CHECK-NEXT:       ]
+// CHECK-NEXT:     },
+// CHECK-NEXT:     {
+// CHECK-NEXT:       "clang-context-hash": "[[HASH]]",
+// CHECK:            "input-file": "[[PREFIX]]/modules_graph_input2.cpp",
+
+// Both inputs discover the same modules, which are listed once.
+// DEDUP-COUNT-1: "name": "header1"
+// DEDUP-NOT: "name": "header1"
+
+// The arguments that only concern the translation units are dropped.
+// CANON: "modules": [
+// CANON-NOT: modules_graph_input
+// CANON-NOT: module-cache
+// CANON-NOT: "-fimplicit-modules"
+// CANON-NOT: "-Eonly"
+// CANON-NOT: "-MT"
+// CANON: "translation-units": [
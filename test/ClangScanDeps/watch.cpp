@@ -0,0 +1,36 @@
+// RUN: rm -rf %t.dir
+// RUN: rm -rf %t.cdb
+// RUN: mkdir -p %t.dir
+// RUN: cp %s %t.dir/watch_input1.cpp
+// RUN: cp %s %t.dir/watch_input2.cpp
+// RUN: mkdir %t.dir/Inputs
+// RUN: cp %S/Inputs/header.h %t.dir/Inputs/header.h
+// RUN: cp %S/Inputs/header2.h %t.dir/Inputs/header2.h
+// RUN: sed -e "s|DIR|%/t.dir|g" %S/Inputs/watch.json > %t.cdb
+//
+// Report header2.h as changed, so that only the second input is rescanned and
+// only header2.h has to be minimized again.
+// RUN: printf '%/t.dir/Inputs/header2.h\n\n' | \
+// RUN:   clang-scan-deps -compilation-database %t.cdb -j 1 -watch \
+// RUN:   -print-minimization-stats 2>%t.dir/stats | FileCheck %s
+// RUN: FileCheck %s --check-prefix=STATS --input-file %t.dir/stats
+
+#include "header.h"
+
+// CHECK: watch_input1.cpp
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+// CHECK-NOT: header2.h
+// CHECK: watch_input2.cpp
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+// CHECK-NEXT: Inputs{{/|\\}}header2.h
+// CHECK-NEXT: # end of scan
+// CHECK: watch_input1.cpp
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+// CHECK-NOT: header2.h
+// CHECK: watch_input2.cpp
+// CHECK-NEXT: Inputs{{/|\\}}header.h
+// CHECK-NEXT: Inputs{{/|\\}}header2.h
+// CHECK-NEXT: # end of scan
+
+// STATS: 5 files minimized
+// STATS-NEXT: 0 files fell back to their original contents
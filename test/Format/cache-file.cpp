@@ -0,0 +1,24 @@
+// RUN: rm -f %t.cache
+// RUN: cp %s %t-1.cpp
+// RUN: cp %s %t-2.cpp
+// RUN: clang-format -style=LLVM -i -cache-file=%t.cache %t-1.cpp %t-2.cpp
+// RUN: FileCheck -strict-whitespace -input-file=%t-1.cpp %s
+// RUN: clang-format -style=LLVM -i -verbose -cache-file=%t.cache \
+// RUN:   %t-1.cpp %t-2.cpp 2>&1 | FileCheck -check-prefix=CACHED %s
+// RUN: clang-format -style=Google -n -verbose -cache-file=%t.cache \
+// RUN:   %t-1.cpp 2>&1 | FileCheck -check-prefix=RESTYLED %s
+// RUN: echo "int j;" >> %t-2.cpp
+// RUN: clang-format -style=LLVM -n -verbose -cache-file=%t.cache \
+// RUN:   %t-1.cpp %t-2.cpp 2>&1 | FileCheck -check-prefix=CHANGED %s
+
+// CHECK: {{^int\ \*i;}}
+
+// CACHED: Skipping {{.*}}-1.cpp, it is already formatted
+// CACHED: Skipping {{.*}}-2.cpp, it is already formatted
+
+// RESTYLED-NOT: Skipping
+
+// CHANGED: Skipping {{.*}}-1.cpp, it is already formatted
+// CHANGED: Formatting {{.*}}-2.cpp
+// CHANGED-NOT: Skipping
+ int   *  i  ;
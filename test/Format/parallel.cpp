@@ -0,0 +1,20 @@
+// RUN: cp %s %t-1.cpp
+// RUN: cp %s %t-2.cpp
+// RUN: cp %s %t-3.cpp
+// RUN: clang-format -style=LLVM -j 3 %t-1.cpp %t-2.cpp %t-3.cpp \
+// RUN:   | FileCheck -strict-whitespace %s
+// RUN: clang-format -style=LLVM -j 3 -verbose %t-1.cpp %t-2.cpp %t-3.cpp \
+// RUN:   2>&1 >/dev/null | FileCheck -check-prefix=VERBOSE %s
+// RUN: clang-format -style=LLVM -j 3 -i %t-1.cpp %t-2.cpp %t-3.cpp
+// RUN: FileCheck -strict-whitespace -input-file=%t-1.cpp %s
+// RUN: FileCheck -strict-whitespace -input-file=%t-3.cpp %s
+
+// CHECK: {{^int\ \*i;}}
+// CHECK: {{^int\ \*i;}}
+// CHECK: {{^int\ \*i;}}
+
+// The output doesn't depend on the order in which the files are formatted.
+// VERBOSE: Formatting {{.*}}-1.cpp
+// VERBOSE-NEXT: Formatting {{.*}}-2.cpp
+// VERBOSE-NEXT: Formatting {{.*}}-3.cpp
+ int   *  i  ;
@@ -1,3 +1,9 @@
-// RUN: %clang_cc1 -verify -print-dependency-directives-minimized-source %s 2>&1
+// RUN: %clang_cc1 -print-dependency-directives-minimized-source %s 2>&1 | FileCheck %s
 
-@import x; a // expected-error {{unexpected extra tokens at end of @import declaration}}
+@import x; a
+@class y; @import z; b
+
+// CHECK-NOT: error
+// CHECK:      @import x;
+// CHECK-NEXT: @import z;
+// CHECK-NOT:  {{.}}
@@ -0,0 +1,17 @@
+// Test storing implicitly built module files by AST signature, and building
+// them without lock files.
+// REQUIRES: shell
+@import DependsOnModule;
+
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -Wno-private-module -F %S/Inputs -fmodules-cache-path=%t -fdisable-module-hash -fmodules-hash-content -fmodules-content-addressed-cache -fno-implicit-modules-use-lock %s -verify
+// RUN: ls %t | grep ^Module.*pcm
+// RUN: ls %t | grep ^DependsOnModule.*pcm
+// RUN: ls %t/content | count 2
+
+// Loading the cached module files again must not rebuild or duplicate them:
+// a build would emit a remark, which -verify does not expect.
+// RUN: %clang_cc1 -fmodules -fimplicit-module-maps -Wno-private-module -F %S/Inputs -fmodules-cache-path=%t -fdisable-module-hash -fmodules-hash-content -fmodules-content-addressed-cache -fno-implicit-modules-use-lock -Rmodule-build %s -verify
+// RUN: ls %t/content | count 2
+
+// expected-no-diagnostics
@@ -0,0 +1,17 @@
+// RUN: rm -rf %t
+// Run and create the global module index
+// RUN: %clang_cc1 -fmodules-cache-path=%t -fdisable-module-hash -fmodules -fimplicit-module-maps -F %S/Inputs %s -verify
+// RUN: ls %t|grep modules.idx
+// Run and use the global module index for method pool lookups
+// RUN: %clang_cc1 -fmodules-cache-path=%t -fdisable-module-hash -fmodules -fimplicit-module-maps -F %S/Inputs %s -verify -print-stats 2>&1 | FileCheck %s
+
+// expected-no-diagnostics
+@import DependsOnModule;
+@import Module;
+
+// CHECK: *** Global Module Index Statistics:
+// CHECK: selector lookups succeeded
+
+id allocate(id obj) {
+  return [obj alloc];
+}
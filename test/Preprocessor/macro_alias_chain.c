@@ -0,0 +1,38 @@
+// RUN: %clang_cc1 %s -E | FileCheck %s
+// RUN: %clang_cc1 %s -fsyntax-only -verify -DSEMA
+// Object-like macros that alias other single-token macros are expanded
+// without a TokenLexer; check that this keeps C99 6.10.3.4p2 semantics and
+// the macro expansion history.
+
+#ifndef SEMA
+#define ZERO 0x1234
+#define NONE
+#define ALIAS ZERO
+#define ALIAS2 ALIAS
+#define EMPTY_ALIAS NONE
+#define CYCLE_A CYCLE_B
+#define CYCLE_B CYCLE_A
+#define SELF SELF
+#define SELF_ALIAS SELF
+#define FN(x) x
+#define FN_ALIAS FN
+#define LINE_ALIAS __LINE__
+
+a: ALIAS2 ALIAS ZERO;
+b: EMPTY_ALIAS;
+c: CYCLE_A CYCLE_B;
+d: SELF_ALIAS;
+e: FN_ALIAS(1) FN_ALIAS;
+f: LINE_ALIAS;
+
+// CHECK: a: 0x1234 0x1234 0x1234;
+// CHECK: b: ;
+// CHECK: c: CYCLE_A CYCLE_B;
+// CHECK: d: SELF;
+// CHECK: e: 1 FN;
+// CHECK: f: 26;
+#else
+#define INNER 1.5 // expected-note {{expanded from macro 'INNER'}}
+#define OUTER INNER // expected-note {{expanded from macro 'OUTER'}}
+int array[OUTER]; // expected-error {{size of array has non-integer type 'double'}}
+#endif
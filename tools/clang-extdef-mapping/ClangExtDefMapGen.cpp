@@ -20,6 +20,7 @@
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Signals.h"
 #include <sstream>
 #include <string>
@@ -31,6 +32,21 @@ using namespace clang::tooling;
 
 static cl::OptionCategory ClangExtDefMapGenCategory("clang-extdefmapgen options");
 
+// The binary index is built from a text index rather than from the source
+// files, since the text index usually needs its paths rewritten to point to
+// the AST files first.
+static cl::opt<std::string> TextIndexInput(
+    "from-text-index",
+    cl::desc("Convert the given text index into the binary index given by "
+             "-binary-index instead of processing source files"),
+    cl::value_desc("filename"), cl::cat(ClangExtDefMapGenCategory));
+
+static cl::opt<std::string> BinaryIndexOutput(
+    "binary-index",
+    cl::desc("The binary index file to write the text index given by "
+             "-from-text-index into"),
+    cl::value_desc("filename"), cl::cat(ClangExtDefMapGenCategory));
+
 class MapExtDefNamesConsumer : public ASTConsumer {
 public:
   MapExtDefNamesConsumer(ASTContext &Context)
@@ -109,6 +125,31 @@ protected:
   }
 };
 
+static int convertTextIndex() {
+  llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
+      parseCrossTUIndex(TextIndexInput, "");
+  if (!IndexOrErr) {
+    llvm::errs() << "error: " << llvm::toString(IndexOrErr.takeError())
+                 << '\n';
+    return 1;
+  }
+  llvm::Expected<std::string> BinaryIndexOrErr =
+      createCrossTUBinaryIndex(*IndexOrErr);
+  if (!BinaryIndexOrErr) {
+    llvm::errs() << "error: " << llvm::toString(BinaryIndexOrErr.takeError())
+                 << '\n';
+    return 1;
+  }
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(BinaryIndexOutput, EC, llvm::sys::fs::OF_None);
+  if (EC) {
+    llvm::errs() << "error: could not create file: " << EC.message() << '\n';
+    return 1;
+  }
+  OS << *BinaryIndexOrErr;
+  return 0;
+}
+
 static cl::extrahelp CommonHelp(CommonOptionsParser::HelpMessage);
 
 int main(int argc, const char **argv) {
@@ -122,6 +163,14 @@ int main(int argc, const char **argv) {
   CommonOptionsParser OptionsParser(argc, argv, ClangExtDefMapGenCategory,
                                     cl::ZeroOrMore, Overview);
 
+  if (TextIndexInput.empty() != BinaryIndexOutput.empty()) {
+    llvm::errs() << "error: -from-text-index and -binary-index must be given "
+                    "together\n";
+    return 1;
+  }
+  if (!TextIndexInput.empty())
+    return convertTextIndex();
+
   ClangTool Tool(OptionsParser.getCompilations(),
                  OptionsParser.getSourcePathList());
 
@@ -22,7 +22,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include <map>
+#include <mutex>
 
 using namespace llvm;
 using clang::tooling::Replacements;
@@ -156,6 +162,20 @@ static cl::opt<bool>
                           "whether or not to print diagnostics in color"),
                  cl::init(false), cl::cat(ClangFormatCategory), cl::Hidden);
 
+static cl::opt<unsigned>
+    NumThreads("j",
+               cl::desc("Number of files to format in parallel.\n"
+                        "0 uses all the available cores."),
+               cl::init(1), cl::cat(ClangFormatCategory));
+
+static cl::opt<std::string>
+    CacheFile("cache-file",
+              cl::desc("Remember the files that are formatted correctly in\n"
+                       "this file, and skip them in the next runs as long\n"
+                       "as neither their contents nor their style change.\n"
+                       "Used only with -i or --dry-run."),
+              cl::cat(ClangFormatCategory));
+
 static cl::list<std::string> FileNames(cl::Positional, cl::desc("[<file> ...]"),
                                        cl::cat(ClangFormatCategory));
 
@@ -180,8 +200,8 @@ static bool parseLineRange(StringRef Input, unsigned &FromLine,
          LineRange.second.getAsInteger(0, ToLine);
 }
 
-static bool fillRanges(MemoryBuffer *Code,
-                       std::vector<tooling::Range> &Ranges) {
+static bool fillRanges(MemoryBuffer *Code, std::vector<tooling::Range> &Ranges,
+                       raw_ostream &ErrOS) {
   IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> InMemoryFileSystem(
       new llvm::vfs::InMemoryFileSystem);
   FileManager Files(FileSystemOptions(), InMemoryFileSystem);
@@ -193,18 +213,18 @@ static bool fillRanges(MemoryBuffer *Code,
                                  InMemoryFileSystem.get());
   if (!LineRanges.empty()) {
     if (!Offsets.empty() || !Lengths.empty()) {
-      errs() << "error: cannot use -lines with -offset/-length\n";
+      ErrOS << "error: cannot use -lines with -offset/-length\n";
       return true;
     }
 
     for (unsigned i = 0, e = LineRanges.size(); i < e; ++i) {
       unsigned FromLine, ToLine;
       if (parseLineRange(LineRanges[i], FromLine, ToLine)) {
-        errs() << "error: invalid <start line>:<end line> pair\n";
+        ErrOS << "error: invalid <start line>:<end line> pair\n";
         return true;
       }
       if (FromLine > ToLine) {
-        errs() << "error: start line should be less than end line\n";
+        ErrOS << "error: start line should be less than end line\n";
         return true;
       }
       SourceLocation Start = Sources.translateLineCol(ID, FromLine, 1);
@@ -218,16 +238,18 @@ static bool fillRanges(MemoryBuffer *Code,
     return false;
   }
 
+  // Don't modify Offsets, files may be formatted concurrently.
+  std::vector<unsigned> Offsets(::Offsets.begin(), ::Offsets.end());
   if (Offsets.empty())
     Offsets.push_back(0);
   if (Offsets.size() != Lengths.size() &&
       !(Offsets.size() == 1 && Lengths.empty())) {
-    errs() << "error: number of -offset and -length arguments must match.\n";
+    ErrOS << "error: number of -offset and -length arguments must match.\n";
     return true;
   }
   for (unsigned i = 0, e = Offsets.size(); i != e; ++i) {
     if (Offsets[i] >= Code->getBufferSize()) {
-      errs() << "error: offset " << Offsets[i] << " is outside the file\n";
+      ErrOS << "error: offset " << Offsets[i] << " is outside the file\n";
       return true;
     }
     SourceLocation Start =
@@ -235,9 +257,9 @@ static bool fillRanges(MemoryBuffer *Code,
     SourceLocation End;
     if (i < Lengths.size()) {
       if (Offsets[i] + Lengths[i] > Code->getBufferSize()) {
-        errs() << "error: invalid length " << Lengths[i]
-               << ", offset + length (" << Offsets[i] + Lengths[i]
-               << ") is outside the file.\n";
+        ErrOS << "error: invalid length " << Lengths[i]
+              << ", offset + length (" << Offsets[i] + Lengths[i]
+              << ") is outside the file.\n";
         return true;
       }
       End = Start.getLocWithOffset(Lengths[i]);
@@ -251,47 +273,49 @@ static bool fillRanges(MemoryBuffer *Code,
   return false;
 }
 
-static void outputReplacementXML(StringRef Text) {
+static void outputReplacementXML(StringRef Text, raw_ostream &OS) {
   // FIXME: When we sort includes, we need to make sure the stream is correct
   // utf-8.
   size_t From = 0;
   size_t Index;
   while ((Index = Text.find_first_of("\n\r<&", From)) != StringRef::npos) {
-    outs() << Text.substr(From, Index - From);
+    OS << Text.substr(From, Index - From);
     switch (Text[Index]) {
     case '\n':
-      outs() << "&#10;";
+      OS << "&#10;";
       break;
     case '\r':
-      outs() << "&#13;";
+      OS << "&#13;";
       break;
     case '<':
-      outs() << "&lt;";
+      OS << "&lt;";
       break;
     case '&':
-      outs() << "&amp;";
+      OS << "&amp;";
       break;
     default:
       llvm_unreachable("Unexpected character encountered!");
     }
     From = Index + 1;
   }
-  outs() << Text.substr(From);
+  OS << Text.substr(From);
 }
 
-static void outputReplacementsXML(const Replacements &Replaces) {
+static void outputReplacementsXML(const Replacements &Replaces,
+                                  raw_ostream &OS) {
   for (const auto &R : Replaces) {
-    outs() << "<replacement "
-           << "offset='" << R.getOffset() << "' "
-           << "length='" << R.getLength() << "'>";
-    outputReplacementXML(R.getReplacementText());
-    outs() << "</replacement>\n";
+    OS << "<replacement "
+       << "offset='" << R.getOffset() << "' "
+       << "length='" << R.getLength() << "'>";
+    outputReplacementXML(R.getReplacementText(), OS);
+    OS << "</replacement>\n";
   }
 }
 
 static bool
 emitReplacementWarnings(const Replacements &Replaces, StringRef AssumedFileName,
-                        const std::unique_ptr<llvm::MemoryBuffer> &Code) {
+                        const std::unique_ptr<llvm::MemoryBuffer> &Code,
+                        raw_ostream &ErrOS) {
   if (Replaces.empty())
     return false;
 
@@ -309,7 +333,7 @@ emitReplacementWarnings(const Replacements &Replaces, StringRef AssumedFileName,
                            : SourceMgr::DiagKind::DK_Warning,
           "code should be clang-formatted [-Wclang-format-violations]");
 
-      Diag.print(nullptr, llvm::errs(), (ShowColors && !NoShowColors));
+      Diag.print(nullptr, ErrOS, (ShowColors && !NoShowColors));
       if (ErrorLimit && ++Errors >= ErrorLimit)
         break;
     }
@@ -321,25 +345,140 @@ static void outputXML(const Replacements &Replaces,
                       const Replacements &FormatChanges,
                       const FormattingAttemptStatus &Status,
                       const cl::opt<unsigned> &Cursor,
-                      unsigned CursorPosition) {
-  outs() << "<?xml version='1.0'?>\n<replacements "
-            "xml:space='preserve' incomplete_format='"
-         << (Status.FormatComplete ? "false" : "true") << "'";
+                      unsigned CursorPosition, raw_ostream &OS) {
+  OS << "<?xml version='1.0'?>\n<replacements "
+        "xml:space='preserve' incomplete_format='"
+     << (Status.FormatComplete ? "false" : "true") << "'";
   if (!Status.FormatComplete)
-    outs() << " line='" << Status.Line << "'";
-  outs() << ">\n";
+    OS << " line='" << Status.Line << "'";
+  OS << ">\n";
   if (Cursor.getNumOccurrences() != 0)
-    outs() << "<cursor>" << FormatChanges.getShiftedCodePosition(CursorPosition)
+    OS << "<cursor>" << FormatChanges.getShiftedCodePosition(CursorPosition)
            << "</cursor>\n";
 
-  outputReplacementsXML(Replaces);
-  outs() << "</replacements>\n";
+  outputReplacementsXML(Replaces, OS);
+  OS << "</replacements>\n";
+}
+
+static std::string hashContents(StringRef Contents) {
+  llvm::MD5 Hash;
+  Hash.update(Contents);
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str();
 }
 
+namespace {
+
+// The styles of the formatted files. The style of a file only depends on its
+// directory and language, so the .clang-format files are looked up and parsed
+// once for all the files of a directory written in the same language.
+class StyleCache {
+public:
+  struct Entry {
+    llvm::Optional<FormatStyle> Style;
+    // Set when the style could not be determined.
+    std::string Error;
+    // Identifies the configuration of the style.
+    std::string Hash;
+  };
+
+  Entry get(StringRef FileName, StringRef Code) {
+    auto Key = std::make_pair(llvm::sys::path::parent_path(FileName).str(),
+                              guessLanguage(FileName, Code));
+    {
+      std::lock_guard<std::mutex> LockGuard(Lock);
+      auto It = Entries.find(Key);
+      if (It != Entries.end())
+        return It->second;
+    }
+    Entry NewEntry;
+    llvm::Expected<FormatStyle> FormatStyle =
+        getStyle(Style, FileName, FallbackStyle, Code);
+    if (FormatStyle) {
+      if (SortIncludes.getNumOccurrences() != 0)
+        FormatStyle->SortIncludes = SortIncludes;
+      // Different versions of clang-format may format the same code
+      // differently with the same style.
+      NewEntry.Hash =
+          hashContents(getClangToolFullVersion("clang-format") +
+                       configurationAsText(*FormatStyle));
+      NewEntry.Style = std::move(*FormatStyle);
+    } else {
+      NewEntry.Error = llvm::toString(FormatStyle.takeError());
+    }
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    return Entries.emplace(std::move(Key), std::move(NewEntry)).first->second;
+  }
+
+private:
+  std::mutex Lock;
+  std::map<std::pair<std::string, FormatStyle::LanguageKind>, Entry> Entries;
+};
+
+// Remembers the files that were formatted correctly, identified by the hashes
+// of their contents and of their style, across runs.
+class FormatCache {
+public:
+  void load(StringRef Path) {
+    auto Buffer = MemoryBuffer::getFile(Path);
+    if (!Buffer)
+      return;
+    SmallVector<StringRef, 0> Lines;
+    (*Buffer)->getBuffer().split(Lines, '\n', /*MaxSplit=*/-1,
+                                 /*KeepEmpty=*/false);
+    // Each line holds the hash of the contents, the hash of the style and the
+    // absolute path of a formatted file.
+    for (StringRef Line : Lines) {
+      SmallVector<StringRef, 3> Fields;
+      Line.split(Fields, ' ', /*MaxSplit=*/2);
+      if (Fields.size() == 3)
+        Files[Fields[2]] = {Fields[0], Fields[1]};
+    }
+  }
+
+  bool save(StringRef Path) {
+    std::vector<StringRef> Paths;
+    for (const auto &File : Files)
+      Paths.push_back(File.getKey());
+    llvm::sort(Paths);
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, llvm::sys::fs::OF_Text);
+    if (EC)
+      return false;
+    for (StringRef File : Paths) {
+      const auto &Hashes = Files.find(File)->second;
+      OS << Hashes.first << ' ' << Hashes.second << ' ' << File << '\n';
+    }
+    return true;
+  }
+
+  bool isFormatted(StringRef File, StringRef ContentHash,
+                   StringRef StyleHash) {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    auto It = Files.find(File);
+    return It != Files.end() && It->second.first == ContentHash &&
+           It->second.second == StyleHash;
+  }
+
+  void noteFormatted(StringRef File, StringRef ContentHash,
+                     StringRef StyleHash) {
+    std::lock_guard<std::mutex> LockGuard(Lock);
+    Files[File] = {ContentHash, StyleHash};
+  }
+
+private:
+  std::mutex Lock;
+  llvm::StringMap<std::pair<std::string, std::string>> Files;
+};
+
+} // namespace
+
 // Returns true on error.
-static bool format(StringRef FileName) {
+static bool format(StringRef FileName, raw_ostream &OS, raw_ostream &ErrOS,
+                   StyleCache &Styles, FormatCache *Cache) {
   if (!OutputXML && Inplace && FileName == "-") {
-    errs() << "error: cannot use -i when reading from stdin.\n";
+    ErrOS << "error: cannot use -i when reading from stdin.\n";
     return false;
   }
   // On Windows, overwriting a file with an open file mapping doesn't work,
@@ -348,7 +487,7 @@ static bool format(StringRef FileName) {
       !OutputXML && Inplace ? MemoryBuffer::getFileAsStream(FileName)
                             : MemoryBuffer::getFileOrSTDIN(FileName);
   if (std::error_code EC = CodeOrErr.getError()) {
-    errs() << EC.message() << "\n";
+    ErrOS << EC.message() << "\n";
     return true;
   }
   std::unique_ptr<llvm::MemoryBuffer> Code = std::move(CodeOrErr.get());
@@ -360,38 +499,54 @@ static bool format(StringRef FileName) {
   const char *InvalidBOM = SrcMgr::ContentCache::getInvalidBOM(BufStr);
 
   if (InvalidBOM) {
-    errs() << "error: encoding with unsupported byte order mark \""
-           << InvalidBOM << "\" detected";
+    ErrOS << "error: encoding with unsupported byte order mark \""
+          << InvalidBOM << "\" detected";
     if (FileName != "-")
-      errs() << " in file '" << FileName << "'";
-    errs() << ".\n";
+      ErrOS << " in file '" << FileName << "'";
+    ErrOS << ".\n";
     return true;
   }
 
   std::vector<tooling::Range> Ranges;
-  if (fillRanges(Code.get(), Ranges))
+  if (fillRanges(Code.get(), Ranges, ErrOS))
     return true;
   StringRef AssumedFileName = (FileName == "-") ? AssumeFileName : FileName;
   if (AssumedFileName.empty()) {
-    llvm::errs() << "error: empty filenames are not allowed\n";
+    ErrOS << "error: empty filenames are not allowed\n";
     return true;
   }
 
-  llvm::Expected<FormatStyle> FormatStyle =
-      getStyle(Style, AssumedFileName, FallbackStyle, Code->getBuffer());
-  if (!FormatStyle) {
-    llvm::errs() << llvm::toString(FormatStyle.takeError()) << "\n";
+  StyleCache::Entry StyleEntry = Styles.get(AssumedFileName, Code->getBuffer());
+  if (!StyleEntry.Style) {
+    ErrOS << StyleEntry.Error << "\n";
     return true;
   }
+  Optional<FormatStyle> &FormatStyle = StyleEntry.Style;
+
+  // Only whole files edited in place or checked are cached, the other modes
+  // need the output of clang-format.
+  SmallString<128> CachedFileName;
+  std::string ContentHash;
+  if (Cache && FileName != "-" && (Inplace || DryRun) && !OutputXML &&
+      Offsets.empty() && Lengths.empty() && LineRanges.empty()) {
+    CachedFileName = FileName;
+    llvm::sys::fs::make_absolute(CachedFileName);
+    ContentHash = hashContents(Code->getBuffer());
+    if (Cache->isFormatted(CachedFileName, ContentHash, StyleEntry.Hash)) {
+      if (Verbose)
+        ErrOS << "Skipping " << FileName << ", it is already formatted\n";
+      return false;
+    }
+  } else {
+    Cache = nullptr;
+  }
 
-  if (SortIncludes.getNumOccurrences() != 0)
-    FormatStyle->SortIncludes = SortIncludes;
   unsigned CursorPosition = Cursor;
   Replacements Replaces = sortIncludes(*FormatStyle, Code->getBuffer(), Ranges,
                                        AssumedFileName, &CursorPosition);
   auto ChangedCode = tooling::applyAllReplacements(Code->getBuffer(), Replaces);
   if (!ChangedCode) {
-    llvm::errs() << llvm::toString(ChangedCode.takeError()) << "\n";
+    ErrOS << llvm::toString(ChangedCode.takeError()) << "\n";
     return true;
   }
   // Get new affected ranges after sorting `#includes`.
@@ -400,11 +555,13 @@ static bool format(StringRef FileName) {
   Replacements FormatChanges =
       reformat(*FormatStyle, *ChangedCode, Ranges, AssumedFileName, &Status);
   Replaces = Replaces.merge(FormatChanges);
+  if (Cache && Replaces.empty())
+    Cache->noteFormatted(CachedFileName, ContentHash, StyleEntry.Hash);
   if (OutputXML || DryRun) {
     if (DryRun) {
-      return emitReplacementWarnings(Replaces, AssumedFileName, Code);
+      return emitReplacementWarnings(Replaces, AssumedFileName, Code, ErrOS);
     } else {
-      outputXML(Replaces, FormatChanges, Status, Cursor, CursorPosition);
+      outputXML(Replaces, FormatChanges, Status, Cursor, CursorPosition, OS);
     }
   } else {
     IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> InMemoryFileSystem(
@@ -421,17 +578,26 @@ static bool format(StringRef FileName) {
     if (Inplace) {
       if (Rewrite.overwriteChangedFiles())
         return true;
+      if (Cache && !Replaces.empty()) {
+        auto FormattedCode =
+            tooling::applyAllReplacements(Code->getBuffer(), Replaces);
+        if (FormattedCode)
+          Cache->noteFormatted(CachedFileName, hashContents(*FormattedCode),
+                               StyleEntry.Hash);
+        else
+          llvm::consumeError(FormattedCode.takeError());
+      }
     } else {
       if (Cursor.getNumOccurrences() != 0) {
-        outs() << "{ \"Cursor\": "
-               << FormatChanges.getShiftedCodePosition(CursorPosition)
-               << ", \"IncompleteFormat\": "
-               << (Status.FormatComplete ? "false" : "true");
+        OS << "{ \"Cursor\": "
+           << FormatChanges.getShiftedCodePosition(CursorPosition)
+           << ", \"IncompleteFormat\": "
+           << (Status.FormatComplete ? "false" : "true");
         if (!Status.FormatComplete)
-          outs() << ", \"Line\": " << Status.Line;
-        outs() << " }\n";
+          OS << ", \"Line\": " << Status.Line;
+        OS << " }\n";
       }
-      Rewrite.getEditBuffer(ID).write(outs());
+      Rewrite.getEditBuffer(ID).write(OS);
     }
   }
   return false;
@@ -500,9 +666,11 @@ int main(int argc, const char **argv) {
     return dumpConfig();
   }
 
+  clang::format::StyleCache Styles;
   bool Error = false;
   if (FileNames.empty()) {
-    Error = clang::format::format("-");
+    Error = clang::format::format("-", outs(), errs(), Styles,
+                                  /*Cache=*/nullptr);
     return Error ? 1 : 0;
   }
   if (FileNames.size() != 1 &&
@@ -511,10 +679,55 @@ int main(int argc, const char **argv) {
               "single file.\n";
     return 1;
   }
-  for (const auto &FileName : FileNames) {
-    if (Verbose)
-      errs() << "Formatting " << FileName << "\n";
-    Error |= clang::format::format(FileName);
+
+  std::unique_ptr<clang::format::FormatCache> Cache;
+  if (!CacheFile.empty()) {
+    Cache = std::make_unique<clang::format::FormatCache>();
+    Cache->load(CacheFile);
+  }
+
+  unsigned ThreadCount =
+      NumThreads == 0 ? llvm::hardware_concurrency() : NumThreads;
+  if (ThreadCount == 1 || FileNames.size() == 1) {
+    for (const auto &FileName : FileNames) {
+      if (Verbose)
+        errs() << "Formatting " << FileName << "\n";
+      Error |= clang::format::format(FileName, outs(), errs(), Styles,
+                                     Cache.get());
+    }
+  } else {
+    // The output of every file is buffered and printed in the order of the
+    // files on the command line, so that it doesn't depend on scheduling.
+    struct FileOutput {
+      std::string Out;
+      std::string Err;
+      bool Error = false;
+    };
+    std::vector<FileOutput> Outputs(FileNames.size());
+    {
+      llvm::ThreadPool Pool(ThreadCount);
+      for (size_t I = 0, E = FileNames.size(); I != E; ++I) {
+        Pool.async([&, I]() {
+          FileOutput &Output = Outputs[I];
+          raw_string_ostream OS(Output.Out), ErrOS(Output.Err);
+          if (Verbose)
+            ErrOS << "Formatting " << FileNames[I] << "\n";
+          Output.Error = clang::format::format(FileNames[I], OS, ErrOS, Styles,
+                                               Cache.get());
+        });
+      }
+      Pool.wait();
+    }
+    for (const FileOutput &Output : Outputs) {
+      errs() << Output.Err;
+      outs() << Output.Out;
+      Error |= Output.Error;
+    }
+  }
+
+  if (Cache && !Cache->save(CacheFile)) {
+    errs() << "error: cannot write the cache file " << CacheFile << "\n";
+    Error = true;
   }
   return Error ? 1 : 0;
 }
@@ -6,19 +6,25 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "clang/DirectoryWatcher/DirectoryWatcher.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Tooling/CommonOptionsParser.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningService.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningTool.h"
 #include "clang/Tooling/DependencyScanning/DependencyScanningWorker.h"
 #include "clang/Tooling/JSONCompilationDatabase.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/Threading.h"
 #include <mutex>
+#include <numeric>
 #include <thread>
 
 using namespace clang;
@@ -125,10 +131,22 @@ static llvm::cl::opt<ScanningOutputFormat> Format(
                      clEnumValN(ScanningOutputFormat::Full, "experimental-full",
                                 "Full dependency graph suitable"
                                 " for explicitly building modules. This format "
-                                "is experimental and will change.")),
+                                "is experimental and will change."),
+                     clEnumValN(ScanningOutputFormat::ModuleGraph,
+                                "experimental-module-graph",
+                                "A single module graph for all the inputs, "
+                                "with deduplicated modules and the command "
+                                "lines that build them. This format is "
+                                "experimental and will change.")),
     llvm::cl::init(ScanningOutputFormat::Make),
     llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<std::string> ModuleFilesDir(
+    "module-files-dir",
+    llvm::cl::desc("The directory in which the module graph places the module "
+                   "files, in a subdirectory per context hash."),
+    llvm::cl::init("modules"), llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<unsigned>
     NumThreads("j", llvm::cl::Optional,
                llvm::cl::desc("Number of worker threads to use (default: use "
@@ -153,6 +171,29 @@ llvm::cl::opt<bool> SkipExcludedPPRanges(
         "until reaching the end directive."),
     llvm::cl::init(true), llvm::cl::cat(DependencyScannerCategory));
 
+llvm::cl::opt<std::string> MinimizedSourceCachePath(
+    "minimized-source-cache-path",
+    llvm::cl::desc("Cache the minimized sources in the given directory, so "
+                   "that later scans can reuse them. The directory can be "
+                   "shared by concurrent scans."),
+    llvm::cl::cat(DependencyScannerCategory));
+
+llvm::cl::opt<bool> PrintMinimizationStats(
+    "print-minimization-stats",
+    llvm::cl::desc("Print how many files were minimized and which files fell "
+                   "back to their original contents, to stderr."),
+    llvm::cl::init(false), llvm::cl::cat(DependencyScannerCategory));
+
+llvm::cl::opt<bool> Watch(
+    "watch",
+    llvm::cl::desc(
+        "Keep running after the initial scan and keep the scanning caches "
+        "alive. Every line read from stdin names a file that changed, in "
+        "addition to the changes observed by watching the directories of all "
+        "the dependencies. An empty line rescans the files that are affected "
+        "by a change and prints the results for all the files again."),
+    llvm::cl::init(false), llvm::cl::cat(DependencyScannerCategory));
+
 llvm::cl::opt<bool> Verbose("v", llvm::cl::Optional,
                             llvm::cl::desc("Use verbose output."),
                             llvm::cl::init(false),
@@ -206,6 +247,353 @@ static bool handleDependencyToolResult(const std::string &Input,
   return false;
 }
 
+/// Reads the next line of the standard input into \p Line, without the
+/// newline, as soon as it's available.
+///
+/// \returns False at the end of the input.
+static bool readLineFromStdin(std::string &Line) {
+  static std::string Pending;
+  for (;;) {
+    size_t Newline = Pending.find('\n');
+    if (Newline != std::string::npos) {
+      Line = Pending.substr(0, Newline);
+      Pending.erase(0, Newline + 1);
+      return true;
+    }
+    char Buffer[4096];
+    llvm::Expected<size_t> BytesRead = llvm::sys::fs::readNativeFile(
+        llvm::sys::fs::convertFDToNativeFile(0), Buffer);
+    if (!BytesRead) {
+      llvm::consumeError(BytesRead.takeError());
+      BytesRead = 0;
+    }
+    if (*BytesRead == 0) {
+      // The last line may lack a newline.
+      if (Pending.empty())
+        return false;
+      Line = std::move(Pending);
+      Pending.clear();
+      return true;
+    }
+    Pending.append(Buffer, *BytesRead);
+  }
+}
+
+/// \returns \p Path made absolute against \p CWD, or against the current
+/// directory if \p CWD is empty, with the "." and ".." components removed.
+static std::string normalizePath(StringRef Path, StringRef CWD) {
+  SmallString<256> Normalized(Path);
+  if (CWD.empty())
+    llvm::sys::fs::make_absolute(Normalized);
+  else
+    llvm::sys::fs::make_absolute(CWD, Normalized);
+  llvm::sys::path::remove_dots(Normalized, /*remove_dot_dot=*/true);
+  return Normalized.str();
+}
+
+namespace {
+
+/// The result of scanning one input that a long-lived scanning service keeps
+/// between scans.
+struct ScanResult {
+  bool Failed = false;
+  /// The dependency file, or the error output if the scan failed.
+  std::string Output;
+  /// The normalized paths of the files the input depends on.
+  std::vector<std::string> FileDeps;
+};
+
+/// Keeps the dependency scanning service alive between scans and tracks the
+/// files that changed in the meantime, either as reported by the client or as
+/// observed by watching the directories of all the dependencies.
+///
+/// Only the inputs that depend on a changed file, or that failed to scan, are
+/// scanned again; every other input reuses its previous result as well as the
+/// minimized files in the shared cache. Lookups that failed, or that found a
+/// directory, are checked again before every scan. If one of them changed,
+/// every input is scanned again.
+class IncrementalScanner {
+public:
+  IncrementalScanner(DependencyScanningFilesystemSharedCache &SharedCache,
+                     std::vector<ScanResult> &Results)
+      : SharedCache(SharedCache), Results(Results) {}
+
+  void noteChangedFile(StringRef Path) {
+    std::unique_lock<std::mutex> LockGuard(ChangesLock);
+    ChangedFiles.insert(Path);
+  }
+
+  /// Starts watching the directories of the dependencies that aren't watched
+  /// yet.
+  void watchDependencies() {
+    for (const ScanResult &Result : Results) {
+      for (const std::string &Dep : Result.FileDeps) {
+        StringRef Dir = llvm::sys::path::parent_path(Dep);
+        if (Dir.empty() || Watchers.count(Dir))
+          continue;
+        std::unique_ptr<DirectoryWatcher> &Watcher = Watchers[Dir];
+        if (!llvm::sys::fs::is_directory(Dir))
+          continue;
+        std::string DirPath = Dir;
+        auto MaybeWatcher = DirectoryWatcher::create(
+            Dir,
+            [this, DirPath](ArrayRef<DirectoryWatcher::Event> Events,
+                            bool IsInitial) {
+              if (!IsInitial)
+                handleEvents(DirPath, Events);
+            },
+            /*WaitForInitialSync=*/false);
+        // Without a watcher, changes in this directory are only picked up
+        // when the client reports them.
+        if (!MaybeWatcher) {
+          llvm::consumeError(MaybeWatcher.takeError());
+          continue;
+        }
+        Watcher = std::move(*MaybeWatcher);
+      }
+    }
+  }
+
+  /// Invalidates the changed files in the shared cache.
+  ///
+  /// \returns The indices of the inputs that have to be scanned again.
+  std::vector<size_t> invalidateChangedFiles() {
+    bool ShouldRescanAll;
+    {
+      std::unique_lock<std::mutex> LockGuard(ChangesLock);
+      ShouldRescanAll = RescanAll;
+    }
+    // A watcher that lost track of its directory can't be trusted anymore.
+    // Destroying them invalidates them too, so reset the flag afterwards.
+    if (ShouldRescanAll)
+      Watchers.clear();
+
+    llvm::StringSet<> Changed;
+    {
+      std::unique_lock<std::mutex> LockGuard(ChangesLock);
+      std::swap(Changed, ChangedFiles);
+      RescanAll = false;
+    }
+
+    // Failed lookups and directories aren't dependencies of any input, and
+    // their directories aren't necessarily watched, so check them again. A
+    // file that appeared may shadow a dependency or change the result of
+    // __has_include, and there's no telling which inputs looked it up.
+    bool LookupChanged = false;
+    SharedCache.invalidate([&](StringRef Key,
+                               const CachedFileSystemEntry &Entry) {
+      if (ShouldRescanAll || Changed.count(normalizePath(Key, "")))
+        return true;
+      llvm::ErrorOr<llvm::vfs::Status> Cached = Entry.getStatus();
+      if ((Cached && !Cached->isDirectory()) ||
+          !llvm::sys::path::is_absolute(Key))
+        return false;
+      llvm::sys::fs::file_status Current;
+      if (llvm::sys::fs::status(Key, Current)) {
+        if (!Cached)
+          return false;
+        LookupChanged = true;
+        return true;
+      }
+      // A file was added to or removed from the directory. The lookups of
+      // such files are checked on their own, so only refresh the entry.
+      if (Cached && llvm::sys::fs::is_directory(Current))
+        return Current.getLastModificationTime() !=
+               Cached->getLastModificationTime();
+      LookupChanged = true;
+      return true;
+    });
+
+    std::vector<size_t> Indices;
+    for (size_t I = 0, E = Results.size(); I != E; ++I) {
+      const ScanResult &Result = Results[I];
+      if (ShouldRescanAll || LookupChanged || Result.Failed ||
+          llvm::any_of(Result.FileDeps, [&](const std::string &Dep) {
+            return Changed.count(Dep);
+          }))
+        Indices.push_back(I);
+    }
+    return Indices;
+  }
+
+  /// Prints the results of all the inputs in the order of the compilation
+  /// database, followed by a line that marks the end of the scan.
+  void printResults(SharedStream &OS, SharedStream &Errs) {
+    for (const ScanResult &Result : Results)
+      (Result.Failed ? Errs : OS).applyLocked(
+          [&](raw_ostream &OS) { OS << Result.Output; });
+    OS.applyLocked([](raw_ostream &OS) { OS << "# end of scan\n"; });
+  }
+
+private:
+  void handleEvents(StringRef Dir, ArrayRef<DirectoryWatcher::Event> Events) {
+    std::unique_lock<std::mutex> LockGuard(ChangesLock);
+    for (const DirectoryWatcher::Event &Event : Events) {
+      switch (Event.Kind) {
+      case DirectoryWatcher::Event::EventKind::Removed:
+      case DirectoryWatcher::Event::EventKind::Modified: {
+        SmallString<256> Path(Dir);
+        llvm::sys::path::append(Path, Event.Filename);
+        ChangedFiles.insert(Path);
+        break;
+      }
+      case DirectoryWatcher::Event::EventKind::WatchedDirRemoved:
+      case DirectoryWatcher::Event::EventKind::WatcherGotInvalidated:
+        RescanAll = true;
+        break;
+      }
+    }
+  }
+
+  DependencyScanningFilesystemSharedCache &SharedCache;
+  std::vector<ScanResult> &Results;
+
+  std::mutex ChangesLock;
+  llvm::StringSet<> ChangedFiles;
+  bool RescanAll = false;
+  /// The watchers of the directories that contain the dependencies, or null
+  /// if the directory couldn't be watched.
+  llvm::StringMap<std::unique_ptr<DirectoryWatcher>> Watchers;
+};
+
+} // end anonymous namespace
+
+namespace {
+
+/// Merges the full dependencies of all the inputs into a single module graph,
+/// in which a module that is discovered by several inputs with the same
+/// context hash appears once.
+class ModuleGraph {
+public:
+  void mergeDeps(size_t InputIndex, StringRef Input, StringRef CWD,
+                 FullDependencies Deps) {
+    std::unique_lock<std::mutex> LockGuard(Lock);
+    for (ModuleDeps &MD : Deps.DiscoveredModules) {
+      auto It = Modules.emplace(
+          std::make_pair(MD.ContextHash, MD.ModuleName), ModuleEntry());
+      ModuleEntry &Entry = It.first->second;
+      // Keep the module as discovered by the first input in the compilation
+      // database, so that the output doesn't depend on the scheduling.
+      if (!It.second && Entry.InputIndex < InputIndex)
+        continue;
+      Entry.InputIndex = InputIndex;
+      Entry.WorkingDirectory = CWD;
+      Entry.MD = std::move(MD);
+    }
+    Deps.DiscoveredModules.clear();
+    Inputs.push_back({InputIndex, Input, std::move(Deps)});
+  }
+
+  void printGraph(raw_ostream &OS) {
+    using namespace llvm::json;
+    std::unique_lock<std::mutex> LockGuard(Lock);
+
+    Array OutModules;
+    for (auto &&M : Modules) {
+      const ModuleDeps &MD = M.second.MD;
+      auto LookupPCMPath = [&](StringRef ModuleName) {
+        return getPCMPath(MD.ContextHash, ModuleName);
+      };
+      OutModules.push_back(Object{
+          {"name", MD.ModuleName},
+          {"context-hash", MD.ContextHash},
+          {"clang-modulemap-file", MD.ClangModuleMapFile},
+          {"clang-module-deps", toJSONSorted(MD.ClangModuleDeps)},
+          {"file-deps", toJSONSorted(MD.FileDeps)},
+          {"pcm-path", getPCMPath(MD.ContextHash, MD.ModuleName)},
+          {"working-directory", M.second.WorkingDirectory},
+          {"command-line", MD.getFullCommandLine(LookupPCMPath)},
+      });
+    }
+
+    llvm::sort(Inputs, [](const InputEntry &LHS, const InputEntry &RHS) {
+      return LHS.InputIndex < RHS.InputIndex;
+    });
+    Array OutInputs;
+    for (const InputEntry &I : Inputs) {
+      // The arguments to add to the command line of the input to build it
+      // with the explicitly built modules.
+      Array ModuleArgs{"-fno-implicit-modules"};
+      for (const std::string &Dep : I.Deps.ClangModuleDeps)
+        ModuleArgs.push_back("-fmodule-file=" +
+                             getPCMPath(I.Deps.ContextHash, Dep));
+      OutInputs.push_back(Object{
+          {"input-file", I.Input},
+          {"clang-context-hash", I.Deps.ContextHash},
+          {"clang-module-deps", I.Deps.ClangModuleDeps},
+          {"file-deps", I.Deps.FileDeps},
+          {"module-args", std::move(ModuleArgs)},
+      });
+    }
+
+    Object Graph{
+        {"modules", std::move(OutModules)},
+        {"translation-units", std::move(OutInputs)},
+    };
+    OS << llvm::formatv("{0:2}\n", Value(std::move(Graph)));
+  }
+
+private:
+  struct ModuleEntry {
+    size_t InputIndex = 0;
+    std::string WorkingDirectory;
+    ModuleDeps MD;
+  };
+
+  struct InputEntry {
+    size_t InputIndex;
+    std::string Input;
+    FullDependencies Deps;
+  };
+
+  static llvm::json::Array toJSONSorted(const llvm::StringSet<> &Set) {
+    std::vector<StringRef> Strings;
+    for (auto &&I : Set)
+      Strings.push_back(I.getKey());
+    llvm::sort(Strings);
+    return llvm::json::Array(Strings);
+  }
+
+  std::string getPCMPath(StringRef ContextHash, StringRef ModuleName) const {
+    SmallString<256> Path(ModuleFilesDir);
+    llvm::sys::path::append(Path, ContextHash, ModuleName + ".pcm");
+    return Path.str();
+  }
+
+  std::mutex Lock;
+  /// The modules, sorted by context hash and name.
+  std::map<std::pair<std::string, std::string>, ModuleEntry> Modules;
+  std::vector<InputEntry> Inputs;
+};
+
+} // end anonymous namespace
+
+/// Records the result of a dependency scan for a long-lived scanning service.
+///
+/// \returns True on error.
+static bool recordDependencyToolResult(const std::string &Input,
+                                       StringRef CWD,
+                                       llvm::Expected<std::string> &MaybeFile,
+                                       ArrayRef<std::string> FileDeps,
+                                       ScanResult &Result) {
+  Result = ScanResult();
+  if (!MaybeFile) {
+    Result.Failed = true;
+    llvm::raw_string_ostream OS(Result.Output);
+    llvm::handleAllErrors(
+        MaybeFile.takeError(), [&Input, &OS](llvm::StringError &Err) {
+          OS << "Error while scanning dependencies for " << Input << ":\n";
+          OS << Err.getMessage();
+        });
+    return true;
+  }
+  Result.Output = std::move(*MaybeFile);
+  Result.FileDeps.push_back(normalizePath(Input, CWD));
+  for (const std::string &Dep : FileDeps)
+    Result.FileDeps.push_back(normalizePath(Dep, CWD));
+  return false;
+}
+
 int main(int argc, const char **argv) {
   llvm::InitLLVM X(argc, argv);
   llvm::cl::HideUnrelatedOptions(DependencyScannerCategory);
@@ -299,6 +687,8 @@ int main(int argc, const char **argv) {
 
   DependencyScanningService Service(ScanMode, Format, ReuseFileManager,
                                     SkipExcludedPPRanges);
+  if (!MinimizedSourceCachePath.empty())
+    Service.getSharedCache().setDiskCachePath(MinimizedSourceCachePath);
 #if LLVM_ENABLE_THREADS
   unsigned NumWorkers =
       NumThreads == 0 ? llvm::hardware_concurrency() : NumThreads;
@@ -314,47 +704,112 @@ int main(int argc, const char **argv) {
        AdjustingCompilations->getAllCompileCommands())
     Inputs.emplace_back(Cmd);
 
-  std::vector<std::thread> WorkerThreads;
-  std::atomic<bool> HadErrors(false);
-  std::mutex Lock;
-  size_t Index = 0;
-
   if (Verbose) {
     llvm::outs() << "Running clang-scan-deps on " << Inputs.size()
                  << " files using " << NumWorkers << " workers\n";
   }
-  for (unsigned I = 0; I < NumWorkers; ++I) {
-    auto Worker = [I, &Lock, &Index, &Inputs, &HadErrors, &WorkerTools,
-                   &DependencyOS, &Errs]() {
-      while (true) {
-        const SingleCommandCompilationDatabase *Input;
-        std::string Filename;
-        std::string CWD;
-        // Take the next input.
-        {
-          std::unique_lock<std::mutex> LockGuard(Lock);
-          if (Index >= Inputs.size())
-            return;
-          Input = &Inputs[Index++];
-          tooling::CompileCommand Cmd = Input->getAllCompileCommands()[0];
-          Filename = std::move(Cmd.Filename);
-          CWD = std::move(Cmd.Directory);
+
+  if (Watch && Format == ScanningOutputFormat::ModuleGraph) {
+    llvm::errs() << "error: -watch doesn't support the module graph format\n";
+    return 1;
+  }
+
+  std::atomic<bool> HadErrors(false);
+  ModuleGraph Graph;
+  // In watch mode the results are kept, so that the inputs that weren't
+  // affected by a change don't have to be scanned again.
+  std::vector<ScanResult> Results(Watch ? Inputs.size() : 0);
+
+  // Scans the inputs at the given indices using all of the workers.
+  auto ScanInputs = [&](ArrayRef<size_t> Indices) {
+    std::vector<std::thread> WorkerThreads;
+    std::mutex Lock;
+    size_t Index = 0;
+    for (unsigned I = 0; I < NumWorkers; ++I) {
+      auto Worker = [I, &Lock, &Index, &Indices, &Inputs, &Results, &Graph,
+                     &HadErrors, &WorkerTools, &DependencyOS, &Errs]() {
+        while (true) {
+          const SingleCommandCompilationDatabase *Input;
+          size_t InputIndex;
+          std::string Filename;
+          std::string CWD;
+          // Take the next input.
+          {
+            std::unique_lock<std::mutex> LockGuard(Lock);
+            if (Index >= Indices.size())
+              return;
+            InputIndex = Indices[Index++];
+            Input = &Inputs[InputIndex];
+            tooling::CompileCommand Cmd = Input->getAllCompileCommands()[0];
+            Filename = std::move(Cmd.Filename);
+            CWD = std::move(Cmd.Directory);
+          }
+          // Run the tool on it.
+          if (Format == ScanningOutputFormat::ModuleGraph) {
+            auto MaybeDeps = WorkerTools[I]->getFullDependencies(*Input, CWD);
+            if (!MaybeDeps) {
+              llvm::Expected<std::string> MaybeFile = MaybeDeps.takeError();
+              handleDependencyToolResult(Filename, MaybeFile, DependencyOS,
+                                         Errs);
+              HadErrors = true;
+              continue;
+            }
+            Graph.mergeDeps(InputIndex, Filename, CWD, std::move(*MaybeDeps));
+            continue;
+          }
+          if (!Watch) {
+            auto MaybeFile = WorkerTools[I]->getDependencyFile(*Input, CWD);
+            if (handleDependencyToolResult(Filename, MaybeFile, DependencyOS,
+                                           Errs))
+              HadErrors = true;
+            continue;
+          }
+          std::vector<std::string> FileDeps;
+          auto MaybeFile =
+              WorkerTools[I]->getDependencyFile(*Input, CWD, &FileDeps);
+          if (recordDependencyToolResult(Filename, CWD, MaybeFile, FileDeps,
+                                         Results[InputIndex]))
+            HadErrors = true;
         }
-        // Run the tool on it.
-        auto MaybeFile = WorkerTools[I]->getDependencyFile(*Input, CWD);
-        if (handleDependencyToolResult(Filename, MaybeFile, DependencyOS, Errs))
-          HadErrors = true;
-      }
-    };
+      };
 #if LLVM_ENABLE_THREADS
-    WorkerThreads.emplace_back(std::move(Worker));
+      WorkerThreads.emplace_back(std::move(Worker));
 #else
-    // Run the worker without spawning a thread when threads are disabled.
-    Worker();
+      // Run the worker without spawning a thread when threads are disabled.
+      Worker();
 #endif
+    }
+    for (auto &W : WorkerThreads)
+      W.join();
+  };
+
+  std::vector<size_t> AllInputs(Inputs.size());
+  std::iota(AllInputs.begin(), AllInputs.end(), 0);
+  ScanInputs(AllInputs);
+  if (Format == ScanningOutputFormat::ModuleGraph)
+    DependencyOS.applyLocked([&](raw_ostream &OS) { Graph.printGraph(OS); });
+
+  if (Watch) {
+    IncrementalScanner Scanner(Service.getSharedCache(), Results);
+    Scanner.watchDependencies();
+    Scanner.printResults(DependencyOS, Errs);
+    // Every line names a file that changed, an empty line asks for a rescan.
+    std::string Line;
+    while (readLineFromStdin(Line)) {
+      StringRef ChangedFile = StringRef(Line).trim();
+      if (!ChangedFile.empty()) {
+        Scanner.noteChangedFile(normalizePath(ChangedFile, ""));
+        continue;
+      }
+      HadErrors = false;
+      ScanInputs(Scanner.invalidateChangedFiles());
+      Scanner.watchDependencies();
+      Scanner.printResults(DependencyOS, Errs);
+    }
   }
-  for (auto &W : WorkerThreads)
-    W.join();
+
+  if (PrintMinimizationStats)
+    Service.getSharedCache().printMinimizationStats(llvm::errs());
 
   return HadErrors;
 }
@@ -50,6 +50,7 @@
 #include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -3693,6 +3694,60 @@ enum CXErrorCode clang_parseTranslationUnit2FullArgv(
   return result;
 }
 
+enum CXErrorCode clang_parseTranslationUnitBatch(
+    CXIndex CIdx, const CXTranslationUnitBatchEntry *entries,
+    unsigned num_entries, unsigned num_threads,
+    CXTranslationUnitBatchCallback callback, CXClientData client_data) {
+  LOG_FUNC_SECTION {
+    *Log << num_entries << " entries";
+  }
+
+  if (!CIdx || (num_entries && !entries) || !callback)
+    return CXError_InvalidArguments;
+  for (unsigned I = 0; I != num_entries; ++I) {
+    const CXTranslationUnitBatchEntry &Entry = entries[I];
+    if (Entry.num_unsaved_files && !Entry.unsaved_files)
+      return CXError_InvalidArguments;
+    if (Entry.translation_unit && isNotUsableTU(Entry.translation_unit))
+      return CXError_InvalidArguments;
+  }
+
+  // Computed lazily and cached without synchronization, so do it up front.
+  static_cast<CIndexer *>(CIdx)->getClangResourcesPath();
+
+  std::mutex CallbackMutex;
+  auto Process = [&](unsigned I) {
+    const CXTranslationUnitBatchEntry &Entry = entries[I];
+    CXTranslationUnit TU = Entry.translation_unit;
+    CXErrorCode Result;
+    if (TU) {
+      Result = static_cast<CXErrorCode>(clang_reparseTranslationUnit(
+          TU, Entry.num_unsaved_files, Entry.unsaved_files, Entry.options));
+    } else {
+      Result = clang_parseTranslationUnit2FullArgv(
+          CIdx, Entry.source_filename, Entry.command_line_args,
+          Entry.num_command_line_args, Entry.unsaved_files,
+          Entry.num_unsaved_files, Entry.options, &TU);
+    }
+    std::lock_guard<std::mutex> Lock(CallbackMutex);
+    callback(client_data, I, TU, Result);
+  };
+
+  unsigned ThreadCount =
+      num_threads == 0 ? llvm::hardware_concurrency() : num_threads;
+  if (ThreadCount == 1 || num_entries <= 1) {
+    for (unsigned I = 0; I != num_entries; ++I)
+      Process(I);
+    return CXError_Success;
+  }
+
+  llvm::ThreadPool Pool(std::min(ThreadCount, num_entries));
+  for (unsigned I = 0; I != num_entries; ++I)
+    Pool.async(Process, I);
+  Pool.wait();
+  return CXError_Success;
+}
+
 CXString clang_Type_getObjCEncoding(CXType CT) {
   CXTranslationUnit tu = static_cast<CXTranslationUnit>(CT.data[1]);
   ASTContext &Ctx = getASTUnit(tu)->getASTContext();
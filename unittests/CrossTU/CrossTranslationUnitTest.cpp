@@ -24,8 +24,9 @@ namespace {
 
 class CTUASTConsumer : public clang::ASTConsumer {
 public:
-  explicit CTUASTConsumer(clang::CompilerInstance &CI, bool *Success)
-      : CTU(CI), Success(Success) {}
+  explicit CTUASTConsumer(clang::CompilerInstance &CI, bool *Success,
+                          bool BinaryIndex)
+      : CTU(CI), Success(Success), BinaryIndex(BinaryIndex) {}
 
   void HandleTranslationUnit(ASTContext &Ctx) {
     auto FindFInTU = [](const TranslationUnitDecl *TU) {
@@ -55,7 +56,15 @@ public:
     ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("index", "txt", IndexFD,
                                                     IndexFileName));
     llvm::ToolOutputFile IndexFile(IndexFileName, IndexFD);
-    IndexFile.os() << "c:@F@f#I# " << ASTFileName << "\n";
+    if (BinaryIndex) {
+      llvm::StringMap<std::string> Index;
+      Index["c:@F@f#I#"] = ASTFileName.str().str();
+      llvm::Expected<std::string> IndexData = createCrossTUBinaryIndex(Index);
+      ASSERT_TRUE((bool)IndexData);
+      IndexFile.os() << *IndexData;
+    } else {
+      IndexFile.os() << "c:@F@f#I# " << ASTFileName << "\n";
+    }
     IndexFile.os().flush();
     EXPECT_TRUE(llvm::sys::fs::exists(IndexFileName));
 
@@ -111,23 +120,26 @@ public:
 private:
   CrossTranslationUnitContext CTU;
   bool *Success;
+  bool BinaryIndex;
 };
 
 class CTUAction : public clang::ASTFrontendAction {
 public:
-  CTUAction(bool *Success, unsigned OverrideLimit)
-      : Success(Success), OverrideLimit(OverrideLimit) {}
+  CTUAction(bool *Success, unsigned OverrideLimit, bool BinaryIndex = false)
+      : Success(Success), OverrideLimit(OverrideLimit),
+        BinaryIndex(BinaryIndex) {}
 
 protected:
   std::unique_ptr<clang::ASTConsumer>
   CreateASTConsumer(clang::CompilerInstance &CI, StringRef) override {
     CI.getAnalyzerOpts()->CTUImportThreshold = OverrideLimit;
-    return std::make_unique<CTUASTConsumer>(CI, Success);
+    return std::make_unique<CTUASTConsumer>(CI, Success, BinaryIndex);
   }
 
 private:
   bool *Success;
   const unsigned OverrideLimit;
+  const bool BinaryIndex;
 };
 
 } // end namespace
@@ -139,6 +151,14 @@ TEST(CrossTranslationUnit, CanLoadFunctionDefinition) {
   EXPECT_TRUE(Success);
 }
 
+TEST(CrossTranslationUnit, CanLoadFunctionDefinitionWithBinaryIndex) {
+  bool Success = false;
+  EXPECT_TRUE(tooling::runToolOnCode(
+      std::make_unique<CTUAction>(&Success, 1u, /*BinaryIndex=*/true),
+      "int f(int);"));
+  EXPECT_TRUE(Success);
+}
+
 TEST(CrossTranslationUnit, RespectsLoadThreshold) {
   bool Success = false;
   EXPECT_TRUE(tooling::runToolOnCode(std::make_unique<CTUAction>(&Success, 0u),
@@ -193,5 +213,59 @@ TEST(CrossTranslationUnit, CTUDirIsHandledCorrectly) {
   EXPECT_EQ(ParsedIndex["a"], "/ctudir/b/c/d");
 }
 
+TEST(CrossTranslationUnit, BinaryIndexFormatCanBeParsed) {
+  llvm::StringMap<std::string> Index;
+  Index["e"] = "f/f3";
+  Index["a"] = "b/f1";
+  Index["c"] = "d/f2";
+  llvm::Expected<std::string> BinaryIndexOrErr =
+      createCrossTUBinaryIndex(Index);
+  ASSERT_TRUE((bool)BinaryIndexOrErr);
+  std::string IndexData = std::move(*BinaryIndexOrErr);
+  EXPECT_TRUE(isCrossTUBinaryIndex(IndexData));
+  EXPECT_FALSE(isCrossTUBinaryIndex(createCrossTUIndexString(Index)));
+
+  for (const auto &E : Index) {
+    llvm::Expected<llvm::Optional<StringRef>> FileOrErr =
+        lookupCrossTUBinaryIndex(IndexData, E.getKey(), "index");
+    ASSERT_TRUE((bool)FileOrErr);
+    ASSERT_TRUE(FileOrErr->hasValue());
+    EXPECT_EQ(**FileOrErr, E.getValue());
+  }
+  llvm::Expected<llvm::Optional<StringRef>> MissingOrErr =
+      lookupCrossTUBinaryIndex(IndexData, "b", "index");
+  ASSERT_TRUE((bool)MissingOrErr);
+  EXPECT_FALSE(MissingOrErr->hasValue());
+
+  int IndexFD;
+  llvm::SmallString<256> IndexFileName;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("index", "bin", IndexFD,
+                                                  IndexFileName));
+  llvm::ToolOutputFile IndexFile(IndexFileName, IndexFD);
+  IndexFile.os() << IndexData;
+  IndexFile.os().flush();
+  EXPECT_TRUE(llvm::sys::fs::exists(IndexFileName));
+  llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
+      parseCrossTUIndex(IndexFileName, "/ctudir");
+  EXPECT_TRUE((bool)IndexOrErr);
+  llvm::StringMap<std::string> ParsedIndex = IndexOrErr.get();
+  EXPECT_EQ(ParsedIndex.size(), Index.size());
+  EXPECT_EQ(ParsedIndex["a"], "/ctudir/b/f1");
+  EXPECT_EQ(ParsedIndex["e"], "/ctudir/f/f3");
+}
+
+TEST(CrossTranslationUnit, TruncatedBinaryIndexIsRejected) {
+  llvm::StringMap<std::string> Index;
+  Index["a"] = "/b/f1";
+  llvm::Expected<std::string> IndexData = createCrossTUBinaryIndex(Index);
+  ASSERT_TRUE((bool)IndexData);
+  StringRef Truncated = StringRef(*IndexData).drop_back(3);
+
+  llvm::Expected<llvm::Optional<StringRef>> FileOrErr =
+      lookupCrossTUBinaryIndex(Truncated, "a", "index");
+  EXPECT_FALSE((bool)FileOrErr);
+  llvm::consumeError(FileOrErr.takeError());
+}
+
 } // end namespace cross_tu
 } // end namespace clang
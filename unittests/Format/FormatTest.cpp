@@ -14,6 +14,7 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/ADT/Statistic.h"
 #include "gtest/gtest.h"
 
 #define DEBUG_TYPE "format-test"
@@ -4861,6 +4862,57 @@ TEST_F(FormatTest, MemoizationTests) {
   input += "           a) {}";
   verifyFormat(input, OnePerLine);
 }
+
+// Lines whose solution space explodes. The line optimizer must only expand a
+// bounded number of states, and formatting must only change whitespace.
+TEST_F(FormatTest, PathologicalLines) {
+  auto ExpectOnlyWhitespaceChanges = [&](const std::string &Code,
+                                         const FormatStyle &Style) {
+    auto StripWhitespace = [](std::string Text) {
+      Text.erase(std::remove_if(Text.begin(), Text.end(),
+                                [](char C) { return isspace(C) != 0; }),
+                 Text.end());
+      return Text;
+    };
+#if LLVM_ENABLE_STATS
+    llvm::EnableStatistics(/*PrintOnExit=*/false);
+    llvm::ResetStatistics();
+#endif
+    EXPECT_EQ(StripWhitespace(Code),
+              StripWhitespace(format(Code, Style, SC_DoNotCheck)));
+#if LLVM_ENABLE_STATS
+    // The bound is generous, so that it only catches an unbounded search.
+    unsigned Expanded = 0;
+    for (const auto &Stat : llvm::GetStatistics())
+      if (Stat.first == "NumStatesExpanded")
+        Expanded = Stat.second;
+    EXPECT_GT(Expanded, 0u);
+    EXPECT_LT(Expanded, 1000000u);
+#endif
+  };
+
+  // Deeply nested initializer lists.
+  std::string Nested = "1, 2";
+  for (unsigned i = 0; i != 12; ++i)
+    Nested = "{" + Nested + "}, {aaaa, " + std::to_string(i) + ", bbbbbbbb}";
+  ExpectOnlyWhitespaceChanges("int x[] = {" + Nested + "};", getLLVMStyle());
+  ExpectOnlyWhitespaceChanges("int x[] = {" + Nested + "};",
+                              getGoogleStyleWithColumns(40));
+
+  // Long chains of Objective-C messages.
+  std::string Message = "a";
+  for (unsigned i = 0; i != 30; ++i)
+    Message = "[" + Message + " aaaaaaaa:bbbbbbbb cccc:" + std::to_string(i) +
+              "]";
+  ExpectOnlyWhitespaceChanges("x = " + Message + ";",
+                              getGoogleStyle(FormatStyle::LK_ObjC));
+
+  // Long chains of calls with nested arguments.
+  std::string Chain = "aaaaaaaaaa";
+  for (unsigned i = 0; i != 60; ++i)
+    Chain += ".bbbbbb(cccc(" + std::to_string(i) + "), dddd{eeee, ffff})";
+  ExpectOnlyWhitespaceChanges("auto x = " + Chain + ";", getLLVMStyle());
+}
 #endif
 
 TEST_F(FormatTest, BreaksAsHighAsPossible) {
@@ -402,6 +402,43 @@ TEST(MinimizeSourceToDependencyDirectivesTest, AtImport) {
   ASSERT_FALSE(minimizeSourceToDependencyDirectives(
       "@import /*x*/ A /*x*/ . /*x*/ B /*x*/ \n /*x*/ ; /*x*/", Out));
   EXPECT_STREQ("@import A.B;\n", Out.data());
+
+  ASSERT_FALSE(
+      minimizeSourceToDependencyDirectives("@import A; @import B;\n", Out));
+  EXPECT_STREQ("@import A;\n@import B;\n", Out.data());
+
+  ASSERT_FALSE(minimizeSourceToDependencyDirectives(
+      "@import A; @class B, C;\n@class D; @import E;\n", Out));
+  EXPECT_STREQ("@import A;\n@import E;\n", Out.data());
+
+  ASSERT_FALSE(minimizeSourceToDependencyDirectives(
+      "@class A; NSString *s = @\"@import B;\"; @import C;\n", Out));
+  EXPECT_STREQ("@import C;\n", Out.data());
+
+  ASSERT_FALSE(minimizeSourceToDependencyDirectives(
+      "@import A; int x; // @import B;\n", Out));
+  EXPECT_STREQ("@import A;\n", Out.data());
+}
+
+TEST(MinimizeSourceToDependencyDirectivesTest, HasIncludeHeaderName) {
+  SmallVector<char, 128> Out;
+
+  ASSERT_FALSE(minimizeSourceToDependencyDirectives(
+      "#if __has_include(<A//B.h>) && defined(C)\n#endif\n", Out));
+  EXPECT_STREQ("#if __has_include(<A//B.h>) && defined(C)\n#endif\n",
+               Out.data());
+
+  ASSERT_FALSE(minimizeSourceToDependencyDirectives(
+      "#elif __has_include_next ( <A/*B.h> ) // x\n", Out));
+  EXPECT_STREQ("#elif __has_include_next ( <A/*B.h> )\n", Out.data());
+
+  ASSERT_FALSE(
+      minimizeSourceToDependencyDirectives("#if A < B // x > y\n#endif", Out));
+  EXPECT_STREQ("#if A < B\n#endif\n", Out.data());
+
+  ASSERT_FALSE(
+      minimizeSourceToDependencyDirectives("#import <A//B.h>\n", Out));
+  EXPECT_STREQ("#import <A//B.h>\n", Out.data());
 }
 
 TEST(MinimizeSourceToDependencyDirectivesTest, AtImportFailures) {
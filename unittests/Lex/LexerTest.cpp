@@ -556,4 +556,34 @@ TEST_F(LexerTest, FindNextToken) {
   EXPECT_THAT(GeneratedByNextToken, ElementsAre("abcd", "=", "0", ";", "int",
                                                 "xyz", "=", "abcd", ";"));
 }
+
+TEST_F(LexerTest, LexTokensInBatches) {
+  TrivialModuleLoader ModLoader;
+  auto PP = CreatePP("#define ALIAS VAL\n"
+                     "#define VAL 42\n"
+                     "int x = ALIAS + f(1);\n",
+                     ModLoader);
+
+  std::vector<tok::TokenKind> Kinds;
+  std::vector<unsigned> BatchSizes;
+  std::string Expanded;
+  Token Toks[4];
+  do {
+    unsigned NumToks = PP->LexTokens(Toks);
+    BatchSizes.push_back(NumToks);
+    for (unsigned I = 0; I != NumToks; ++I) {
+      Kinds.push_back(Toks[I].getKind());
+      if (Toks[I].is(tok::numeric_constant))
+        Expanded += PP->getSpelling(Toks[I]) + " ";
+    }
+  } while (Kinds.back() != tok::eof);
+
+  EXPECT_THAT(BatchSizes, ElementsAre(4u, 4u, 3u));
+  EXPECT_THAT(Kinds,
+              ElementsAre(tok::kw_int, tok::identifier, tok::equal,
+                          tok::numeric_constant, tok::plus, tok::identifier,
+                          tok::l_paren, tok::numeric_constant, tok::r_paren,
+                          tok::semi, tok::eof));
+  EXPECT_EQ("42 1 ", Expanded);
+}
 } // anonymous namespace
@@ -0,0 +1,124 @@
+//===- unittests/StaticAnalyzer/ImmutableHashMapTest.cpp ------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/PathSensitive/ImmutableHashMap.h"
+#include "gtest/gtest.h"
+#include <map>
+
+namespace clang {
+namespace ento {
+namespace {
+
+// A key whose hash only depends on its value modulo 4, so that most keys end
+// up in collision leaves.
+struct CollidingKey {
+  unsigned V;
+  bool operator==(const CollidingKey &RHS) const { return V == RHS.V; }
+  bool operator<(const CollidingKey &RHS) const { return V < RHS.V; }
+  void Profile(llvm::FoldingSetNodeID &ID) const { ID.AddInteger(V % 4); }
+  friend llvm::hash_code hash_value(const CollidingKey &K) { return K.V % 4; }
+};
+
+TEST(ImmutableHashMap, EmptyInt) {
+  ImmutableHashMap<int, int>::Factory F;
+  ImmutableHashMap<int, int> S = F.getEmptyMap();
+
+  EXPECT_TRUE(S.isEmpty());
+  EXPECT_EQ(nullptr, S.lookup(3));
+  EXPECT_FALSE(S.contains(3));
+  EXPECT_TRUE(S.begin() == S.end());
+}
+
+TEST(ImmutableHashMap, MultiElemInt) {
+  ImmutableHashMap<int, int>::Factory F;
+  ImmutableHashMap<int, int> S = F.getEmptyMap();
+
+  ImmutableHashMap<int, int> S2 = F.add(F.add(F.add(S, 3, 10), 4, 11), 5, 12);
+  EXPECT_TRUE(S.isEmpty());
+  EXPECT_FALSE(S2.isEmpty());
+  ASSERT_NE(nullptr, S2.lookup(3));
+  EXPECT_EQ(10, *S2.lookup(3));
+  EXPECT_EQ(11, *S2.lookup(4));
+  EXPECT_EQ(12, *S2.lookup(5));
+  EXPECT_EQ(nullptr, S2.lookup(6));
+
+  ImmutableHashMap<int, int> S3 = F.add(S2, 4, 13);
+  EXPECT_EQ(11, *S2.lookup(4));
+  EXPECT_EQ(13, *S3.lookup(4));
+  EXPECT_NE(S2, S3);
+
+  ImmutableHashMap<int, int> S4 = F.remove(S3, 3);
+  EXPECT_TRUE(S3.contains(3));
+  EXPECT_FALSE(S4.contains(3));
+  EXPECT_EQ(13, *S4.lookup(4));
+}
+
+TEST(ImmutableHashMap, Canonical) {
+  ImmutableHashMap<int, int>::Factory F;
+  ImmutableHashMap<int, int> A = F.getEmptyMap(), B = F.getEmptyMap();
+
+  for (int I = 0; I < 1000; ++I)
+    A = F.add(A, I, I * 2);
+  for (int I = 999; I >= 0; --I)
+    B = F.add(B, I, I * 2);
+  EXPECT_EQ(A, B);
+
+  // Setting a key to the value it already has is a no-op.
+  EXPECT_EQ(A, F.add(A, 500, 1000));
+  // Removing a key that is not there is a no-op.
+  EXPECT_EQ(A, F.remove(A, 1000));
+
+  // Removing and re-adding an entry yields the original map.
+  EXPECT_EQ(A, F.add(F.remove(A, 42), 42, 84));
+
+  for (int I = 0; I < 1000; ++I)
+    A = F.remove(A, I);
+  EXPECT_TRUE(A.isEmpty());
+}
+
+TEST(ImmutableHashMap, Iteration) {
+  ImmutableHashMap<int, int>::Factory F;
+  ImmutableHashMap<int, int> S = F.getEmptyMap();
+  for (int I = 0; I < 300; ++I)
+    S = F.add(S, I, -I);
+
+  std::map<int, int> Seen;
+  for (ImmutableHashMap<int, int>::iterator I = S.begin(), E = S.end(); I != E;
+       ++I) {
+    EXPECT_EQ(-I.getKey(), I.getData());
+    EXPECT_TRUE(Seen.insert({I.getKey(), I.getData()}).second);
+  }
+  EXPECT_EQ(300u, Seen.size());
+}
+
+TEST(ImmutableHashMap, HashCollisions) {
+  ImmutableHashMap<CollidingKey, int>::Factory F;
+  ImmutableHashMap<CollidingKey, int> A = F.getEmptyMap();
+  ImmutableHashMap<CollidingKey, int> B = F.getEmptyMap();
+
+  for (unsigned I = 0; I < 64; ++I)
+    A = F.add(A, CollidingKey{I}, I);
+  for (unsigned I = 64; I-- > 0;)
+    B = F.add(B, CollidingKey{I}, I);
+  EXPECT_EQ(A, B);
+
+  for (unsigned I = 0; I < 64; ++I) {
+    ASSERT_NE(nullptr, A.lookup(CollidingKey{I}));
+    EXPECT_EQ(int(I), *A.lookup(CollidingKey{I}));
+  }
+  EXPECT_FALSE(A.contains(CollidingKey{64}));
+
+  for (unsigned I = 0; I < 64; I += 2)
+    A = F.remove(A, CollidingKey{I});
+  for (unsigned I = 0; I < 64; ++I)
+    EXPECT_EQ(I % 2 == 1, A.contains(CollidingKey{I}));
+}
+
+} // namespace
+} // namespace ento
+} // namespace clang
@@ -0,0 +1,105 @@
+//===- unittests/StaticAnalyzer/RangeSetTest.cpp --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/StaticAnalyzer/Core/PathSensitive/BasicValueFactory.h"
+#include "clang/StaticAnalyzer/Core/PathSensitive/RangedConstraintManager.h"
+#include "clang/Tooling/Tooling.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace ento {
+namespace {
+
+class RangeSetTest : public testing::Test {
+protected:
+  std::unique_ptr<ASTUnit> AST = tooling::buildASTFromCode("");
+  llvm::BumpPtrAllocator Alloc;
+  BasicValueFactory BVF{AST->getASTContext(), Alloc};
+  RangeSet::Factory F;
+  QualType T = AST->getASTContext().SignedCharTy;
+
+  const llvm::APSInt &from(int V) { return BVF.getValue(V, T); }
+
+  RangeSet all() { return RangeSet(F, BVF.getMinValue(T), BVF.getMaxValue(T)); }
+
+  void expectRanges(const RangeSet &S,
+                    std::initializer_list<std::pair<int, int>> Expected) {
+    auto I = S.begin();
+    for (const auto &R : Expected) {
+      ASSERT_NE(S.end(), I);
+      EXPECT_EQ(R.first, I->From().getExtValue());
+      EXPECT_EQ(R.second, I->To().getExtValue());
+      ++I;
+    }
+    EXPECT_EQ(S.end(), I);
+  }
+};
+
+TEST_F(RangeSetTest, Uniqued) {
+  RangeSet A = all().Intersect(BVF, F, from(1), from(-1));
+  RangeSet B = all().Intersect(BVF, F, from(1), from(127))
+                   .addRange(F, all().Intersect(BVF, F, from(-128), from(-1)));
+  EXPECT_EQ(A, B);
+  expectRanges(A, {{-128, -1}, {1, 127}});
+
+  // Intersecting with a range covering the whole set is a no-op.
+  EXPECT_EQ(A, A.Intersect(BVF, F, from(-128), from(127)));
+
+  EXPECT_TRUE(F.getEmptySet().isEmpty());
+  EXPECT_TRUE(A.Intersect(BVF, F, from(0), from(0)).isEmpty());
+}
+
+TEST_F(RangeSetTest, Intersect) {
+  RangeSet A = all().Intersect(BVF, F, from(-10), from(10));
+  expectRanges(A.Intersect(BVF, F, from(5), from(-5)), {{-10, -5}, {5, 10}});
+  expectRanges(A.Intersect(BVF, F, from(0), from(20)), {{0, 10}});
+
+  RangeSet B = all().Intersect(BVF, F, from(-5), from(20));
+  expectRanges(A.Intersect(BVF, F, B), {{-5, 10}});
+
+  const llvm::APSInt *V = A.Intersect(BVF, F, from(3), from(3))
+                              .getConcreteValue();
+  ASSERT_NE(nullptr, V);
+  EXPECT_EQ(3, V->getExtValue());
+}
+
+TEST_F(RangeSetTest, Negate) {
+  expectRanges(all().Intersect(BVF, F, from(-5), from(10)).Negate(BVF, F),
+               {{-10, 5}});
+  expectRanges(all().Intersect(BVF, F, from(-128), from(-100)).Negate(BVF, F),
+               {{-128, -128}, {100, 127}});
+
+  RangeSet A = all().Intersect(BVF, F, from(100), from(-100));
+  expectRanges(A, {{-128, -100}, {100, 127}});
+  EXPECT_EQ(A, A.Negate(BVF, F));
+}
+
+TEST(RangeTest, IsLess) {
+  // Unsigned values with the top bit set are not negative.
+  llvm::APSInt Big(llvm::APInt::getMaxValue(64), /*isUnsigned=*/true);
+  llvm::APSInt One(llvm::APInt(64, 1), /*isUnsigned=*/true);
+  EXPECT_TRUE(Range::isLess(One, Big));
+  EXPECT_FALSE(Range::isLess(Big, One));
+
+  llvm::APSInt Min(llvm::APInt::getSignedMinValue(64), /*isUnsigned=*/false);
+  llvm::APSInt Zero(llvm::APInt(64, 0), /*isUnsigned=*/false);
+  EXPECT_TRUE(Range::isLess(Min, Zero));
+  EXPECT_FALSE(Range::isLess(Zero, Zero));
+
+  // Wider values take the APInt comparison.
+  llvm::APSInt WideMin(llvm::APInt::getSignedMinValue(128),
+                       /*isUnsigned=*/false);
+  llvm::APSInt WideMax(llvm::APInt::getSignedMaxValue(128),
+                       /*isUnsigned=*/false);
+  EXPECT_TRUE(Range::isLess(WideMin, WideMax));
+  EXPECT_FALSE(Range::isLess(WideMax, WideMin));
+}
+
+} // namespace
+} // namespace ento
+} // namespace clang
@@ -13,6 +13,8 @@
 #include "clang/Tooling/FileMatchTrie.h"
 #include "clang/Tooling/JSONCompilationDatabase.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetSelect.h"
 #include "gmock/gmock.h"
@@ -406,6 +408,150 @@ static std::vector<std::string> unescapeJsonCommandLine(StringRef Command) {
   return FoundCommand.CommandLine;
 }
 
+class IndexedJSONCompilationDatabaseTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("indexed-cdb", Directory));
+    DatabasePath = Directory;
+    llvm::sys::path::append(DatabasePath, "compile_commands.json");
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove(
+        IndexedJSONCompilationDatabase::getIndexPath(DatabasePath));
+    llvm::sys::fs::remove(DatabasePath);
+    llvm::sys::fs::remove(Directory);
+  }
+
+  void writeDatabase(StringRef Contents) {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(DatabasePath, EC, llvm::sys::fs::OF_None);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  }
+
+  std::unique_ptr<IndexedJSONCompilationDatabase> load() {
+    std::string ErrorMessage;
+    auto Database = IndexedJSONCompilationDatabase::loadFromFile(
+        DatabasePath, ErrorMessage, JSONCommandLineSyntax::Gnu);
+    EXPECT_TRUE(Database) << ErrorMessage;
+    return Database;
+  }
+
+  SmallString<128> Directory;
+  SmallString<128> DatabasePath;
+};
+
+TEST_F(IndexedJSONCompilationDatabaseTest, FindsEntries) {
+  writeDatabase("[{\"directory\":\"//net/dir\",\"command\":\"cc -DA a.cc\","
+                "\"file\":\"a.cc\"},"
+                "{\"directory\":\"//net/dir\",\"command\":\"cc -DB{ b.cc\","
+                "\"file\":\"//net/dir/b.cc\"},"
+                "{\"directory\":\"//net/dir\",\"arguments\":[\"cc\",\"-DA2\"],"
+                "\"file\":\"//net/dir/a.cc\"}]");
+  auto Database = load();
+  ASSERT_TRUE(Database);
+  EXPECT_TRUE(llvm::sys::fs::exists(
+      IndexedJSONCompilationDatabase::getIndexPath(DatabasePath)));
+
+  std::vector<CompileCommand> Commands =
+      Database->getCompileCommands("//net/dir/a.cc");
+  ASSERT_EQ(2u, Commands.size());
+  EXPECT_THAT(Commands[0].CommandLine, ElementsAre("cc", "-DA", "a.cc"));
+  EXPECT_THAT(Commands[1].CommandLine, ElementsAre("cc", "-DA2"));
+  Commands = Database->getCompileCommands("//net/dir/b.cc");
+  ASSERT_EQ(1u, Commands.size());
+  EXPECT_THAT(Commands[0].CommandLine, ElementsAre("cc", "-DB{", "b.cc"));
+  EXPECT_TRUE(Database->getCompileCommands("//net/dir/c.cc").empty());
+  EXPECT_EQ(2u, Database->getAllFiles().size());
+  EXPECT_EQ(3u, Database->getAllCompileCommands().size());
+
+  // A second load uses the saved index.
+  Database = load();
+  ASSERT_TRUE(Database);
+  EXPECT_EQ(2u, Database->getCompileCommands("//net/dir/a.cc").size());
+}
+
+TEST_F(IndexedJSONCompilationDatabaseTest, RebuildsStaleIndex) {
+  writeDatabase("[{\"directory\":\"//net/dir\",\"command\":\"cc a.cc\","
+                "\"file\":\"a.cc\"}]");
+  ASSERT_TRUE(load());
+  writeDatabase("[{\"directory\":\"//net/dir\",\"command\":\"cc -O2 b.cc\","
+                "\"file\":\"b.cc\"}]");
+  auto Database = load();
+  ASSERT_TRUE(Database);
+  EXPECT_TRUE(Database->getCompileCommands("//net/dir/a.cc").empty());
+  std::vector<CompileCommand> Commands =
+      Database->getCompileCommands("//net/dir/b.cc");
+  ASSERT_EQ(1u, Commands.size());
+  EXPECT_THAT(Commands[0].CommandLine, ElementsAre("cc", "-O2", "b.cc"));
+}
+
+TEST_F(IndexedJSONCompilationDatabaseTest, MatchesEquivalentPaths) {
+  SmallString<128> Source(Directory), OtherDirectory(Directory);
+  llvm::sys::path::append(Source, "a.cc");
+  llvm::sys::path::append(OtherDirectory, "other");
+  SmallString<128> Link(OtherDirectory);
+  llvm::sys::path::append(Link, "a.cc");
+  {
+    std::error_code EC;
+    llvm::raw_fd_ostream OS(Source, EC, llvm::sys::fs::OF_None);
+    ASSERT_FALSE(EC);
+  }
+  ASSERT_FALSE(llvm::sys::fs::create_directory(OtherDirectory));
+  ASSERT_FALSE(llvm::sys::fs::create_hard_link(Source, Link));
+
+  SmallString<128> NativeSource;
+  llvm::sys::path::native(Source, NativeSource);
+  writeDatabase("[{\"directory\":\"//net/dir\",\"command\":\"cc -DA a.cc\","
+                "\"file\":\"" + llvm::yaml::escape(NativeSource) + "\"}]");
+  auto Database = load();
+  ASSERT_TRUE(Database);
+  // The path is not spelled as in the database, but names the same file.
+  std::vector<CompileCommand> Commands = Database->getCompileCommands(Link);
+  ASSERT_EQ(1u, Commands.size());
+  EXPECT_THAT(Commands[0].CommandLine, ElementsAre("cc", "-DA", "a.cc"));
+
+  llvm::sys::fs::remove(Link);
+  llvm::sys::fs::remove(OtherDirectory);
+  llvm::sys::fs::remove(Source);
+}
+
+TEST_F(IndexedJSONCompilationDatabaseTest, PluginUsesIndexWhenEnabled) {
+  writeDatabase("[{\"directory\":\"//net/dir\",\"command\":\"cc -DA a.cc\","
+                "\"file\":\"a.cc\"}]");
+  auto *IndexOption = static_cast<llvm::cl::opt<bool> *>(
+      llvm::cl::getRegisteredOptions()["index-compilation-database"]);
+  ASSERT_TRUE(IndexOption);
+
+  std::string ErrorMessage;
+  ASSERT_TRUE(CompilationDatabase::loadFromDirectory(Directory, ErrorMessage))
+      << ErrorMessage;
+  EXPECT_FALSE(llvm::sys::fs::exists(
+      IndexedJSONCompilationDatabase::getIndexPath(DatabasePath)));
+
+  *IndexOption = true;
+  auto Database =
+      CompilationDatabase::loadFromDirectory(Directory, ErrorMessage);
+  *IndexOption = false;
+  ASSERT_TRUE(Database) << ErrorMessage;
+  EXPECT_TRUE(llvm::sys::fs::exists(
+      IndexedJSONCompilationDatabase::getIndexPath(DatabasePath)));
+  std::vector<CompileCommand> Commands =
+      Database->getCompileCommands("//net/dir/a.cc");
+  ASSERT_EQ(1u, Commands.size());
+  EXPECT_THAT(Commands[0].CommandLine, ElementsAre("cc", "-DA", "a.cc"));
+}
+
+TEST_F(IndexedJSONCompilationDatabaseTest, ErrsOnInvalidFormat) {
+  writeDatabase("{\"directory\":\"//net/dir\"}");
+  std::string ErrorMessage;
+  EXPECT_FALSE(IndexedJSONCompilationDatabase::loadFromFile(
+      DatabasePath, ErrorMessage, JSONCommandLineSyntax::Gnu));
+  EXPECT_FALSE(ErrorMessage.empty());
+}
+
 TEST(unescapeJsonCommandLine, ReturnsEmptyArrayOnEmptyString) {
   std::vector<std::string> Result = unescapeJsonCommandLine("");
   EXPECT_TRUE(Result.empty());
@@ -14,15 +14,19 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/DependencyScanning/DependencyScanningFilesystem.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
 #include "gtest/gtest.h"
 #include <algorithm>
 #include <string>
+#include <thread>
 
 namespace clang {
 namespace tooling {
@@ -196,5 +200,96 @@ TEST(DependencyScanner, ScanDepsReuseFilemanagerHasInclude) {
   EXPECT_EQ(convert_to_slash(Deps[5]), "/root/symlink.h");
 }
 
+namespace {
+
+/// Counts the files that are opened through it.
+class CountingFileSystem : public llvm::vfs::ProxyFileSystem {
+public:
+  CountingFileSystem(IntrusiveRefCntPtr<llvm::vfs::FileSystem> FS)
+      : ProxyFileSystem(std::move(FS)) {}
+
+  llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    ++NumOpens;
+    return ProxyFileSystem::openFileForRead(Path);
+  }
+
+  std::atomic<unsigned> NumOpens{0};
+};
+
+} // namespace
+
+TEST(DependencyScanner, SharedCachePopulatesEntriesOnce) {
+  const unsigned NumFiles = 64;
+  const unsigned NumThreads = 8;
+
+  auto InMemoryFS = llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+  for (unsigned I = 0; I != NumFiles; ++I)
+    InMemoryFS->addFile(
+        "/root/header" + Twine(I) + ".h", 0,
+        llvm::MemoryBuffer::getMemBufferCopy("#define A" + Twine(I) + "\n"));
+  auto CountingFS = llvm::makeIntrusiveRefCnt<CountingFileSystem>(InMemoryFS);
+
+  dependencies::DependencyScanningFilesystemSharedCache SharedCache;
+  std::vector<std::thread> Threads;
+  std::atomic<unsigned> NumFailures(0);
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    Threads.emplace_back([&] {
+      auto DepFS = llvm::makeIntrusiveRefCnt<
+          dependencies::DependencyScanningWorkerFilesystem>(
+          SharedCache, CountingFS, nullptr);
+      for (unsigned I = 0; I != NumFiles; ++I) {
+        if (!DepFS->status("/root/header" + Twine(I) + ".h"))
+          ++NumFailures;
+      }
+    });
+  }
+  for (auto &Thread : Threads)
+    Thread.join();
+
+  EXPECT_EQ(NumFailures, 0u);
+  EXPECT_EQ(CountingFS->NumOpens, NumFiles);
+}
+
+/// A micro-benchmark of the shared cache lookups, reporting the lookups per
+/// second per thread for an increasing number of threads. Run it with
+/// --gtest_also_run_disabled_tests.
+TEST(DependencyScanner, DISABLED_SharedCacheLookupThroughput) {
+  const unsigned NumKeys = 1 << 16;
+  const unsigned NumRounds = 16;
+
+  std::vector<std::string> Keys;
+  for (unsigned I = 0; I != NumKeys; ++I)
+    Keys.push_back(("/usr/include/dir" + Twine(I % 97) + "/header" + Twine(I) +
+                    ".h")
+                       .str());
+
+  unsigned MaxThreads = llvm::hardware_concurrency();
+  for (unsigned NumThreads = 1; NumThreads <= MaxThreads; NumThreads *= 2) {
+    dependencies::DependencyScanningFilesystemSharedCache SharedCache;
+    std::vector<std::thread> Threads;
+    llvm::TimeRecord Start = llvm::TimeRecord::getCurrentTime();
+    for (unsigned T = 0; T != NumThreads; ++T) {
+      Threads.emplace_back([&, T] {
+        // Start every thread at a different key, like workers that scan
+        // different translation units that share most of their headers.
+        for (unsigned Round = 0; Round != NumRounds; ++Round)
+          for (unsigned I = 0; I != NumKeys; ++I) {
+            auto &Entry = SharedCache.get(Keys[(I + T * 4099) % NumKeys]);
+            if (!Entry.IsPopulated.load(std::memory_order_acquire))
+              Entry.IsPopulated.store(true, std::memory_order_release);
+          }
+      });
+    }
+    for (auto &Thread : Threads)
+      Thread.join();
+    double Seconds =
+        llvm::TimeRecord::getCurrentTime().getWallTime() - Start.getWallTime();
+    llvm::outs() << llvm::formatv(
+        "{0,3} threads: {1,12:F0} lookups/s/thread\n", NumThreads,
+        double(NumKeys) * NumRounds / Seconds);
+  }
+}
+
 } // end namespace tooling
 } // end namespace clang
@@ -293,5 +293,44 @@ TEST(AllTUsToolTest, ManyFiles) {
   EXPECT_THAT(ExpectedSymbols, ::testing::UnorderedElementsAreArray(Results));
 }
 
+TEST(AllTUsToolTest, StreamsResults) {
+  FixedCompilationDatabaseWithFiles Compilations(
+      ".", {"a.cc", "b.cc", "c.cc"}, std::vector<std::string>());
+  AllTUsToolExecutor Executor(Compilations, /*ThreadCount=*/0);
+  Executor.mapVirtualFile("a.cc", "void x() {}");
+  Executor.mapVirtualFile("b.cc", "void y() {}");
+  Executor.mapVirtualFile("c.cc", "void z() {}");
+  std::vector<std::string> Streamed;
+  Executor.setResultConsumer(
+      [&](StringRef Key, StringRef) { Streamed.push_back(Key); });
+
+  auto Err = Executor.execute(std::unique_ptr<FrontendActionFactory>(
+      new ReportResultActionFactory(Executor.getExecutionContext())));
+  ASSERT_TRUE(!Err);
+  EXPECT_THAT(Streamed, ::testing::UnorderedElementsAre("x", "y", "z"));
+  EXPECT_TRUE(Executor.getToolResults()->AllKVResults().empty());
+}
+
+TEST(AllTUsToolTest, LargestFilesFirst) {
+  FixedCompilationDatabaseWithFiles Compilations(
+      ".", {"small.cc", "large.cc", "medium.cc"}, std::vector<std::string>());
+  AllTUsToolExecutor Executor(Compilations, /*ThreadCount=*/1);
+  Executor.mapVirtualFile("small.cc", "void s() {}");
+  Executor.mapVirtualFile("large.cc",
+                          "void l() {}\nvoid l_helper1() {}\n"
+                          "void l_helper2() {}\n");
+  Executor.mapVirtualFile("medium.cc", "void m() {}\nvoid m_helper() {}\n");
+  std::vector<std::string> Streamed;
+  Executor.setResultConsumer(
+      [&](StringRef Key, StringRef) { Streamed.push_back(Key); });
+
+  auto Err = Executor.execute(std::unique_ptr<FrontendActionFactory>(
+      new ReportResultActionFactory(Executor.getExecutionContext())));
+  ASSERT_TRUE(!Err);
+  EXPECT_THAT(Streamed,
+              ::testing::ElementsAre("l", "l_helper1", "l_helper2", "m",
+                                     "m_helper", "s"));
+}
+
 } // end namespace tooling
 } // end namespace clang
@@ -15,6 +15,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/SharedPreambleCache.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
@@ -405,6 +406,73 @@ TEST(ClangToolTest, ArgumentAdjusters) {
   EXPECT_FALSE(Found);
 }
 
+TEST(ClangToolTest, SharedPreambleCache) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources = {"/a.cc", "/b.cc", "/c.cc", "/d.cc"};
+
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/header.h", "#define HEADER_VALUE 42\n");
+  Tool.mapVirtualFile("/a.cc", "#include \"header.h\"\nint a = HEADER_VALUE;");
+  Tool.mapVirtualFile("/b.cc", "#include \"header.h\"\nint b = HEADER_VALUE;");
+  Tool.mapVirtualFile("/c.cc", "#include \"header.h\"\nint c = HEADER_VALUE;");
+  // A different preamble is not shared with the other files.
+  Tool.mapVirtualFile("/d.cc", "#define D 1\nint d = D;");
+  SharedPreambleCache Cache;
+  Tool.setPreambleCache(&Cache);
+
+  std::unique_ptr<FrontendActionFactory> Action(
+      newFrontendActionFactory<SyntaxOnlyAction>());
+  EXPECT_EQ(0, Tool.run(Action.get()));
+  // The first file only records the preamble, the others reuse it.
+  EXPECT_EQ(2u, Cache.getNumReuses());
+}
+
+namespace {
+/// Records the file and message of every warning.
+struct WarningRecorder : public DiagnosticConsumer {
+  void HandleDiagnostic(DiagnosticsEngine::Level DiagLevel,
+                        const Diagnostic &Info) override {
+    if (DiagLevel != DiagnosticsEngine::Warning)
+      return;
+    SmallString<64> Message;
+    Info.FormatDiagnostic(Message);
+    Warnings.push_back(
+        (Info.getSourceManager().getFilename(Info.getLocation()) + ": " +
+         Message)
+            .str());
+  }
+  std::vector<std::string> Warnings;
+};
+} // end anonymous namespace
+
+TEST(ClangToolTest, SharedPreambleCacheReplaysDiagnostics) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources = {"/a.cc", "/b.cc", "/c.cc"};
+
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/header.h", "#define VALUE 1\n#warning in header\n");
+  // The redefinition is reported in the preamble region of each main file.
+  const char *Code = "#include \"header.h\"\n#define VALUE 2\nint x = VALUE;";
+  Tool.mapVirtualFile("/a.cc", Code);
+  Tool.mapVirtualFile("/b.cc", Code);
+  Tool.mapVirtualFile("/c.cc", Code);
+  SharedPreambleCache Cache;
+  Tool.setPreambleCache(&Cache);
+  WarningRecorder Recorder;
+  Tool.setDiagnosticConsumer(&Recorder);
+
+  std::unique_ptr<FrontendActionFactory> Action(
+      newFrontendActionFactory<SyntaxOnlyAction>());
+  EXPECT_EQ(0, Tool.run(Action.get()));
+  EXPECT_EQ(2u, Cache.getNumReuses());
+  std::vector<std::string> Expected;
+  for (StringRef File : Sources) {
+    Expected.push_back("/header.h: in header");
+    Expected.push_back((File + ": 'VALUE' macro redefined").str());
+  }
+  EXPECT_EQ(Expected, Recorder.Warnings);
+}
+
 TEST(ClangToolTest, NoDoubleSyntaxOnly) {
   FixedCompilationDatabase Compilations("/", {"-fsyntax-only"});
 
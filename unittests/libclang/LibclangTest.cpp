@@ -562,6 +562,119 @@ TEST_F(LibclangReparseTest, clang_parseTranslationUnit2FullArgv) {
   DisplayDiagnostics();
 }
 
+// Checks that \p TU includes shared.h from its own main file \p File and that
+// the function defined there is located in \p File too.
+static void checkBatchUnit(CXTranslationUnit TU, const std::string &File,
+                           const std::string &Function) {
+  struct Inclusions {
+    CXFile Main;
+    unsigned NumShared = 0;
+    unsigned NumFromMain = 0;
+  } Incs;
+  Incs.Main = clang_getFile(TU, File.c_str());
+  ASSERT_NE(nullptr, Incs.Main);
+  clang_getInclusions(
+      TU,
+      [](CXFile Included, CXSourceLocation *Stack, unsigned Len,
+         CXClientData Data) {
+        auto &Incs = *static_cast<Inclusions *>(Data);
+        CXString Name = clang_getFileName(Included);
+        bool IsShared =
+            llvm::StringRef(clang_getCString(Name)).endswith("shared.h");
+        clang_disposeString(Name);
+        if (!IsShared || Len == 0)
+          return;
+        ++Incs.NumShared;
+        CXFile From;
+        clang_getFileLocation(Stack[0], &From, nullptr, nullptr, nullptr);
+        if (clang_File_isEqual(From, Incs.Main))
+          ++Incs.NumFromMain;
+      },
+      &Incs);
+  EXPECT_EQ(1U, Incs.NumShared);
+  EXPECT_EQ(1U, Incs.NumFromMain);
+
+  CXCursor C = clang_getCursor(TU, clang_getLocation(TU, Incs.Main, 2, 5));
+  CXString Spelling = clang_getCursorSpelling(C);
+  EXPECT_EQ(Function, clang_getCString(Spelling));
+  clang_disposeString(Spelling);
+  CXFile DeclFile;
+  clang_getFileLocation(clang_getCursorLocation(C), &DeclFile, nullptr,
+                        nullptr, nullptr);
+  EXPECT_TRUE(clang_File_isEqual(DeclFile, Incs.Main));
+}
+
+TEST_F(LibclangReparseTest, ParseTranslationUnitBatch) {
+  std::string Header = "shared.h";
+  WriteFile(Header, "#ifndef SHARED_H\n#define SHARED_H\n"
+                    "inline int value() { return 42; }\n#endif\n");
+  std::vector<std::string> Sources;
+  for (int I = 0; I != 2; ++I) {
+    std::string File = "file" + std::to_string(I) + ".cpp";
+    WriteFile(File, "#include \"shared.h\"\nint f" + std::to_string(I) +
+                        "() { return value(); }\n");
+    Sources.push_back(File);
+  }
+  // file0.cpp is parsed twice; the two units must not affect each other.
+  std::vector<std::string> Files = {Sources[0], Sources[1], Sources[0]};
+  std::vector<std::string> Functions = {"f0", "f1", "f0"};
+
+  const char *Argv[] = {"clang"};
+  std::vector<CXTranslationUnitBatchEntry> Entries(Files.size());
+  for (unsigned I = 0; I != Files.size(); ++I) {
+    Entries[I].translation_unit = nullptr;
+    Entries[I].source_filename = Files[I].c_str();
+    Entries[I].command_line_args = Argv;
+    Entries[I].num_command_line_args = 1;
+    Entries[I].unsaved_files = nullptr;
+    Entries[I].num_unsaved_files = 0;
+    Entries[I].options = TUFlags;
+  }
+
+  struct Result {
+    CXTranslationUnit TU = nullptr;
+    CXErrorCode Error = CXError_Failure;
+    unsigned Calls = 0;
+  };
+  std::vector<Result> Results(Files.size());
+  auto Callback = [](CXClientData Data, unsigned Entry, CXTranslationUnit TU,
+                     CXErrorCode Error) {
+    Result &R = (*static_cast<std::vector<Result> *>(Data))[Entry];
+    R.TU = TU;
+    R.Error = Error;
+    ++R.Calls;
+  };
+
+  ASSERT_EQ(CXError_Success,
+            clang_parseTranslationUnitBatch(Index, Entries.data(),
+                                            Entries.size(), 2, Callback,
+                                            &Results));
+  for (unsigned I = 0; I != Files.size(); ++I) {
+    EXPECT_EQ(1U, Results[I].Calls);
+    EXPECT_EQ(CXError_Success, Results[I].Error);
+    ASSERT_NE(nullptr, Results[I].TU);
+    EXPECT_EQ(0U, clang_getNumDiagnostics(Results[I].TU));
+    checkBatchUnit(Results[I].TU, Files[I], Functions[I]);
+    Entries[I].translation_unit = Results[I].TU;
+    Entries[I].options = clang_defaultReparseOptions(Results[I].TU);
+    Results[I] = Result();
+  }
+
+  // Reparse all of them, which builds their preambles.
+  ASSERT_EQ(CXError_Success,
+            clang_parseTranslationUnitBatch(Index, Entries.data(),
+                                            Entries.size(), 2, Callback,
+                                            &Results));
+  for (unsigned I = 0; I != Files.size(); ++I) {
+    EXPECT_EQ(1U, Results[I].Calls);
+    EXPECT_EQ(CXError_Success, Results[I].Error);
+    EXPECT_EQ(Entries[I].translation_unit, Results[I].TU);
+    EXPECT_EQ(0U, clang_getNumDiagnostics(Results[I].TU));
+    checkBatchUnit(Results[I].TU, Files[I], Functions[I]);
+    clang_disposeTranslationUnit(Entries[I].translation_unit);
+  }
+}
+
 class LibclangPrintingPolicyTest : public LibclangParseTest {
 public:
   CXPrintingPolicy Policy = nullptr;